@@ -0,0 +1,245 @@
+#include "fake_webgpu.h"
+#include "utilities/batch_renderer.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+using Batches = BatchRenderer<FakeTypes>;
+
+constexpr int kUint16{16};
+constexpr BatchColour kWhite{1.0F, 1.0F, 1.0F};
+
+// Holds the buffers' contents and the draws handed to the render queue
+struct FakeGpu
+{
+    FakeObject vertex_buffer{'v'};
+    FakeObject index_buffer{'i'};
+    std::vector<uint8_t> vertex_bytes{};
+    std::vector<uint8_t> index_bytes{};
+    std::vector<Batches::DrawPacket> draws{};
+
+    void Initialise(Batches &batches,
+                    uint32_t quads_per_frame,
+                    uint32_t quads_per_batch)
+    {
+        vertex_bytes.resize(Batches::VertexBufferSize(
+            quads_per_frame, Batches::kDefaultRegionCount));
+        index_bytes.resize(Batches::IndexBufferSize(
+            quads_per_frame, Batches::kDefaultRegionCount));
+        batches.Initialise(
+            &vertex_buffer,
+            &index_buffer,
+            kUint16,
+            quads_per_frame,
+            quads_per_batch,
+            Batches::kDefaultRegionCount,
+            [this](const FakeObject *buffer,
+                   uint64_t offset,
+                   const void *data,
+                   size_t size) {
+                std::vector<uint8_t> &bytes{
+                    buffer == &vertex_buffer ? vertex_bytes : index_bytes};
+                REQUIRE(offset % 4 == 0);
+                REQUIRE(size % 4 == 0);
+                REQUIRE(offset + size <= bytes.size());
+                std::memcpy(bytes.data() + offset, data, size);
+            },
+            [this](const Batches::DrawPacket &packet) {
+                draws.push_back(packet);
+            });
+    }
+
+    // The vertex a draw's `index`th index refers to
+    [[nodiscard]] BatchVertex Vertex(const Batches::DrawPacket &draw,
+                                     uint32_t index) const
+    {
+        uint16_t vertex_index{};
+        std::memcpy(&vertex_index,
+                    index_bytes.data() + draw.index_buffer.offset +
+                        (draw.first_index + index) * sizeof(uint16_t),
+                    sizeof(uint16_t));
+        BatchVertex vertex{};
+        std::memcpy(&vertex,
+                    vertex_bytes.data() + draw.vertex_buffer.offset +
+                        (static_cast<size_t>(draw.base_vertex) +
+                         vertex_index) *
+                            sizeof(BatchVertex),
+                    sizeof(BatchVertex));
+        return vertex;
+    }
+};
+} // namespace
+
+TEST_CASE("It draws a frame's quads as one batch", "[batch_renderer]")
+{
+    const FakeObject pipeline{'P'};
+    const FakeObject bind_group{'B'};
+    FakeGpu gpu{};
+    Batches batches{};
+    gpu.Initialise(batches, 16, 16);
+
+    batches.Begin(1);
+    batches.SetState(&pipeline, &bind_group);
+    batches.Quad(0.0F, 0.0F, 0.5F, 0.5F, kWhite);
+    batches.Quad(-1.0F, -1.0F, -0.5F, -0.5F, {0.0F, 0.0F, 1.0F});
+    const BatchStats stats{batches.End()};
+
+    REQUIRE(stats.quads == 2);
+    REQUIRE(stats.batches == 1);
+    REQUIRE(stats.bytes_uploaded ==
+            8 * sizeof(BatchVertex) + 12 * sizeof(uint16_t));
+    REQUIRE(gpu.draws.size() == 1);
+    const Batches::DrawPacket &draw{gpu.draws.front()};
+    REQUIRE(SortKey::Pass(draw.key) == 1);
+    REQUIRE(draw.pipeline == &pipeline);
+    REQUIRE(draw.bind_group == &bind_group);
+    REQUIRE(draw.index_format == kUint16);
+    REQUIRE(draw.index_count == 12);
+
+    // The second quad's third corner
+    const BatchVertex corner{gpu.Vertex(draw, 8)};
+    REQUIRE(corner.position == std::array<float, 2>{-0.5F, -0.5F});
+    REQUIRE(corner.colour == BatchColour{0.0F, 0.0F, 1.0F});
+}
+
+TEST_CASE("It flushes on state changes and full batches", "[batch_renderer]")
+{
+    const FakeObject first{'1'};
+    const FakeObject second{'2'};
+    FakeGpu gpu{};
+    Batches batches{};
+    gpu.Initialise(batches, 8, 2);
+
+    batches.Begin(0);
+    batches.SetState(&first, &first);
+    for (int quad{0}; quad < 3; ++quad)
+    {
+        batches.Quad(0.0F, 0.0F, 1.0F, 1.0F, kWhite);
+    }
+    batches.SetState(&second, &first);
+    batches.Quad(0.0F, 0.0F, 1.0F, 1.0F, kWhite);
+    const BatchStats stats{batches.End()};
+
+    REQUIRE(stats.batches == 3);
+    REQUIRE(stats.full_flushes == 1);
+    REQUIRE(stats.state_flushes == 1);
+    REQUIRE(gpu.draws.size() == 3);
+    // Later batches follow earlier ones in the region, in order
+    for (size_t index{0}; index < gpu.draws.size(); ++index)
+    {
+        REQUIRE(SortKey::Depth(gpu.draws[index].key) == index);
+    }
+    REQUIRE(gpu.draws[1].first_index == 2 * Batches::kIndicesPerQuad);
+    REQUIRE(gpu.draws[1].base_vertex == 2 * Batches::kVerticesPerQuad);
+    REQUIRE(gpu.draws[2].pipeline == &second);
+    REQUIRE(gpu.Vertex(gpu.draws[2], 0).position ==
+            std::array<float, 2>{0.0F, 0.0F});
+}
+
+TEST_CASE("It alternates regions and drops what does not fit",
+          "[batch_renderer]")
+{
+    const FakeObject state{'S'};
+    FakeGpu gpu{};
+    Batches batches{};
+    gpu.Initialise(batches, 2, 2);
+
+    for (int frame{0}; frame < 3; ++frame)
+    {
+        batches.Begin(0);
+        batches.SetState(&state, &state);
+        for (int quad{0}; quad < 3; ++quad)
+        {
+            batches.Quad(0.0F, 0.0F, 1.0F, 1.0F, kWhite);
+        }
+        REQUIRE(batches.End().dropped_quads == 1);
+    }
+    REQUIRE(gpu.draws.size() == 3);
+    REQUIRE(gpu.draws[0].vertex_buffer.offset == 0);
+    REQUIRE(gpu.draws[1].vertex_buffer.offset ==
+            Batches::VertexBufferSize(2, 1));
+    REQUIRE(gpu.draws[1].index_buffer.offset ==
+            Batches::IndexBufferSize(2, 1));
+    REQUIRE(gpu.draws[2].vertex_buffer.offset == 0);
+
+    // Frames can name their region instead, such as by frame slot
+    batches.Begin(0, 1);
+    batches.SetState(&state, &state);
+    batches.Quad(0.0F, 0.0F, 1.0F, 1.0F, kWhite);
+    batches.End();
+    REQUIRE(gpu.draws[3].vertex_buffer.offset ==
+            Batches::VertexBufferSize(2, 1));
+}
+
+TEST_CASE("It draws lines as quads of the given width", "[batch_renderer]")
+{
+    const FakeObject state{'S'};
+    FakeGpu gpu{};
+    Batches batches{};
+    gpu.Initialise(batches, 4, 4);
+
+    batches.Begin(0);
+    batches.SetState(&state, &state);
+    batches.Line(0.0F, 0.0F, 1.0F, 0.0F, 0.5F, kWhite);
+    // Zero length lines have no direction to widen along
+    batches.Line(0.5F, 0.5F, 0.5F, 0.5F, 0.5F, kWhite);
+    REQUIRE(batches.End().quads == 1);
+
+    const Batches::DrawPacket &draw{gpu.draws.front()};
+    REQUIRE(gpu.Vertex(draw, 0).position == std::array<float, 2>{0.0F, 0.25F});
+    REQUIRE(gpu.Vertex(draw, 1).position ==
+            std::array<float, 2>{0.0F, -0.25F});
+    REQUIRE(gpu.Vertex(draw, 2).position ==
+            std::array<float, 2>{1.0F, -0.25F});
+}
+
+TEST_CASE("Batch renderer throughput", "[.][benchmark][batch_renderer]")
+{
+    constexpr uint32_t kQuads{10000};
+    const FakeObject state{'S'};
+    FakeGpu gpu{};
+    Batches batches{};
+    gpu.Initialise(batches, kQuads, 4096);
+
+    // What an overlay does each frame, with uploads copied into memory
+    const auto draw_frame{[&]() {
+        gpu.draws.clear();
+        batches.Begin(1);
+        batches.SetState(&state, &state);
+        for (uint32_t quad{0}; quad < kQuads; ++quad)
+        {
+            const float x{static_cast<float>(quad % 100) * 0.02F - 1.0F};
+            const float y{static_cast<float>(quad / 100) * 0.02F - 1.0F};
+            batches.Quad(x, y, x + 0.01F, y + 0.01F, kWhite);
+        }
+        return batches.End().quads;
+    }};
+
+    BENCHMARK("10000 quads")
+    {
+        return draw_frame();
+    };
+
+    constexpr int kFrames{200};
+    const auto start{std::chrono::steady_clock::now()};
+    uint64_t quads{0};
+    for (int frame{0}; frame < kFrames; ++frame)
+    {
+        quads += draw_frame();
+    }
+    const std::chrono::duration<double, std::milli> elapsed{
+        std::chrono::steady_clock::now() - start};
+    WARN(fmt::format("{:.0f} quads per millisecond",
+                     static_cast<double>(quads) / elapsed.count()));
+}
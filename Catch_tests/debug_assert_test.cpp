@@ -0,0 +1,109 @@
+// Keep the checks compiled in, whatever the build type
+#define LEARNWEBGPU_CHECKED_RELEASE
+#include "debug_assert.h"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_string.hpp>
+#include <fmt/format.h>
+
+#include <array>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace
+{
+// The previous, eager, implementation kept for comparison: the exception and
+// its formatted message are built on every call
+template <typename T, typename E = std::exception>
+inline void legacy_dbg_assert(T &&assertion, const E throwing = {})
+{
+    if (!std::forward<T>(assertion))
+    {
+        throw throwing;
+    }
+}
+
+// Stand-in for the Application members MainLoop checks each frame
+struct FrameState
+{
+    std::optional<int> queue{1};
+    std::optional<int> target_view{1};
+    std::optional<int> device{1};
+    std::optional<int> point_buffer{1};
+    std::optional<int> index_buffer{1};
+    std::optional<int> bind_group{1};
+    std::optional<int> surface{1};
+};
+
+std::string counted_message(int &evaluations)
+{
+    ++evaluations;
+    return "Message";
+}
+} // namespace
+
+TEST_CASE("It does not build the message when the check passes",
+          "[debug_assert]")
+{
+    int evaluations{0};
+    debug_assert(evaluations == 0, counted_message(evaluations));
+    REQUIRE(evaluations == 0);
+}
+
+TEST_CASE("It throws with the message and location when the check fails",
+          "[debug_assert]")
+{
+    const std::optional<int> missing{std::nullopt};
+    REQUIRE_THROWS_AS(debug_assert(missing.has_value(), "Value should be set"),
+                      std::runtime_error);
+    REQUIRE_THROWS_WITH(
+        debug_assert(missing.has_value(), "Value should be set"),
+        Catch::Matchers::StartsWith("Value should be set") &&
+            Catch::Matchers::ContainsSubstring("missing.has_value()") &&
+            Catch::Matchers::ContainsSubstring("debug_assert_test.cpp"));
+}
+
+TEST_CASE("MainLoop assertion cost", "[.][benchmark][debug_assert]")
+{
+    const FrameState state{};
+    // The checks MainLoop makes each frame, in order
+    const std::array<const std::optional<int> *, 8> frame_checks{
+        &state.queue,
+        &state.target_view,
+        &state.device,
+        &state.point_buffer,
+        &state.index_buffer,
+        &state.bind_group,
+        &state.queue,
+        &state.surface};
+
+    BENCHMARK("eager legacy debug_assert")
+    {
+        for (const std::optional<int> *check : frame_checks)
+        {
+            legacy_dbg_assert(
+                check->has_value(),
+                std::runtime_error(fmt::format("Member should be initialised "
+                                               "before entering the main "
+                                               "loop: [{}:{}]",
+                                               __FILE__,
+                                               __LINE__)));
+        }
+        return frame_checks.size();
+    };
+
+    BENCHMARK("lazy debug_assert")
+    {
+        for (const std::optional<int> *check : frame_checks)
+        {
+            debug_assert(check->has_value(),
+                         "Member should be initialised before entering the "
+                         "main loop");
+        }
+        return frame_checks.size();
+    };
+}
@@ -0,0 +1,19 @@
+#ifndef CATCH_TESTS_FAKE_WEBGPU_H
+#define CATCH_TESTS_FAKE_WEBGPU_H
+
+// Stand-ins for WebGPU objects: handles are pointers to them
+struct FakeObject
+{
+    char name{};
+};
+
+// Handle types for code templated on them, such as RenderQueue
+struct FakeTypes
+{
+    using Pipeline = const FakeObject *;
+    using BindGroup = const FakeObject *;
+    using Buffer = const FakeObject *;
+    using IndexFormat = int;
+};
+
+#endif
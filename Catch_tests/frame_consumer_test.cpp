@@ -0,0 +1,114 @@
+#include "utilities/frame_consumer.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace
+{
+ReadbackFrame MakeFrame(uint64_t frame_index)
+{
+    return ReadbackFrame{frame_index, 1, 1, PixelOrder::RGBA, {1, 2, 3, 4}};
+}
+} // namespace
+
+TEST_CASE("It pads rows to the copy alignment and strips the padding",
+          "[frame_consumer]")
+{
+    REQUIRE(PaddedBytesPerRow(1) == 256);
+    REQUIRE(PaddedBytesPerRow(64) == 256);
+    REQUIRE(PaddedBytesPerRow(65) == 512);
+    REQUIRE(PaddedBytesPerRow(640) == 2560);
+
+    // Two rows of two pixels, each row padded out to 256 bytes
+    std::vector<uint8_t> padded(2 * 256, 0xFF);
+    for (uint8_t byte{0}; byte < 8; ++byte)
+    {
+        padded.at(byte) = byte;
+        padded.at(256U + byte) = static_cast<uint8_t>(byte + 8);
+    }
+    ReadbackFrame frame{0, 2, 2, PixelOrder::RGBA, {}};
+    UnpadRows(padded.data(), 256, frame);
+    REQUIRE(frame.pixels.size() == 16);
+    for (uint8_t byte{0}; byte < 16; ++byte)
+    {
+        REQUIRE(frame.pixels.at(byte) == byte);
+    }
+}
+
+TEST_CASE("It writes frames as PPM in RGB order", "[frame_consumer]")
+{
+    const std::filesystem::path path{std::filesystem::temp_directory_path() /
+                                     "frame_consumer_test.ppm"};
+    // One blue-green-red-alpha pixel
+    const ReadbackFrame frame{7, 1, 1, PixelOrder::BGRA, {30, 20, 10, 255}};
+    REQUIRE(WritePpm(path, frame));
+
+    std::ifstream file{path, std::ios::binary};
+    const std::string contents{std::istreambuf_iterator<char>{file}, {}};
+    REQUIRE(contents == std::string{"P6\n1 1\n255\n\x0a\x14\x1e"});
+    file.close();
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("It drops frames while the queue is full", "[frame_consumer]")
+{
+    std::mutex mutex{};
+    std::condition_variable released{};
+    bool blocked{true};
+    std::vector<uint64_t> consumed{};
+
+    FrameConsumer consumer{};
+    consumer.Start(
+        [&](const ReadbackFrame &frame) {
+            std::unique_lock<std::mutex> lock{mutex};
+            released.wait(lock, [&]() { return !blocked; });
+            consumed.push_back(frame.frame_index);
+        },
+        2);
+
+    // At most one frame being consumed and two queued; the rest are dropped
+    uint64_t accepted{0};
+    for (uint64_t frame{0}; frame < 6; ++frame)
+    {
+        accepted += consumer.Push(MakeFrame(frame)) ? 1U : 0U;
+    }
+    REQUIRE(accepted >= 2);
+    REQUIRE(accepted <= 3);
+    REQUIRE(consumer.Dropped() == 6 - accepted);
+
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        blocked = false;
+    }
+    released.notify_all();
+    // Stopping consumes everything already queued
+    consumer.Stop();
+    REQUIRE(consumer.Consumed() == accepted);
+    REQUIRE(consumed.size() == accepted);
+    REQUIRE(consumed.front() == 0);
+    REQUIRE_FALSE(consumer.Push(MakeFrame(6)));
+}
+
+TEST_CASE("It hands back consumed buffers for reuse", "[frame_consumer]")
+{
+    FrameConsumer consumer{};
+    consumer.Start([](const ReadbackFrame &) {}, 1);
+    REQUIRE(consumer.SpareBuffer().capacity() == 0);
+
+    ReadbackFrame frame{0, 256, 256, PixelOrder::RGBA, {}};
+    frame.pixels.resize(size_t{256} * 256 * 4);
+    REQUIRE(consumer.Push(std::move(frame)));
+    consumer.Stop();
+
+    const std::vector<uint8_t> spare{consumer.SpareBuffer()};
+    REQUIRE(spare.empty());
+    REQUIRE(spare.capacity() >= size_t{256} * 256 * 4);
+}
@@ -0,0 +1,85 @@
+#include "utilities/frame_scheduler.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <optional>
+#include <string>
+
+TEST_CASE("It draws on demand only when the scene is dirty",
+          "[frame_scheduler]")
+{
+    FrameScheduler scheduler{};
+    scheduler.Initialise(RenderMode::OnDemand);
+    REQUIRE(scheduler.NeedsFrame());
+    scheduler.FrameRendered();
+    REQUIRE_FALSE(scheduler.NeedsFrame());
+
+    scheduler.MarkDirty(Damage::Input);
+    scheduler.MarkDirty(Damage::Asset);
+    REQUIRE(scheduler.NeedsFrame());
+    REQUIRE(scheduler.FrameRendered() ==
+            (static_cast<uint8_t>(Damage::Input) |
+             static_cast<uint8_t>(Damage::Asset)));
+    REQUIRE_FALSE(scheduler.NeedsFrame());
+}
+
+TEST_CASE("It always draws in continuous mode", "[frame_scheduler]")
+{
+    FrameScheduler scheduler{};
+    scheduler.Initialise(RenderMode::Continuous);
+    scheduler.FrameRendered();
+    REQUIRE(scheduler.NeedsFrame());
+}
+
+TEST_CASE("It reports utilisation once per interval", "[frame_scheduler]")
+{
+    using namespace std::chrono_literals;
+    UtilisationMonitor monitor{};
+    const auto start{UtilisationMonitor::Clock::now()};
+    REQUIRE_FALSE(monitor.Sample(start, 1s).has_value());
+
+    monitor.FrameRendered(4);
+    monitor.FrameRendered(4);
+    REQUIRE_FALSE(monitor.Sample(start + 1s, 1.5s).has_value());
+    const std::optional<std::string> active{
+        monitor.Sample(start + ReportTimer::kInterval, 6s)};
+    REQUIRE(active.has_value());
+    REQUIRE(active.value() == "Active: 2 frames drawn in 10.0 s, 8 bytes "
+                              "uploaded, CPU 50.0% of one core");
+
+    const std::optional<std::string> idle{
+        monitor.Sample(start + 2 * ReportTimer::kInterval, 6s)};
+    REQUIRE(idle.has_value());
+    REQUIRE(idle.value().rfind("Idle: 0 frames", 0) == 0);
+}
+
+TEST_CASE("It measures frame jitter and input latency", "[frame_scheduler]")
+{
+    using namespace std::chrono_literals;
+    FrameTimingMonitor monitor{};
+    const auto start{FrameTimingMonitor::Clock::now()};
+    REQUIRE_FALSE(monitor.Sample(start).has_value());
+
+    // Intervals of 10 and 20 ms, then a gap that is not counted
+    monitor.InputHandled(start - 5ms);
+    monitor.FramePresented(start);
+    monitor.FramePresented(start + 10ms);
+    monitor.InputHandled(start + 12ms);
+    monitor.InputHandled(start + 20ms);
+    monitor.FramePresented(start + 30ms);
+    monitor.FrameSkipped();
+    monitor.FramePresented(start + 1s);
+
+    const std::optional<std::string> report{
+        monitor.Sample(start + ReportTimer::kInterval)};
+    REQUIRE(report.has_value());
+    REQUIRE(report.value() ==
+            "Frame timing: 2 intervals, mean 15.00 ms, jitter 5.00 ms, worst "
+            "20.00 ms; input latency mean 11.00 ms, worst 18.00 ms over 3 "
+            "events");
+
+    // Nothing measured, so nothing to report
+    REQUIRE_FALSE(
+        monitor.Sample(start + 2 * ReportTimer::kInterval).has_value());
+}
@@ -0,0 +1,104 @@
+#include "utilities/frame_trace.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+using Op = FrameTraceFormat::Op;
+
+std::string_view as_string_view(const std::vector<uint8_t> &bytes)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return {reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+}
+} // namespace
+
+TEST_CASE("It round-trips command payloads", "[frame_trace]")
+{
+    const std::string bytes{"\x01\x02\x00\x03", 4};
+    TracePayloadWriter writer{};
+    writer.Write(uint32_t{7})
+        .Write(FrameTraceFormat::BindingKind::Sampler)
+        .Write(int32_t{-3})
+        .Write(0.25F)
+        .Write(4.0 / 3.0)
+        .WriteString("vs_main")
+        .WriteBytes(bytes.data(), bytes.size());
+
+    TracePayloadReader reader{as_string_view(writer.data())};
+    REQUIRE(reader.Read<uint32_t>() == 7);
+    REQUIRE(static_cast<FrameTraceFormat::BindingKind>(
+                reader.Read<uint8_t>()) ==
+            FrameTraceFormat::BindingKind::Sampler);
+    REQUIRE(reader.Read<int32_t>() == -3);
+    REQUIRE(reader.Read<float>() == 0.25F);
+    REQUIRE(reader.Read<double>() == 4.0 / 3.0);
+    REQUIRE(reader.ReadString() == "vs_main");
+    REQUIRE(reader.ReadBytes() == bytes);
+    REQUIRE(reader.ok());
+
+    // Reading past the end is reported, not undefined
+    REQUIRE(reader.Read<uint32_t>() == 0);
+    REQUIRE_FALSE(reader.ok());
+}
+
+TEST_CASE("It writes and reads back a trace file", "[frame_trace]")
+{
+    const std::filesystem::path path{std::filesystem::temp_directory_path() /
+                                     "frame_trace_test.trace"};
+    FrameTraceWriter writer{};
+    REQUIRE(writer.Open(path));
+    TracePayloadWriter frame{};
+    frame.Write(uint32_t{0});
+    writer.Write(Op::BeginFrame, frame);
+    writer.Write(Op::EndFrame, TracePayloadWriter{});
+    REQUIRE(writer.BytesWritten() ==
+            FrameTraceFormat::kHeaderSize +
+                2 * FrameTraceFormat::kCommandHeaderSize + sizeof(uint32_t));
+    writer.Close();
+    REQUIRE_FALSE(writer.IsOpen());
+
+    {
+        std::optional<FrameTraceReader> reader{FrameTraceReader::Open(path)};
+        REQUIRE(reader.has_value());
+        FrameTraceReader::Command command{};
+        for (int pass{0}; pass < 2; ++pass)
+        {
+            REQUIRE(reader.value().Next(command));
+            REQUIRE(command.op == Op::BeginFrame);
+            REQUIRE(command.payload.size() == sizeof(uint32_t));
+            REQUIRE(reader.value().Next(command));
+            REQUIRE(command.op == Op::EndFrame);
+            REQUIRE(command.payload.empty());
+            REQUIRE_FALSE(reader.value().Next(command));
+            reader.value().Rewind();
+        }
+    }
+    std::filesystem::remove(path);
+}
+
+TEST_CASE("It rejects malformed traces", "[frame_trace]")
+{
+    REQUIRE_FALSE(FrameTraceReader::FromMemory({"LWFX\x01\x00\x00\x00", 8}));
+    REQUIRE_FALSE(FrameTraceReader::FromMemory("LWFT"));
+
+    // An unknown opcode, then a command whose payload is cut short
+    const std::string trace{"LWFT\x01\x00\x00\x00"
+                            "\xc8\x01\x00\x00\x00\x2a"
+                            "\x0a\x04\x00\x00\x00\x00",
+                            20};
+    std::optional<FrameTraceReader> reader{FrameTraceReader::FromMemory(trace)};
+    REQUIRE(reader.has_value());
+    FrameTraceReader::Command command{};
+    REQUIRE(reader.value().Next(command));
+    REQUIRE(static_cast<uint8_t>(command.op) == 0xc8);
+    REQUIRE(command.payload == "\x2a");
+    REQUIRE_FALSE(reader.value().Next(command));
+}
@@ -0,0 +1,95 @@
+#include "utilities/frames_in_flight.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <thread>
+
+TEST_CASE("It hands out frame slots in turn", "[frames_in_flight]")
+{
+    FramesInFlight frames{};
+    frames.Initialise(3);
+    const auto now{FramesInFlight::Clock::now()};
+    for (uint32_t frame{0}; frame < 7; ++frame)
+    {
+        REQUIRE(frames.TryAcquire() == frame % 3);
+        frames.Submitted(now);
+        frames.Completed(now);
+    }
+
+    // The limit is clamped to what per-frame resources are made for
+    frames.Initialise(0);
+    REQUIRE(frames.Limit() == 1);
+    frames.Initialise(100);
+    REQUIRE(frames.Limit() == FramesInFlight::kMaxLimit);
+}
+
+TEST_CASE("It holds the CPU back at the limit", "[frames_in_flight]")
+{
+    FramesInFlight frames{};
+    frames.Initialise(2);
+    const auto now{FramesInFlight::Clock::now()};
+    static_cast<void>(frames.TryAcquire());
+    frames.Submitted(now);
+    static_cast<void>(frames.TryAcquire());
+    frames.Submitted(now);
+    REQUIRE(frames.InFlight() == 2);
+    REQUIRE_FALSE(frames.TryAcquire().has_value());
+
+    // Completions arrive while the device is polled
+    uint32_t polls{0};
+    const uint32_t slot{frames.Acquire([&]() {
+        if (++polls == 3)
+        {
+            frames.Completed(now);
+        }
+    })};
+    REQUIRE(polls == 3);
+    REQUIRE(slot == 0);
+    REQUIRE(frames.InFlight() == 1);
+}
+
+TEST_CASE("It wakes when another thread reports completion",
+          "[frames_in_flight]")
+{
+    using namespace std::chrono_literals;
+    FramesInFlight frames{};
+    frames.Initialise(1);
+    static_cast<void>(frames.TryAcquire());
+    frames.Submitted(FramesInFlight::Clock::now());
+
+    std::thread gpu{[&frames]() {
+        std::this_thread::sleep_for(5ms);
+        frames.Completed(FramesInFlight::Clock::now());
+    }};
+    REQUIRE(frames.Acquire([]() {}) == 0);
+    gpu.join();
+    REQUIRE(frames.InFlight() == 0);
+}
+
+TEST_CASE("It reports throughput and latency", "[frames_in_flight]")
+{
+    using namespace std::chrono_literals;
+    FramesInFlight frames{};
+    frames.Initialise(2);
+    const auto start{FramesInFlight::Clock::now()};
+    REQUIRE_FALSE(frames.Sample(start).has_value());
+
+    frames.Submitted(start);
+    frames.Submitted(start + 1ms);
+    frames.Completed(start + 4ms);
+    frames.Completed(start + 7ms);
+    const std::optional<std::string> report{
+        frames.Sample(start + ReportTimer::kInterval)};
+    REQUIRE(report.has_value());
+    REQUIRE(report.value() ==
+            "Frames in flight (limit 2): 0.2 frames/s, up to 2 in flight, 0 "
+            "throttled waiting 0.00 ms on average, worst 0.00 ms; submit to "
+            "GPU done mean 5.00 ms, worst 6.00 ms");
+
+    REQUIRE_FALSE(
+        frames.Sample(start + 2 * ReportTimer::kInterval).has_value());
+}
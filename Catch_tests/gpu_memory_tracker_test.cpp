@@ -0,0 +1,86 @@
+#include "utilities/gpu_memory_tracker.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace
+{
+size_t index_of(GpuObjectCategory category)
+{
+    return static_cast<size_t>(category);
+}
+} // namespace
+
+TEST_CASE("It keeps live totals and a high-water mark", "[gpu_memory]")
+{
+    // Stand-ins for object handles
+    std::array<int, 3> objects{};
+    GpuMemoryTracker tracker{};
+    tracker.Track(&objects[0],
+                  GpuObjectCategory::Buffer,
+                  "Vertices",
+                  1'024,
+                  0x20,
+                  GPU_CALL_SITE);
+    tracker.Track(&objects[1],
+                  GpuObjectCategory::Texture,
+                  "texture.ppm",
+                  4'096,
+                  0x4,
+                  GPU_CALL_SITE);
+    tracker.Track(
+        &objects[2], GpuObjectCategory::Pipeline, "Pipeline", 0, 0, {});
+
+    GpuMemoryTotals totals{tracker.Totals()};
+    REQUIRE(totals.total_bytes == 5'120);
+    REQUIRE(totals.bytes[index_of(GpuObjectCategory::Texture)] == 4'096);
+    REQUIRE(totals.objects[index_of(GpuObjectCategory::Pipeline)] == 1);
+
+    tracker.Untrack(&objects[1]);
+    // Untracking twice, or something never tracked, changes nothing
+    tracker.Untrack(&objects[1]);
+    tracker.Untrack(nullptr);
+    totals = tracker.Totals();
+    REQUIRE(totals.total_bytes == 1'024);
+    REQUIRE(totals.objects[index_of(GpuObjectCategory::Texture)] == 0);
+    REQUIRE(totals.high_water_mark == 5'120);
+}
+
+TEST_CASE("It reports the objects still alive", "[gpu_memory]")
+{
+    std::array<int, 2> objects{};
+    GpuMemoryTracker tracker{};
+    tracker.Track(
+        &objects[0], GpuObjectCategory::BindGroup, "Bind group", 0, 0, {});
+    const GpuCallSite call_site{GPU_CALL_SITE};
+    tracker.Track(&objects[1],
+                  GpuObjectCategory::Buffer,
+                  "Uniform buffer",
+                  32,
+                  0x48,
+                  call_site);
+
+    const std::vector<GpuAllocation> leaks{tracker.LiveObjects()};
+    REQUIRE(leaks.size() == 2);
+    REQUIRE(leaks[0].label == "Uniform buffer");
+    REQUIRE(GpuMemoryTracker::Describe(leaks[0]) ==
+            "`Uniform buffer` [buffers] 32 bytes, usage 0x48, created at "
+            "gpu_memory_tracker_test.cpp:" +
+                std::to_string(call_site.line));
+    REQUIRE(tracker.Summary().find("1 bind groups (0 bytes)") !=
+            std::string::npos);
+}
+
+TEST_CASE("It rate limits the summary", "[gpu_memory]")
+{
+    GpuMemoryTracker tracker{};
+    const auto start{std::chrono::steady_clock::now()};
+    REQUIRE(tracker.IsSummaryDue(start));
+    REQUIRE_FALSE(tracker.IsSummaryDue(start + std::chrono::seconds{1}));
+    REQUIRE(tracker.IsSummaryDue(start + ReportTimer::kInterval));
+}
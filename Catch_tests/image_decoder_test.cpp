@@ -0,0 +1,158 @@
+#include "utilities/image_decoder.h"
+#include "utilities/resource_pack.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace
+{
+// Little-endian, as `.ctex` stores it
+void append_u32(std::string &bytes, uint32_t value)
+{
+    for (uint32_t byte{0}; byte < 4; ++byte)
+    {
+        bytes.push_back(static_cast<char>((value >> (8U * byte)) & 0xFFU));
+    }
+}
+
+// A `.ctex` header for a BC7 image, without any level data
+std::string compressed_header(uint32_t width,
+                              uint32_t height,
+                              uint32_t level_count)
+{
+    std::string bytes{"CTEX"};
+    append_u32(bytes, 0);
+    append_u32(bytes, width);
+    append_u32(bytes, height);
+    append_u32(bytes, level_count);
+    return bytes;
+}
+} // namespace
+
+TEST_CASE("It decodes binary PPM images to RGBA8", "[image_decoder]")
+{
+    ImageDecodeError error{ImageDecodeError::Truncated};
+    const std::optional<ImageData> image{ImageDecoder::DecodePpm(
+        ResourceBlob{std::string{"P6\n2 1\n255\n\x01\x02\x03\x04\x05\x06"}},
+        error)};
+    REQUIRE(image.has_value());
+    REQUIRE(error == ImageDecodeError::None);
+    REQUIRE(image->width == 2);
+    REQUIRE(image->height == 1);
+    REQUIRE(image->format == ImageFormat::Rgba8);
+    REQUIRE(image->levels ==
+            std::vector<std::vector<uint8_t>>{{1, 2, 3, 255, 4, 5, 6, 255}});
+}
+
+TEST_CASE("It skips comment lines in PPM headers", "[image_decoder]")
+{
+    ImageDecodeError error{ImageDecodeError::None};
+    const std::optional<ImageData> image{ImageDecoder::DecodePpm(
+        ResourceBlob{std::string{"P6\n# made by hand\n1 # wide\n1\n"
+                                 "# deep\n255\n\x07\x08\x09"}},
+        error)};
+    REQUIRE(image.has_value());
+    REQUIRE(image->levels ==
+            std::vector<std::vector<uint8_t>>{{7, 8, 9, 255}});
+}
+
+TEST_CASE("It rejects malformed PPM images", "[image_decoder]")
+{
+    auto decode_error{[](std::string bytes, uint32_t max_dimension) {
+        ImageDecodeError error{ImageDecodeError::None};
+        const std::optional<ImageData> image{ImageDecoder::DecodePpm(
+            ResourceBlob{std::move(bytes)}, error, max_dimension)};
+        REQUIRE_FALSE(image.has_value());
+        return error;
+    }};
+    constexpr uint32_t kMax{ImageDecoder::kDefaultMaxDimension};
+
+    REQUIRE(decode_error("P3\n1 1\n255\n1 2 3", kMax) ==
+            ImageDecodeError::BadMagic);
+    REQUIRE(decode_error("", kMax) == ImageDecodeError::BadMagic);
+    REQUIRE(decode_error("P6\n1 1\n65535\n\x01\x02\x03", kMax) ==
+            ImageDecodeError::UnsupportedFormat);
+    REQUIRE(decode_error("P6\nwide 1\n255\n", kMax) ==
+            ImageDecodeError::MalformedHeader);
+    REQUIRE(decode_error("P6\n2 2\n255\n\x01\x02\x03", kMax) ==
+            ImageDecodeError::Truncated);
+
+    // Empty, too large for the device, or promising far more than it holds
+    REQUIRE(decode_error("P6\n0 4\n255\n", kMax) == ImageDecodeError::BadSize);
+    REQUIRE(decode_error("P6\n4 0\n255\n", kMax) == ImageDecodeError::BadSize);
+    REQUIRE(decode_error("P6\n17 1\n255\n", 16) == ImageDecodeError::BadSize);
+    REQUIRE(decode_error("P6\n8192 8192\n255\n\x01", kMax) ==
+            ImageDecodeError::Truncated);
+}
+
+TEST_CASE("It reads every level of compressed textures", "[image_decoder]")
+{
+    std::string bytes{compressed_header(8, 4, 2)};
+    // 2x1 blocks, then 1x1
+    append_u32(bytes, 32);
+    bytes.append(32, 'a');
+    append_u32(bytes, 16);
+    bytes.append(16, 'b');
+
+    ImageDecodeError error{ImageDecodeError::Truncated};
+    const std::optional<ImageData> image{
+        ImageDecoder::DecodeCompressed(ResourceBlob{bytes}, error)};
+    REQUIRE(image.has_value());
+    REQUIRE(error == ImageDecodeError::None);
+    REQUIRE(image->format == ImageFormat::Bc7);
+    REQUIRE(image->width == 8);
+    REQUIRE(image->height == 4);
+    REQUIRE(image->levels.size() == 2);
+    REQUIRE(image->levels[0] == std::vector<uint8_t>(32, 'a'));
+    REQUIRE(image->levels[1] == std::vector<uint8_t>(16, 'b'));
+}
+
+TEST_CASE("It rejects malformed compressed textures", "[image_decoder]")
+{
+    auto decode_error{[](std::string bytes) {
+        ImageDecodeError error{ImageDecodeError::None};
+        const std::optional<ImageData> image{ImageDecoder::DecodeCompressed(
+            ResourceBlob{std::move(bytes)}, error)};
+        REQUIRE_FALSE(image.has_value());
+        return error;
+    }};
+
+    REQUIRE(decode_error("KTX 1") == ImageDecodeError::BadMagic);
+    std::string unknown_format{"CTEX"};
+    append_u32(unknown_format, 3);
+    REQUIRE(decode_error(unknown_format) ==
+            ImageDecodeError::UnsupportedFormat);
+    REQUIRE(decode_error(compressed_header(4, 4, 0).substr(0, 12)) ==
+            ImageDecodeError::Truncated);
+
+    // A 4x4 image only has levels down to 1x1
+    REQUIRE(decode_error(compressed_header(4, 4, 4)) ==
+            ImageDecodeError::MalformedHeader);
+    REQUIRE(decode_error(compressed_header(4, 4, 0)) ==
+            ImageDecodeError::MalformedHeader);
+    REQUIRE(decode_error(compressed_header(6, 4, 1)) ==
+            ImageDecodeError::MalformedHeader);
+    REQUIRE(decode_error(compressed_header(0, 4, 1)) ==
+            ImageDecodeError::BadSize);
+    REQUIRE(decode_error(compressed_header(16'384, 4, 1)) ==
+            ImageDecodeError::BadSize);
+
+    // A level claiming nearly 4 GB is rejected before it is allocated
+    std::string huge_level{compressed_header(4, 4, 1)};
+    append_u32(huge_level, UINT32_MAX);
+    huge_level.append(16, 'a');
+    REQUIRE(decode_error(huge_level) == ImageDecodeError::Truncated);
+}
+
+TEST_CASE("It counts mip levels down to 1x1", "[image_decoder]")
+{
+    REQUIRE(ImageDecoder::MipLevelCount(1, 1) == 1);
+    REQUIRE(ImageDecoder::MipLevelCount(2, 1) == 2);
+    REQUIRE(ImageDecoder::MipLevelCount(256, 256) == 9);
+    REQUIRE(ImageDecoder::MipLevelCount(300, 20) == 9);
+    REQUIRE(ImageDecoder::MipLevelCount(1, 8'192) == 14);
+}
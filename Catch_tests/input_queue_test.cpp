@@ -0,0 +1,108 @@
+#include "utilities/input_queue.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <thread>
+
+TEST_CASE("It passes values through in order until full", "[input_queue]")
+{
+    SpscQueue<int, 4> queue{};
+    REQUIRE(queue.Empty());
+    for (int value{0}; value < 4; ++value)
+    {
+        REQUIRE(queue.Push(value));
+    }
+    REQUIRE_FALSE(queue.Push(4));
+
+    REQUIRE(queue.Pop() == 0);
+    REQUIRE(queue.Push(4));
+    for (int value{1}; value < 5; ++value)
+    {
+        REQUIRE(queue.Pop() == value);
+    }
+    REQUIRE_FALSE(queue.Pop().has_value());
+    REQUIRE(queue.Empty());
+}
+
+TEST_CASE("It hands values between two threads", "[input_queue]")
+{
+    constexpr uint64_t kValues{10000};
+    SpscQueue<uint64_t, 64> queue{};
+    std::thread producer{[&queue]() {
+        for (uint64_t value{0}; value < kValues;)
+        {
+            if (queue.Push(value))
+            {
+                ++value;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }};
+
+    // Every value arrives once, in order
+    uint64_t expected{0};
+    uint64_t out_of_order{0};
+    while (expected < kValues)
+    {
+        const std::optional<uint64_t> value{queue.Pop()};
+        if (value.has_value())
+        {
+            out_of_order += value.value() == expected ? 0U : 1U;
+            ++expected;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    REQUIRE(out_of_order == 0);
+    REQUIRE(queue.Empty());
+}
+
+TEST_CASE("It keeps the latest size and close requests apart from events",
+          "[input_queue]")
+{
+    InputQueue input{};
+    REQUIRE_FALSE(input.HasPending());
+
+    for (size_t event{0}; event <= InputQueue::kCapacity; ++event)
+    {
+        input.Push(InputEvent{});
+    }
+    REQUIRE(input.Dropped() == 1);
+
+    // Resizes and closing still get through a full queue
+    input.Resize(640, 480);
+    input.Resize(800, 600);
+    input.RequestClose();
+    REQUIRE(input.TakeResize() == InputQueue::Size{800, 600});
+    REQUIRE_FALSE(input.TakeResize().has_value());
+    REQUIRE(input.IsCloseRequested());
+    REQUIRE(input.Pop().has_value());
+}
+
+TEST_CASE("It wakes a sleeping consumer", "[input_queue]")
+{
+    using namespace std::chrono_literals;
+    InputQueue input{};
+    std::thread producer{[&input]() {
+        std::this_thread::sleep_for(10ms);
+        InputEvent event{};
+        event.kind = InputKind::Scroll;
+        input.Push(event);
+    }};
+
+    const auto start{std::chrono::steady_clock::now()};
+    input.WaitFor(10s);
+    REQUIRE(std::chrono::steady_clock::now() - start < 5s);
+    const std::optional<InputEvent> event{input.Pop()};
+    REQUIRE(event.has_value());
+    REQUIRE(event.value().kind == InputKind::Scroll);
+    producer.join();
+}
@@ -0,0 +1,126 @@
+#include "utilities/object_cache.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+namespace
+{
+// Stand-ins for GPU objects: handles are pointers to them
+struct FakeObject
+{
+    bool alive{false};
+};
+
+using FakeCache = DeduplicatingCache<FakeObject *>;
+
+// Creates objects out of a fixed pool, counting the creation calls
+struct FakeDevice
+{
+    std::array<FakeObject, 8> objects{};
+    size_t created{0};
+
+    FakeCache::Factory Factory()
+    {
+        return [this]() {
+            FakeObject *object{&objects.at(created++)};
+            object->alive = true;
+            return FakeCache::Created{object,
+                                      [object]() { object->alive = false; }};
+        };
+    }
+};
+
+ObjectKey Key(uint32_t binding)
+{
+    ObjectKey key{};
+    key.Add(binding).AddString("vs_main");
+    return key;
+}
+} // namespace
+
+TEST_CASE("It returns the same object for identical keys", "[object_cache]")
+{
+    FakeDevice device{};
+    FakeCache cache{};
+    FakeObject *first{cache.Acquire(Key(0), device.Factory())};
+    FakeObject *second{cache.Acquire(Key(0), device.Factory())};
+    FakeObject *other{cache.Acquire(Key(1), device.Factory())};
+
+    REQUIRE(first == second);
+    REQUIRE(first != other);
+    REQUIRE(device.created == 2);
+
+    const ObjectCacheStats stats{cache.Stats()};
+    REQUIRE(stats.requests == 3);
+    REQUIRE(stats.hits == 1);
+    REQUIRE(stats.creations == 2);
+    REQUIRE(stats.referenced == 2);
+    REQUIRE(stats.HitRate() == 1.0 / 3.0);
+}
+
+TEST_CASE("It keeps unreferenced objects until evicted", "[object_cache]")
+{
+    FakeDevice device{};
+    FakeCache cache{};
+    cache.SetCapacity(1);
+    FakeObject *first{cache.Acquire(Key(0), device.Factory())};
+    FakeObject *second{cache.Acquire(Key(1), device.Factory())};
+
+    // Still referenced once, so nothing is idle yet
+    static_cast<void>(cache.Acquire(Key(0), device.Factory()));
+    REQUIRE(cache.Release(first));
+    REQUIRE(first->alive);
+    REQUIRE(cache.Stats().unreferenced == 0);
+
+    // Idle objects are handed out again without being recreated
+    REQUIRE(cache.Release(first));
+    REQUIRE(first->alive);
+    REQUIRE(cache.Acquire(Key(0), device.Factory()) == first);
+    REQUIRE(device.created == 2);
+
+    // Over capacity, the least recently released goes first
+    REQUIRE(cache.Release(first));
+    REQUIRE(cache.Release(second));
+    REQUIRE_FALSE(first->alive);
+    REQUIRE(second->alive);
+    REQUIRE(cache.Stats().evictions == 1);
+
+    REQUIRE(cache.Acquire(Key(0), device.Factory()) != first);
+    REQUIRE(device.created == 3);
+}
+
+TEST_CASE("It ignores handles it does not own, and clears", "[object_cache]")
+{
+    FakeDevice device{};
+    FakeCache cache{};
+    FakeObject stranger{};
+    REQUIRE_FALSE(cache.Release(&stranger));
+
+    FakeObject *object{cache.Acquire(Key(0), device.Factory())};
+    cache.Clear();
+    REQUIRE_FALSE(object->alive);
+    REQUIRE_FALSE(cache.Release(object));
+    REQUIRE(cache.Stats().referenced == 0);
+}
+
+TEST_CASE("It builds keys from every field", "[object_cache]")
+{
+    REQUIRE(Key(0).str() == Key(0).str());
+    REQUIRE(Key(0).str() != Key(1).str());
+
+    ObjectKey empty{};
+    empty.AddString("");
+    ObjectKey null{};
+    null.AddString(nullptr);
+    REQUIRE(empty.str() != null.str());
+
+    // Strings are length-prefixed, so fields cannot run into each other
+    ObjectKey split{};
+    split.AddString("ab").AddString("c");
+    ObjectKey joined{};
+    joined.AddString("a").AddString("bc");
+    REQUIRE(split.str() != joined.str());
+}
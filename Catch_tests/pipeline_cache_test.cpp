@@ -0,0 +1,74 @@
+#include "utilities/pipeline_cache.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <vector>
+
+namespace
+{
+// Stands in for a pipeline handle: the number of the factory call that made it
+struct FakePipeline
+{
+    int id{0};
+};
+} // namespace
+
+TEST_CASE("It creates each permutation once", "[pipeline_cache]")
+{
+    std::atomic<int> created{0};
+    std::vector<int> released{};
+    PipelinePermutationCache<FakePipeline> cache{};
+    auto factory{[&created](const PipelineConstants &) {
+        return FakePipeline{++created};
+    }};
+    auto release{[&released](FakePipeline &pipeline) {
+        released.push_back(pipeline.id);
+    }};
+    cache.Initialise(factory, release);
+
+    const PipelineConstants untextured{{"aspect_ratio", 4.0 / 3.0},
+                                       {"use_texture", 0.0}};
+    const PipelineConstants textured{{"use_texture", 1.0},
+                                     {"aspect_ratio", 4.0 / 3.0}};
+
+    REQUIRE(cache.Get(untextured).id == 1);
+    REQUIRE(cache.Get(untextured).id == 1);
+    REQUIRE(cache.Get(textured).id == 2);
+    REQUIRE(cache.Get(PipelineConstants{{"use_texture", 1.0},
+                                        {"aspect_ratio", 4.0 / 3.0}})
+                .id == 2);
+    REQUIRE(cache.size() == 2);
+    REQUIRE(cache.Misses() == 2);
+
+    cache.Terminate();
+    REQUIRE(released.size() == 2);
+    REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("It serves prewarmed permutations without a miss",
+          "[pipeline_cache]")
+{
+    std::atomic<int> created{0};
+    PipelinePermutationCache<FakePipeline> cache{};
+    auto factory{[&created](const PipelineConstants &) {
+        return FakePipeline{++created};
+    }};
+    cache.Initialise(factory, [](FakePipeline &) {});
+
+    const PipelineConstants textured{{"use_texture", 1.0}};
+    cache.Prewarm({textured, textured});
+    REQUIRE(cache.Contains(textured));
+
+    REQUIRE(cache.Get(textured).id == 1);
+    REQUIRE(cache.Misses() == 0);
+    REQUIRE(created == 1);
+    cache.Terminate();
+}
+
+TEST_CASE("It hashes constants by value", "[pipeline_cache]")
+{
+    const PipelineConstantsHash hash{};
+    REQUIRE(hash({{"a", 1.0}, {"b", 2.0}}) == hash({{"b", 2.0}, {"a", 1.0}}));
+    REQUIRE(hash({{"a", 1.0}}) != hash({{"a", 2.0}}));
+}
@@ -0,0 +1,124 @@
+#include "utilities/profiler.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// Records the debug groups pushed and popped on it
+struct FakeEncoder
+{
+    std::vector<std::string> calls{};
+
+    void pushDebugGroup(const char *label)
+    {
+        calls.push_back(std::string{"push "} + label);
+    }
+    void popDebugGroup()
+    {
+        calls.emplace_back("pop");
+    }
+};
+
+std::string ReadFile(const std::filesystem::path &path)
+{
+    std::ifstream file{path};
+    return {std::istreambuf_iterator<char>{file}, {}};
+}
+} // namespace
+
+TEST_CASE("It records zones only while enabled", "[profiler]")
+{
+    Profiler::SetEnabled(false);
+    Profiler::Collect();
+    Profiler::Clear();
+    {
+        const ProfileZone zone{"Disabled"};
+        REQUIRE_FALSE(zone.IsActive());
+    }
+    Profiler::Collect();
+    REQUIRE(Profiler::CollectedCount() == 0);
+
+    Profiler::SetEnabled(true);
+    {
+        const ProfileZone outer{"Outer"};
+        const ProfileZone inner{"Inner"};
+        REQUIRE(inner.IsActive());
+    }
+    Profiler::SetEnabled(false);
+    Profiler::Collect();
+    REQUIRE(Profiler::CollectedCount() == 2);
+    Profiler::Clear();
+}
+
+TEST_CASE("It mirrors zones into encoder debug groups", "[profiler]")
+{
+    FakeEncoder encoder{};
+    Profiler::SetEnabled(false);
+    {
+        const GpuProfileZone<FakeEncoder> zone{encoder, "Hidden"};
+    }
+    REQUIRE(encoder.calls.empty());
+
+    Profiler::SetEnabled(true);
+    {
+        const GpuProfileZone<FakeEncoder> pass{encoder, "Main pass"};
+        const GpuProfileZone<FakeEncoder> draw{encoder, "Draw"};
+    }
+    REQUIRE(encoder.calls == std::vector<std::string>{
+                                 "push Main pass", "push Draw", "pop", "pop"});
+
+    // Ending early pops the group once, and records the zone once
+    encoder.calls.clear();
+    Profiler::Collect();
+    Profiler::Clear();
+    {
+        GpuProfileZone<FakeEncoder> upload{encoder, "Upload"};
+        upload.End();
+        REQUIRE(encoder.calls ==
+                std::vector<std::string>{"push Upload", "pop"});
+    }
+    Profiler::SetEnabled(false);
+    REQUIRE(encoder.calls == std::vector<std::string>{"push Upload", "pop"});
+    Profiler::Collect();
+    REQUIRE(Profiler::CollectedCount() == 1);
+    Profiler::Clear();
+}
+
+TEST_CASE("It writes every thread's zones as trace events", "[profiler]")
+{
+    Profiler::Collect();
+    Profiler::Clear();
+    Profiler::SetEnabled(true);
+    std::thread worker{[]() {
+        Profiler::SetThreadName("Worker \"one\"");
+        const ProfileZone zone{"Decode"};
+    }};
+    worker.join();
+    {
+        const ProfileZone zone{"Upload"};
+    }
+    Profiler::SetEnabled(false);
+
+    const std::filesystem::path path{std::filesystem::temp_directory_path() /
+                                     "profiler_test.json"};
+    REQUIRE(Profiler::WriteTrace(path));
+    const std::string trace{ReadFile(path)};
+    std::filesystem::remove(path);
+
+    REQUIRE(trace.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) ==
+            0);
+    REQUIRE(trace.find("\"args\":{\"name\":\"Worker \\\"one\\\"\"}") !=
+            std::string::npos);
+    REQUIRE(trace.find("{\"name\":\"Decode\",\"cat\":\"cpu\",\"ph\":\"X\"") !=
+            std::string::npos);
+    REQUIRE(trace.find("{\"name\":\"Upload\"") != std::string::npos);
+    REQUIRE(trace.substr(trace.size() - 4) == "\n]}\n");
+    Profiler::Clear();
+}
@@ -0,0 +1,131 @@
+#include "fake_webgpu.h"
+#include "utilities/render_queue.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+// Writes down the commands it is given, one letter each
+struct FakeEncoder
+{
+    std::string commands{};
+
+    void setPipeline(const FakeObject *pipeline)
+    {
+        commands += 'P';
+        commands += pipeline->name;
+    }
+    void setBindGroup(uint32_t /* group */,
+                      const FakeObject *bind_group,
+                      size_t /* dynamic_offset_count */,
+                      const uint32_t * /* dynamic_offsets */)
+    {
+        commands += 'B';
+        commands += bind_group->name;
+    }
+    void setVertexBuffer(uint32_t /* slot */,
+                         const FakeObject *buffer,
+                         uint64_t /* offset */,
+                         uint64_t /* size */)
+    {
+        commands += 'V';
+        commands += buffer->name;
+    }
+    void setIndexBuffer(const FakeObject *buffer,
+                        int /* format */,
+                        uint64_t /* offset */,
+                        uint64_t /* size */)
+    {
+        commands += 'I';
+        commands += buffer->name;
+    }
+    void drawIndexed(uint32_t index_count,
+                     uint32_t /* instance_count */,
+                     uint32_t /* first_index */,
+                     int32_t /* base_vertex */,
+                     uint32_t /* first_instance */)
+    {
+        commands += 'D';
+        commands += std::to_string(index_count);
+    }
+};
+} // namespace
+
+TEST_CASE("It packs and unpacks sort keys", "[render_queue]")
+{
+    constexpr uint64_t key{SortKey::Pack(2, 5, 7, 9, 11)};
+    STATIC_REQUIRE(SortKey::Pass(key) == 2);
+    STATIC_REQUIRE(SortKey::Pipeline(key) == 5);
+    STATIC_REQUIRE(SortKey::BindGroup(key) == 7);
+    STATIC_REQUIRE(SortKey::Mesh(key) == 9);
+    STATIC_REQUIRE(SortKey::Depth(key) == 11);
+    STATIC_REQUIRE(SortKey::Pack(1, 0, 0, 0, 0) >
+                   SortKey::Pack(0, 4'095, 0, 0, 0));
+    STATIC_REQUIRE(SortKey::QuantiseDepth(2.0F) == (1U << 24U) - 1);
+    STATIC_REQUIRE(SortKey::QuantiseDepth(-1.0F) == 0);
+}
+
+TEST_CASE("It radix sorts stably by key", "[render_queue]")
+{
+    std::mt19937_64 random{42};
+    std::vector<std::pair<uint64_t, uint32_t>> entries{};
+    for (uint32_t index{0}; index < 1'000; ++index)
+    {
+        // Few distinct keys, so stability is exercised
+        entries.emplace_back(random() % 16 << 40U | random() % 4, index);
+    }
+    std::vector<std::pair<uint64_t, uint32_t>> expected{entries};
+    std::stable_sort(expected.begin(),
+                     expected.end(),
+                     [](const auto &left, const auto &right) {
+                         return left.first < right.first;
+                     });
+
+    std::vector<std::pair<uint64_t, uint32_t>> scratch{};
+    RadixSortByKey(entries, scratch);
+    REQUIRE(entries == expected);
+}
+
+TEST_CASE("It only sets state that changes", "[render_queue]")
+{
+    const std::array<FakeObject, 2> pipelines{{{'a'}, {'b'}}};
+    const FakeObject bind_group{'g'};
+    const std::array<FakeObject, 2> vertex_buffers{{{'v'}, {'w'}}};
+    const FakeObject index_buffer{'i'};
+
+    RenderQueue<FakeTypes> queue{};
+    // Alternate pipelines and meshes, the worst case in submission order
+    for (uint32_t draw{0}; draw < 4; ++draw)
+    {
+        RenderQueue<FakeTypes>::DrawPacket packet{};
+        packet.pipeline = &pipelines.at(draw % 2);
+        packet.bind_group = &bind_group;
+        packet.vertex_buffer.buffer = &vertex_buffers.at(draw % 2);
+        packet.index_buffer.buffer = &index_buffer;
+        packet.index_count = draw + 1;
+        packet.key = queue.MakeKey(0, packet, 0.0F);
+        queue.Push(packet);
+    }
+    REQUIRE(queue.size() == 4);
+
+    FakeEncoder encoder{};
+    const RenderQueueStats stats{queue.Submit(encoder)};
+    REQUIRE(encoder.commands == "PaBgVvIiD1D3PbVwD2D4");
+    REQUIRE(stats.draws == 4);
+    REQUIRE(stats.pipeline_changes == 2);
+    REQUIRE(stats.bind_group_changes == 1);
+    REQUIRE(stats.vertex_buffer_changes == 2);
+    REQUIRE(stats.index_buffer_changes == 1);
+    REQUIRE(stats.StateChanges() == 6);
+    REQUIRE(stats.unsorted_state_changes == 10);
+    REQUIRE(queue.size() == 0);
+    REQUIRE(queue.LastStats().draws == 4);
+}
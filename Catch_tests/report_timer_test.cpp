@@ -0,0 +1,27 @@
+#include "utilities/report_timer.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <chrono>
+#include <optional>
+
+TEST_CASE("It reports each interval once it has elapsed", "[report_timer]")
+{
+    using namespace std::chrono_literals;
+    ReportTimer timer{};
+    const ReportTimer::Clock::time_point start{ReportTimer::Clock::now()};
+    REQUIRE_FALSE(timer.IsRunning());
+    REQUIRE_FALSE(timer.Tick(start).has_value());
+    REQUIRE(timer.IsRunning());
+    REQUIRE_FALSE(timer.Tick(start + 9s).has_value());
+
+    // Late ticks report how long the interval actually ran
+    const std::optional<ReportTimer::Seconds> first{timer.Tick(start + 12s)};
+    REQUIRE(first.has_value());
+    REQUIRE(first.value() == 12s);
+
+    // The next interval starts from the tick that ended the last one
+    REQUIRE_FALSE(timer.Tick(start + 21s).has_value());
+    REQUIRE(timer.Tick(start + 12s + ReportTimer::kInterval).value() ==
+            ReportTimer::kInterval);
+}
@@ -0,0 +1,149 @@
+#include "utilities/resource_pack.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+std::string_view as_string_view(const std::vector<uint8_t> &bytes)
+{
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    return {reinterpret_cast<const char *>(bytes.data()), bytes.size()};
+}
+} // namespace
+
+TEST_CASE("It round-trips data through the compressor", "[resource_pack]")
+{
+    std::string input;
+    for (int line{0}; line < 100; ++line)
+    {
+        input += "0.5   0.0   0.0 0.353 0.612\n";
+    }
+    input += "a tail that does not repeat";
+
+    const std::vector<uint8_t> compressed{
+        ResourcePackFormat::Compress(input)};
+    REQUIRE(compressed.size() < input.size());
+
+    const std::optional<std::string> decompressed{
+        ResourcePackFormat::Decompress(as_string_view(compressed),
+                                       input.size())};
+    REQUIRE(decompressed.has_value());
+    REQUIRE(decompressed.value() == input);
+}
+
+TEST_CASE("It finds packed resources by name", "[resource_pack]")
+{
+    const std::string repetitive(4'096, 'x');
+    ResourcePackWriter writer;
+    writer.Add("shader.wgsl", "@vertex fn vs_main() {}");
+    writer.Add("texture.ppm", repetitive);
+    writer.Add("empty.txt", "");
+    const std::vector<uint8_t> bytes{writer.Build()};
+
+    const std::optional<ResourcePack> pack{
+        ResourcePack::FromMemory(as_string_view(bytes))};
+    REQUIRE(pack.has_value());
+    REQUIRE(pack->size() == 3);
+    REQUIRE(pack->Verify());
+
+    const std::optional<ResourceBlob> shader{pack->Find("shader.wgsl")};
+    REQUIRE(shader.has_value());
+    REQUIRE(shader->data() == "@vertex fn vs_main() {}");
+    // Uncompressed blobs are NUL-terminated views into the pack
+    REQUIRE(shader->c_str()[shader->size()] == '\0');
+    REQUIRE(shader->c_str() >= as_string_view(bytes).data());
+
+    const std::optional<ResourceBlob> texture{pack->Find("texture.ppm")};
+    REQUIRE(texture.has_value());
+    REQUIRE(texture->data() == repetitive);
+
+    REQUIRE(pack->Find("empty.txt").has_value());
+    REQUIRE_FALSE(pack->Find("missing.txt").has_value());
+}
+
+TEST_CASE("It rejects malformed packs", "[resource_pack]")
+{
+    ResourcePackWriter writer;
+    writer.Add("webgpu.txt", "[points]");
+    std::vector<uint8_t> bytes{writer.Build()};
+
+    const std::vector<uint8_t> truncated{bytes.begin(), bytes.end() - 1};
+    REQUIRE_FALSE(ResourcePack::FromMemory(as_string_view(truncated)));
+
+    // Offsets of the header's alignment and of the only index entry's fields
+    constexpr size_t kAlignment{12};
+    constexpr size_t kDataOffset{ResourcePackFormat::kHeaderSize + 16};
+    constexpr size_t kStoredSize{ResourcePackFormat::kHeaderSize + 24};
+    constexpr size_t kOriginalSize{ResourcePackFormat::kHeaderSize + 32};
+    constexpr size_t kNameOffset{ResourcePackFormat::kHeaderSize + 40};
+    REQUIRE(ResourcePack::FromMemory(as_string_view(bytes)));
+    const auto data_offset{
+        ResourcePackFormat::Load<uint64_t>(bytes.data() + kDataOffset)};
+    const auto stored_size{
+        ResourcePackFormat::Load<uint64_t>(bytes.data() + kStoredSize)};
+    auto rejects{[&bytes](size_t offset, auto value) {
+        std::vector<uint8_t> corrupted{bytes};
+        ResourcePackFormat::Store(corrupted.data() + offset, value);
+        return !ResourcePack::FromMemory(as_string_view(corrupted));
+    }};
+
+    // Alignments must be non-zero powers of two
+    REQUIRE(rejects(kAlignment, uint32_t{0}));
+    REQUIRE(rejects(kAlignment, uint32_t{24}));
+    // A blob must leave room for its NUL before the end of the file
+    REQUIRE(rejects(kStoredSize, uint64_t{bytes.size() - data_offset}));
+    // Offsets so large that adding the size would wrap around
+    REQUIRE(rejects(kDataOffset, UINT64_MAX - 1));
+    REQUIRE(rejects(kNameOffset, UINT32_MAX));
+    // An uncompressed blob must be followed by a NUL
+    REQUIRE(rejects(data_offset + stored_size, uint8_t{'X'}));
+    // Sizes that disagree with what was stored
+    REQUIRE(rejects(kOriginalSize, uint64_t{stored_size + 1}));
+
+    bytes[0] = 'X';
+    REQUIRE_FALSE(ResourcePack::FromMemory(as_string_view(bytes)));
+}
+
+TEST_CASE("It rejects compressed sizes beyond the coder's reach",
+          "[resource_pack]")
+{
+    ResourcePackWriter writer;
+    writer.Add("texture.ppm", std::string(4'096, 'x'));
+    std::vector<uint8_t> bytes{writer.Build()};
+    REQUIRE(ResourcePack::FromMemory(as_string_view(bytes)));
+
+    // More than the stored bytes could expand to, which must not be reserved
+    ResourcePackFormat::Store(bytes.data() + ResourcePackFormat::kHeaderSize +
+                                  32,
+                              UINT64_MAX);
+    REQUIRE_FALSE(ResourcePack::FromMemory(as_string_view(bytes)));
+    REQUIRE_FALSE(ResourcePackFormat::Decompress("\x00x", SIZE_MAX));
+}
+
+TEST_CASE("It keeps a mapped pack alive while its blobs are", "[resource_pack]")
+{
+    const std::filesystem::path path{std::filesystem::temp_directory_path() /
+                                     "learnwebgpu_resource_pack_test.pack"};
+    ResourcePackWriter writer;
+    writer.Add("webgpu.txt", "[points]");
+    REQUIRE(writer.Write(path));
+    {
+        std::optional<ResourcePack> pack{ResourcePack::Open(path)};
+        REQUIRE(pack.has_value());
+        const std::optional<ResourceBlob> blob{pack->Find("webgpu.txt")};
+        REQUIRE(blob.has_value());
+
+        // As when another pack is mounted in its place
+        pack.reset();
+        REQUIRE(blob->data() == "[points]");
+    }
+    // Only once the mapping is gone, as Windows will not remove mapped files
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,154 @@
+#include "utilities/scene_graph.h"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace
+{
+using Range = std::pair<uint64_t, size_t>;
+
+constexpr uint64_t kStride{sizeof(SceneTransform)};
+
+bool Near(float actual, float expected)
+{
+    constexpr float kTolerance{1e-5F};
+    return std::abs(actual - expected) < kTolerance;
+}
+
+// Records the offset and size of each upload
+SceneGraph::Upload Recorder(std::vector<Range> &uploads)
+{
+    return [&uploads](uint64_t offset, const void *, size_t size) {
+        uploads.emplace_back(offset, size);
+    };
+}
+} // namespace
+
+TEST_CASE("It composes child transforms onto their parents", "[scene_graph]")
+{
+    constexpr float kQuarterTurn{1.5707963F};
+    SceneGraph scene{};
+    const SceneGraph::NodeId root{
+        scene.Add(SceneGraph::kNoParent,
+                  MakeSceneTransform(1.0F, 2.0F, kQuarterTurn, 2.0F))};
+    const SceneGraph::NodeId child{
+        scene.Add(root, MakeSceneTransform(1.0F, 0.0F, 0.0F, 1.0F))};
+    std::vector<Range> uploads{};
+    scene.Update(Recorder(uploads));
+
+    // Moved one unit along x, then scaled by two and turned to face +y
+    const SceneTransform &world{scene.World(child)};
+    REQUIRE(Near(world.translation[0], 1.0F));
+    REQUIRE(Near(world.translation[1], 4.0F));
+    REQUIRE(Near(world.linear[0], 0.0F));
+    REQUIRE(Near(world.linear[1], 2.0F));
+    REQUIRE(Near(world.linear[2], -2.0F));
+    REQUIRE(Near(world.linear[3], 0.0F));
+    REQUIRE(uploads == std::vector<Range>{{0, 2 * kStride}});
+}
+
+TEST_CASE("It recomputes and uploads only dirty subtrees", "[scene_graph]")
+{
+    // Many roots, each with a chain of three descendants
+    constexpr uint32_t kRoots{25'000};
+    SceneGraph scene{};
+    std::vector<SceneGraph::NodeId> roots{};
+    for (uint32_t root{0}; root < kRoots; ++root)
+    {
+        roots.push_back(scene.Add(SceneGraph::kNoParent, SceneTransform{}));
+        SceneGraph::NodeId parent{roots.back()};
+        for (uint32_t depth{0}; depth < 3; ++depth)
+        {
+            parent = scene.Add(parent, SceneTransform{});
+        }
+    }
+    REQUIRE(scene.Size() == 4 * kRoots);
+    std::vector<Range> uploads{};
+    REQUIRE(scene.Update(Recorder(uploads)).recomputed == 4 * kRoots);
+    REQUIRE_FALSE(scene.LastStats().reordered);
+
+    // Nothing changed, so nothing is done
+    uploads.clear();
+    REQUIRE(scene.Update(Recorder(uploads)).recomputed == 0);
+    REQUIRE(uploads.empty());
+
+    // A root drags its chain along; a leaf moves alone
+    const SceneGraph::NodeId leaf{scene.Add(roots.back(), SceneTransform{})};
+    scene.Update(Recorder(uploads));
+    uploads.clear();
+    scene.SetLocal(roots[100], MakeSceneTransform(1.0F, 0.0F, 0.0F, 1.0F));
+    scene.SetLocal(leaf, MakeSceneTransform(0.0F, 1.0F, 0.0F, 1.0F));
+    const SceneUpdateStats &stats{scene.Update(Recorder(uploads))};
+    REQUIRE(stats.changed == 2);
+    REQUIRE(stats.recomputed == 5);
+    const uint64_t root_offset{scene.Index(roots[100]) * kStride};
+    const uint64_t leaf_offset{scene.Index(leaf) * kStride};
+    REQUIRE(uploads == std::vector<Range>{{root_offset, 4 * kStride},
+                                          {leaf_offset, kStride}});
+    REQUIRE(scene.World(leaf).translation[1] == 1.0F);
+}
+
+TEST_CASE("It merges nearby dirty ranges into one upload", "[scene_graph]")
+{
+    SceneGraph scene{};
+    std::vector<SceneGraph::NodeId> nodes{};
+    for (uint32_t node{0}; node < 64; ++node)
+    {
+        nodes.push_back(scene.Add(SceneGraph::kNoParent, SceneTransform{}));
+    }
+    std::vector<Range> uploads{};
+    scene.Update(Recorder(uploads));
+    uploads.clear();
+
+    // Within the merge gap of each other, then far apart
+    scene.SetLocal(nodes[2], SceneTransform{});
+    scene.SetLocal(nodes[2 + SceneGraph::kMergeGap + 1], SceneTransform{});
+    scene.SetLocal(nodes[40], SceneTransform{});
+    const SceneUpdateStats &stats{scene.Update(Recorder(uploads))};
+    REQUIRE(stats.recomputed == 3);
+    REQUIRE(uploads ==
+            std::vector<Range>{{2 * kStride, (SceneGraph::kMergeGap + 2) *
+                                                 kStride},
+                               {40 * kStride, kStride}});
+}
+
+TEST_CASE("It reorders parents before children when added out of order",
+          "[scene_graph]")
+{
+    SceneGraph scene{};
+    const SceneGraph::NodeId first{
+        scene.Add(SceneGraph::kNoParent,
+                  MakeSceneTransform(1.0F, 0.0F, 0.0F, 1.0F))};
+    const SceneGraph::NodeId second{
+        scene.Add(SceneGraph::kNoParent,
+                  MakeSceneTransform(0.0F, 1.0F, 0.0F, 1.0F))};
+    // Under a root whose subtree is no longer last
+    const SceneGraph::NodeId child{
+        scene.Add(first, MakeSceneTransform(0.0F, 0.0F, 0.0F, 1.0F))};
+    const SceneGraph::NodeId grandchild{
+        scene.Add(child, MakeSceneTransform(1.0F, 0.0F, 0.0F, 1.0F))};
+
+    std::vector<Range> uploads{};
+    const SceneUpdateStats &stats{scene.Update(Recorder(uploads))};
+    REQUIRE(stats.reordered);
+    REQUIRE(stats.recomputed == 4);
+    REQUIRE(scene.Index(first) == 0);
+    REQUIRE(scene.Index(child) == 1);
+    REQUIRE(scene.Index(grandchild) == 2);
+    REQUIRE(scene.Index(second) == 3);
+    REQUIRE(uploads == std::vector<Range>{{0, 4 * kStride}});
+    REQUIRE(scene.World(grandchild).translation[0] == 2.0F);
+    REQUIRE(scene.WorldTransforms()[3].translation[1] == 1.0F);
+
+    // The subtree under the first root is contiguous once more
+    uploads.clear();
+    scene.SetLocal(first, MakeSceneTransform(2.0F, 0.0F, 0.0F, 1.0F));
+    REQUIRE(scene.Update(Recorder(uploads)).recomputed == 3);
+    REQUIRE(uploads == std::vector<Range>{{0, 3 * kStride}});
+    REQUIRE(scene.World(grandchild).translation[0] == 3.0F);
+}
@@ -0,0 +1,20 @@
+# Write INPUT out as a C++ source file defining a byte array, so it can be
+# linked into a binary. Run in script mode:
+#
+#   cmake -DINPUT=<file> -DOUTPUT=<source> -DSYMBOL=<name> -P EmbedFile.cmake
+file(READ "${INPUT}" contents HEX)
+file(SIZE "${INPUT}" size)
+# 16 bytes (32 hex digits) to a line, then one `0x..,` per byte
+string(REPEAT "[0-9a-f]" 32 line_pattern)
+string(REGEX REPLACE "(${line_pattern})" "\\1\n" contents "${contents}")
+string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," contents "${contents}")
+file(
+  WRITE "${OUTPUT}"
+  "// Generated from ${INPUT}. Do not edit.\n"
+  "// NOLINTBEGIN\n"
+  "#include <cstddef>\n\n"
+  "// Over-aligned so that aligned blobs in the pack stay aligned in memory\n"
+  "alignas(64) extern const unsigned char ${SYMBOL}[] = {\n"
+  "${contents}\n0x00};\n"
+  "extern const std::size_t ${SYMBOL}_size = ${size};\n"
+  "// NOLINTEND\n")
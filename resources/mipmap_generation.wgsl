@@ -0,0 +1,22 @@
+// Downsample one mip level into the next, averaging each 2x2 block of texels
+@group(0) @binding(0) var previous_mip_level: texture_2d<f32>;
+@group(0) @binding(1) var next_mip_level: texture_storage_2d<rgba8unorm, write>;
+
+@compute @workgroup_size(8, 8)
+fn compute_mip_map(@builtin(global_invocation_id) id: vec3<u32>) {
+    let size = textureDimensions(next_mip_level);
+    if (id.x >= size.x || id.y >= size.y) {
+        return;
+    }
+
+    // clamp reads so odd-sized levels do not sample outside the texture
+    let last = textureDimensions(previous_mip_level) - vec2<u32>(1u, 1u);
+    let base = 2u * id.xy;
+    let colour = (
+        textureLoad(previous_mip_level, min(base, last), 0) +
+        textureLoad(previous_mip_level, min(base + vec2<u32>(1u, 0u), last), 0) +
+        textureLoad(previous_mip_level, min(base + vec2<u32>(0u, 1u), last), 0) +
+        textureLoad(previous_mip_level, min(base + vec2<u32>(1u, 1u), last), 0)
+    ) * 0.25;
+    textureStore(next_mip_level, id.xy, colour);
+}
@@ -6,32 +6,78 @@ struct VertexInput {
 struct VertexOutput {
     @builtin(position) position: vec4f,
     @location(0) color: vec3f,
+    @location(1) uv: vec2f,
 };
 
 struct MyUniforms {
     color: vec4f,
     time: f32,
+    // Where the drawn object's world transform is in node_transforms
+    node: u32,
 };
 
+// A scene graph node's world transform: the columns of its linear part, then
+// its translation
+struct NodeTransform {
+    linear: vec4f,
+    translation: vec2f,
+};
+
+// Pipeline-overridable constants: each pipeline permutation fixes these at
+// creation time, so they cost no uniform reads and their branches fold away
+override aspect_ratio: f32 = 640.0 / 480.0;
+override offset_x: f32 = -0.6875;
+override offset_y: f32 = -0.463;
+// Place vertices by their scene graph node; overlays are already in place
+override use_scene_node: bool = true;
+// Sample the colour texture, rather than using vertex colours alone
+override use_texture: bool = true;
+// Tint by the uniform colour; overlays keep their vertex colours as given
+override use_uniform_colour: bool = true;
+// Horizontal texture samples averaged per fragment
+override texture_taps: u32 = 1;
+override texture_tap_spacing: f32 = 0.002;
+
 @group(0) @binding(0) var<uniform> uMyUniforms: MyUniforms;
+@group(0) @binding(1) var colour_texture: texture_2d<f32>;
+@group(0) @binding(2) var texture_sampler: sampler;
+@group(0) @binding(3) var<storage, read> node_transforms: array<NodeTransform>;
 
 @vertex
 fn vs_main(in: VertexInput) -> VertexOutput {
     var out: VertexOutput;
-    let ratio = 640.0 / 480.0;
-
-    var offset = vec2f(-0.6875, -0.463);
-    offset += 0.3 * vec2f(cos(uMyUniforms.time), sin(uMyUniforms.time));
+    var position = in.position;
+    if (use_scene_node) {
+        let node = node_transforms[uMyUniforms.node];
+        position = mat2x2f(node.linear.xy, node.linear.zw) * position + node.translation;
+    }
+    let offset = vec2f(offset_x, offset_y);
 
-    out.position = vec4f(in.position.x + offset.x, (in.position.y + offset.y) * ratio, 0.0, 1.0);
+    out.position = vec4f(position.x + offset.x, (position.y + offset.y) * aspect_ratio, 0.0, 1.0);
     out.color = in.color;
+    // model space spans roughly one unit, so use it directly as texture space
+    out.uv = vec2f(in.position.x, 1.0 - in.position.y);
 
     return out;
 }
 
 @fragment
 fn fs_main(in: VertexOutput) -> @location(0) vec4f {
-    let color = in.color * uMyUniforms.color.rgb;
+    var texel = vec3f(1.0);
+    if (use_texture) {
+        texel = vec3f(0.0);
+        let first_tap = -0.5 * f32(texture_taps - 1u) * texture_tap_spacing;
+        for (var tap = 0u; tap < texture_taps; tap++) {
+            let uv = in.uv + vec2f(first_tap + f32(tap) * texture_tap_spacing, 0.0);
+            texel += textureSample(colour_texture, texture_sampler, uv).rgb;
+        }
+        texel /= f32(texture_taps);
+    }
+    var tint = vec3f(1.0);
+    if (use_uniform_colour) {
+        tint = uMyUniforms.color.rgb;
+    }
+    let color = in.color * tint * texel;
 
     let linear_colour = pow(color, vec3f(2.2));
     return vec4f(linear_colour, 1.0);
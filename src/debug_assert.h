@@ -3,20 +3,50 @@
 
 // #define NDEBUG // uncomment to disable assert()
 
-#include <exception>
+// Checks are compiled in unless NDEBUG is defined. Define
+// LEARNWEBGPU_CHECKED_RELEASE to keep them in optimised builds too.
+//
+// The message is only evaluated, and the exception only built, once a check
+// fails. Passing checks cost a single predicted branch.
 
-#ifdef NDEBUG
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DEBUG_ASSERT_LIKELY(x) __builtin_expect(static_cast<bool>(x), 1)
+#define DEBUG_ASSERT_COLD __attribute__((cold, noinline))
+#elif defined(_MSC_VER)
+#define DEBUG_ASSERT_LIKELY(x) static_cast<bool>(x)
+#define DEBUG_ASSERT_COLD __declspec(noinline)
+#else
+#define DEBUG_ASSERT_LIKELY(x) static_cast<bool>(x)
+#define DEBUG_ASSERT_COLD
+#endif
+
+#if defined(NDEBUG) && !defined(LEARNWEBGPU_CHECKED_RELEASE)
 #define debug_assert(expression, message) ((void)0)
 #else
-#define debug_assert(x, message) dbg_assert((x), (message))
+#define debug_assert(expression, message)                                      \
+    (DEBUG_ASSERT_LIKELY(expression)                                           \
+         ? (void)0                                                             \
+         : debug_assert_failed(#expression, (message), __FILE__, __LINE__))
 
-template <typename T, typename E = std::exception>
-inline void dbg_assert(T &&assertion, const E throwing = {})
+[[noreturn]] DEBUG_ASSERT_COLD inline void debug_assert_failed(
+    std::string_view expression,
+    std::string_view message,
+    std::string_view file,
+    int line)
 {
-    if (!std::forward<T>(assertion))
-    {
-        throw throwing;
-    }
+    std::string what{message};
+    what.append(" (`")
+        .append(expression)
+        .append("`): [")
+        .append(file)
+        .append(":")
+        .append(std::to_string(line))
+        .append("]");
+    throw std::runtime_error(what);
 }
 #endif
 
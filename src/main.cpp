@@ -1,5 +1,21 @@
 #include "debug_assert.h"
+#include "utilities/batch_renderer.h"
+#include "utilities/frame_consumer.h"
+#include "utilities/frame_readback.h"
+#include "utilities/frame_recorder.h"
+#include "utilities/frame_scheduler.h"
+#include "utilities/frames_in_flight.h"
+#include "utilities/gpu_memory_tracker.h"
+#include "utilities/gpu_object_cache.h"
+#include "utilities/input_queue.h"
+#include "utilities/logging.h"
+#include "utilities/pipeline_cache.h"
+#include "utilities/profiler.h"
+#include "utilities/render_queue.h"
 #include "utilities/resource_manager.h"
+#include "utilities/scene_graph.h"
+#include "utilities/texture_loader.h"
+#include "utilities/wgpu_format.h"
 
 #include <GLFW/glfw3.h>
 #include <fmt/format.h>
@@ -14,63 +30,258 @@
 #include <emscripten.h>
 #endif
 
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <csignal>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <ctime>
+#include <deque>
 #include <exception>
+#include <filesystem>
+#include <initializer_list>
+#include <iterator>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
 #include <vector>
 
+#ifdef LEARNWEBGPU_EMBED_RESOURCES
+// Generated from the resource pack at build time by cmake/EmbedFile.cmake
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays,modernize-avoid-c-arrays)
+extern const unsigned char learnwebgpu_resource_pack[];
+extern const std::size_t learnwebgpu_resource_pack_size;
+#endif
+
 namespace constants
 {
 inline constexpr int kWindowWidth{640};
 inline constexpr int kWindowHeight{480};
+inline constexpr uint32_t kDefaultCaptureFrameCount{120};
+// How often an idle on-demand loop checks on textures still loading
+inline constexpr double kAssetPollIntervalSeconds{0.05};
+// How often the device poll thread, when there is one, polls
+inline constexpr std::chrono::milliseconds kDevicePollInterval{1};
+// Room in the batch renderer's dynamic buffers, per frame and per draw
+inline constexpr uint32_t kBatchQuadsPerFrame{16384};
+inline constexpr uint32_t kBatchQuadsPerBatch{4096};
+// Frames shown by the frame time graph, and the time its full height spans
+inline constexpr size_t kFrameGraphSamples{120};
+inline constexpr double kFrameGraphSpanSeconds{2.0 / 60.0};
+// Distance of the drawn object from the centre it orbits
+inline constexpr float kOrbitRadius{0.3F};
+// Most scene graph nodes, and the shape of the extra ones: each has this
+// many children, and this fraction of them moves each frame
+inline constexpr uint32_t kMaxSceneNodes{uint32_t{1} << 20U};
+inline constexpr uint32_t kSceneBranching{4};
+inline constexpr uint32_t kSceneMovedFraction{64};
 } // namespace constants
 
-class Error
+// Which threads the application runs on
+enum class ThreadingModel : uint8_t
 {
+    // Events, drawing and device polling one after another
+    MainThread,
+    // The main thread only pumps window events; a render thread owns the
+    // device, drawing and presentation
+    RenderThread,
+    // As RenderThread, with a third thread polling the device for callbacks
+    RenderAndPollThreads,
 };
 
-// NOLINTNEXTLINE(misc-use-internal-linkage)
-auto format_as(WGPUErrorType error_type)
-{
-    return fmt::underlying(error_type);
-}
-
-// NOLINTNEXTLINE(misc-use-internal-linkage)
-auto format_as(WGPUDeviceLostReason reason)
+// Set from the command line
+struct ApplicationOptions
 {
-    return fmt::underlying(reason);
-}
+    // Record the GPU work of the first `capture_frame_count` frames here, for
+    // ReplayFrames
+    std::optional<std::filesystem::path> capture_path{std::nullopt};
+    uint32_t capture_frame_count{constants::kDefaultCaptureFrameCount};
+    // On demand, the animation starts paused; space toggles it
+    RenderMode render_mode{RenderMode::Continuous};
+    // Overlay a graph of recent frame times
+    bool show_frame_graph{false};
+    // Write every frame read back from the GPU here, as numbered PPM files
+    std::optional<std::filesystem::path> readback_directory{std::nullopt};
+    ThreadingModel threading{ThreadingModel::MainThread};
+    // Most frames submitted but not yet finished by the GPU
+    uint32_t frames_in_flight{FramesInFlight::kDefaultLimit};
+    // Write a trace of CPU zones here on P and at exit, for Chrome's trace
+    // viewer or Perfetto
+    std::optional<std::filesystem::path> profile_path{std::nullopt};
+    // Scene graph nodes added beyond the drawn ones, a slice of which moves
+    // every frame, to measure transform updates
+    uint32_t scene_nodes{0};
+    // Time reading the start-up resources as loose files and from the pack
+    bool compare_resource_reads{false};
+};
 
-// NOLINTNEXTLINE(misc-use-internal-linkage)
-auto format_as(WGPUBufferMapAsyncStatus status)
+class Error
 {
-    return fmt::underlying(status);
-}
+};
 
-// NOLINTNEXTLINE(misc-use-internal-linkage)
-auto format_as(WGPUQueueWorkDoneStatus status)
+// Handle types the render queue draws with
+struct WebGpuDrawTypes
 {
-    return fmt::underlying(status);
-}
+    using Pipeline = wgpu::RenderPipeline;
+    using BindGroup = wgpu::BindGroup;
+    using Buffer = wgpu::Buffer;
+    using IndexFormat = wgpu::IndexFormat;
+};
 
 namespace
 {
+// Only async-signal-safe calls may be made here, so the logger is left alone.
+// Logging::Abort() drains it before raising the signal.
 void signal_handler(int signal)
 {
-    if (signal == SIGABRT)
+    constexpr std::string_view kAbort{"Abort signal received\n"};
+    constexpr std::string_view kUnexpected{"Unexpected signal received\n"};
+    const std::string_view message{signal == SIGABRT ? kAbort : kUnexpected};
+#ifdef _WIN32
+    _write(2, message.data(), static_cast<unsigned int>(message.size()));
+#else
+    // Nothing more can safely be done if the write fails
+    [[maybe_unused]] const ssize_t written{
+        write(STDERR_FILENO, message.data(), message.size())};
+#endif
+    std::_Exit(EXIT_FAILURE);
+}
+
+std::optional<ApplicationOptions> parse_options(
+    const std::vector<std::string> &arguments)
+{
+    ApplicationOptions options{};
+    for (auto argument{arguments.begin()}; argument != arguments.end();
+         ++argument)
     {
-        spdlog::error("Abort signal received");
+        const bool has_value{std::next(argument) != arguments.end()};
+        if (*argument == "--on-demand")
+        {
+            options.render_mode = RenderMode::OnDemand;
+        }
+        else if (*argument == "--frame-graph")
+        {
+            options.show_frame_graph = true;
+        }
+        else if (*argument == "--render-thread")
+        {
+            options.threading =
+                std::max(options.threading, ThreadingModel::RenderThread);
+        }
+        else if (*argument == "--poll-thread")
+        {
+            options.threading = ThreadingModel::RenderAndPollThreads;
+        }
+        else if (*argument == "--compare-resource-reads")
+        {
+            options.compare_resource_reads = true;
+        }
+        else if (*argument == "--capture" && has_value)
+        {
+            options.capture_path = *++argument;
+        }
+        else if (*argument == "--readback" && has_value)
+        {
+            options.readback_directory = *++argument;
+        }
+        else if (*argument == "--profile" && has_value)
+        {
+            options.profile_path = *++argument;
+        }
+        else if (*argument == "--frames-in-flight" && has_value)
+        {
+            try
+            {
+                options.frames_in_flight =
+                    static_cast<uint32_t>(std::stoul(*++argument));
+            }
+            catch (const std::exception &)
+            {
+                options.frames_in_flight = 0;
+            }
+            if (options.frames_in_flight == 0 ||
+                options.frames_in_flight > FramesInFlight::kMaxLimit)
+            {
+                spdlog::error("Frames in flight must be from 1 to {}, not "
+                              "`{}`",
+                              FramesInFlight::kMaxLimit,
+                              *argument);
+                return std::nullopt;
+            }
+        }
+        else if (*argument == "--scene-nodes" && has_value)
+        {
+            try
+            {
+                options.scene_nodes =
+                    static_cast<uint32_t>(std::stoul(*++argument));
+            }
+            catch (const std::exception &)
+            {
+                options.scene_nodes = constants::kMaxSceneNodes;
+            }
+            if (options.scene_nodes >= constants::kMaxSceneNodes)
+            {
+                spdlog::error("Scene nodes must be fewer than {}, not `{}`",
+                              constants::kMaxSceneNodes,
+                              *argument);
+                return std::nullopt;
+            }
+        }
+        else if (*argument == "--capture-frames" && has_value)
+        {
+            try
+            {
+                options.capture_frame_count =
+                    static_cast<uint32_t>(std::stoul(*++argument));
+            }
+            catch (const std::exception &)
+            {
+                spdlog::error("Invalid frame count `{}`", *argument);
+                return std::nullopt;
+            }
+        }
+        else
+        {
+            spdlog::error("Unknown option `{}`", *argument);
+            spdlog::info("Usage: App [--on-demand] [--frame-graph] "
+                         "[--render-thread] [--poll-thread] "
+                         "[--frames-in-flight <count>] "
+                         "[--capture <trace path>] [--capture-frames <count>] "
+                         "[--readback <directory>] "
+                         "[--profile <trace path>] "
+                         "[--scene-nodes <count>] "
+                         "[--compare-resource-reads]");
+            return std::nullopt;
+        }
     }
-    else
+    return options;
+}
+
+std::string_view threading_model_name(ThreadingModel threading)
+{
+    switch (threading)
     {
-        spdlog::error("Unexpected signal received");
+    case ThreadingModel::MainThread:
+        return "main thread";
+    case ThreadingModel::RenderThread:
+        return "render thread";
+    case ThreadingModel::RenderAndPollThreads:
+        return "render and poll threads";
     }
-    std::_Exit(EXIT_FAILURE);
+    return "unknown";
 }
 } // namespace
 
@@ -78,7 +289,7 @@ class Application
 {
 public:
     // Initialise everything and return true if it all went well
-    bool Initialise();
+    bool Initialise(const ApplicationOptions &options);
 
     // Free everything that was initialised
     void Terminate();
@@ -86,6 +297,12 @@ public:
     // Draw a frame and handle events
     void MainLoop();
 
+#ifndef __EMSCRIPTEN__
+    // Run main loop iterations until the window closes, on the threads the
+    // threading model calls for
+    void Run();
+#endif
+
     // Return true while we require the main loop to remain running
     bool IsRunning();
 
@@ -94,24 +311,93 @@ private:
     {
         std::array<float, 4> colour;
         float time;
+        // Where the drawn object's world transform is in the scene buffer
+        uint32_t node;
         // Padding needed to bring struct size up to a multiple of the largest
         // field size (color array in this case).
         // https://eliemichel.github.io/LearnWebGPU/basic-3d-rendering/shader-uniforms/multiple-uniforms.html#padding
         // Tool to generate stuct with padding: https://eliemichel.github.io/WebGPU-AutoLayout/
-        std::array<float, 3> _pad;
+        std::array<float, 2> _pad;
     };
 
     // See comment above on MyUniform padding
     static_assert(sizeof(MyUniforms) % sizeof(std::array<float, 4>) == 0);
 
-    std::optional<wgpu::TextureView> GetNextSurfaceTextureView();
+    // Also sets `target_texture` to the surface texture the view is of,
+    // which must be released at the end of the frame
+    std::optional<wgpu::TextureView> GetNextSurfaceTextureView(
+        wgpu::Texture &target_texture);
 
     // Substep of Initialise() that creates the render pipeline
     void InitialisePipeline();
+    // Override constant values for the render pipeline permutation in use
+    [[nodiscard]] static PipelineConstants GetPipelineConstants(
+        bool use_texture);
+    // Constants for overlays, which draw vertices in clip space in their own
+    // colours
+    [[nodiscard]] static PipelineConstants GetOverlayPipelineConstants();
+    // Entries for those of `constants` named in `keys`. They point into
+    // `constants`, which must outlive them.
+    [[nodiscard]] static std::vector<wgpu::ConstantEntry> GetConstantEntries(
+        const PipelineConstants &constants,
+        std::initializer_list<std::string_view> keys);
+    // Specialise the render pipeline with `constants`. Called by the
+    // pipeline cache, possibly on a worker thread.
+    [[nodiscard]] wgpu::RenderPipeline CreateRenderPipeline(
+        const PipelineConstants &constants);
     [[nodiscard]] static wgpu::RequiredLimits GetRequiredLimits(
         wgpu::Adapter adapter);
+    // Build the scene graph, with `extra_nodes` beyond the drawn ones, and
+    // its transform buffer
+    void InitialiseScene(uint32_t extra_nodes);
     void InitialiseBuffers();
+    void InitialiseTextures();
     void InitialiseBindGroups();
+    // Create the batch renderer's dynamic buffers
+    void InitialiseBatchRenderer();
+    // Start reading frames back to be written into `directory`
+    [[nodiscard]] bool InitialiseReadback(
+        const std::filesystem::path &directory);
+
+    // Account for a newly created object in gpu_memory
+    void TrackBuffer(wgpu::Buffer buffer,
+                     const wgpu::BufferDescriptor &descriptor,
+                     GpuCallSite call_site);
+    void TrackTexture(const LoadedTexture &loaded, GpuCallSite call_site);
+
+    // Swap in any textures that finished loading since the last frame
+    void UpdateTextures();
+    // Draw recent frame times as bars, against a line at 60 Hz, into the
+    // batch renderer's region for `frame_slot`
+    void DrawFrameGraph(uint32_t frame_slot);
+
+    // Handle pending events. On demand, sleep until there are some while the
+    // scene is clean.
+    void WaitForEvents();
+    // Apply the input queued since the last frame: space pauses and resumes
+    // the animation, P writes the profile, and anything else marks the scene
+    // dirty
+    void ProcessInput();
+    void UpdateAnimation();
+    // Move the animated scene graph nodes and upload what changed
+    void UpdateScene();
+    // Let the device run callbacks for finished work, waiting for all
+    // submitted work first if `wait`
+    void PollDevice(bool wait);
+    // Queue `event` for the Application owning `event_window`, stamped with
+    // its arrival time
+    static void QueueInput(GLFWwindow *event_window, InputEvent event);
+    // Quit keys are handled at once; every key is queued as input
+    static void OnKey(GLFWwindow *event_window,
+                      int key,
+                      int scancode,
+                      int action,
+                      int mods);
+    // Log the periodic GPU memory, object cache, readback, frames in flight,
+    // frame timing and utilisation lines when due
+    void LogStatistics();
+    // Write every profiler zone recorded so far, if profiling
+    void WriteProfile();
 
     GLFWwindow *window{nullptr};
     std::optional<wgpu::Device> device{std::nullopt};
@@ -119,31 +405,108 @@ private:
     std::optional<wgpu::Surface> surface{std::nullopt};
     std::unique_ptr<wgpu::ErrorCallback> uncapturedErrorCallbackHandle{nullptr};
     wgpu::TextureFormat surface_format{wgpu::TextureFormat::Undefined};
+    std::optional<wgpu::ShaderModule> shader_module{std::nullopt};
+    // Owns the layouts, pipelines and bind groups below
+    GpuObjectCache object_cache{};
+    PipelinePermutationCache<wgpu::RenderPipeline> pipeline_cache{};
+    // Owned by pipeline_cache
     std::optional<wgpu::RenderPipeline> pipeline{std::nullopt};
     std::optional<wgpu::Buffer> point_buffer{std::nullopt};
     std::optional<wgpu::Buffer> index_buffer{std::nullopt};
     std::optional<wgpu::Buffer> uniform_buffer{std::nullopt};
     uint32_t index_count{};
+    // World transforms of every node live in scene_buffer, which the vertex
+    // shader indexes with the uniform `node`
+    SceneGraph scene{};
+    SceneGraph::NodeId scene_orbit{0};
+    SceneGraph::NodeId scene_object{0};
+    SceneGraph::NodeId first_extra_node{0};
+    uint32_t extra_scene_nodes{0};
+    // The next extra node to move
+    uint32_t moved_scene_cursor{0};
+    std::optional<wgpu::Buffer> scene_buffer{std::nullopt};
+    RenderQueue<WebGpuDrawTypes> render_queue{};
+    std::optional<wgpu::Buffer> batch_vertex_buffer{std::nullopt};
+    std::optional<wgpu::Buffer> batch_index_buffer{std::nullopt};
+    BatchRenderer<WebGpuDrawTypes> batch_renderer{};
+    bool show_frame_graph{false};
+    // Owned by pipeline_cache
+    std::optional<wgpu::RenderPipeline> overlay_pipeline{std::nullopt};
+    // Seconds between drawn frames, oldest first
+    std::deque<double> frame_times{};
+    std::optional<double> last_frame_start{std::nullopt};
+    // Writes frames read back by frame_readback on a thread of its own
+    FrameConsumer frame_consumer{};
+    FrameReadback frame_readback{};
+    // Frames drawn so far
+    uint64_t frame_index{0};
     std::optional<wgpu::BindGroup> bind_group{std::nullopt};
     std::optional<wgpu::PipelineLayout> layout{std::nullopt};
     std::optional<wgpu::BindGroupLayout> bind_group_layout{std::nullopt};
+    TextureLoader texture_loader{};
+    FrameRecorder recorder{};
+    GpuMemoryTracker gpu_memory{};
+    FrameScheduler scheduler{};
+    UtilisationMonitor utilisation{};
+    FrameTimingMonitor timing{};
+    // Completions are reported by queue work-done callbacks
+    FramesInFlight frames_in_flight{};
+    ThreadingModel threading{ThreadingModel::MainThread};
+    // Filled by window callbacks on the main thread, drained by whichever
+    // thread draws
+    InputQueue input{};
+    std::optional<std::filesystem::path> profile_path{std::nullopt};
+    bool animating{true};
+    // Seconds of animation shown so far, which stops advancing while paused
+    double animation_time{0.0};
+    double last_animation_update{0.0};
+    std::optional<wgpu::Texture> texture{std::nullopt};
+    std::optional<wgpu::TextureView> texture_view{std::nullopt};
+    std::optional<wgpu::Sampler> sampler{std::nullopt};
+
+    // Start-up metrics
+    std::chrono::steady_clock::time_point start_time{};
+    uint64_t buffer_bytes_uploaded{0};
+    bool first_frame_presented{false};
 };
 
-int main()
+int main(int argc, char *argv[])
 {
+    Logging::Initialise();
+
+    const std::optional<ApplicationOptions> options{
+        parse_options({std::next(argv), std::next(argv, argc)})};
+    if (!options.has_value())
+    {
+        Logging::Shutdown();
+        return 1;
+    }
+
+    if (options.value().profile_path.has_value())
+    {
+        Profiler::SetEnabled(true);
+        Profiler::SetThreadName("Main");
+    }
+
     const auto signal_handler_set_result = signal(SIGABRT, signal_handler);
     if (signal_handler_set_result == SIG_ERR)
     {
         spdlog::error("Error setting abourt signal handler.");
     }
+    // A failed debug_assert that escapes a noexcept callback terminates
+    std::set_terminate([] {
+        spdlog::critical("Terminating after an unhandled error");
+        Logging::Abort();
+    });
 
     try
     {
         Application app;
 
-        if (!app.Initialise())
+        if (!app.Initialise(options.value()))
         {
             spdlog::error("Could not initialise WGPU!");
+            Logging::Shutdown();
             return 1;
         }
 
@@ -155,19 +518,18 @@ int main()
         };
         emscripten_set_main_loop_arg(callback, &app, 0, true);
 #else  // __EMSCRIPTEN__
-        while (app.IsRunning())
-        {
-            app.MainLoop();
-        }
+        app.Run();
 #endif // __EMSCRIPTEN__
 
         app.Terminate();
+        Logging::Shutdown();
 
         return 0;
     }
     catch (const std::exception &e)
     {
         spdlog::error("Error: {}", e.what());
+        Logging::Shutdown();
     }
 }
 
@@ -189,8 +551,31 @@ void key_callback(GLFWwindow *window,
 }
 } // namespace
 
-bool Application::Initialise()
+bool Application::Initialise(const ApplicationOptions &options)
 {
+    const ProfileZone profile_zone{"Initialise"};
+    start_time = std::chrono::steady_clock::now();
+    profile_path = options.profile_path;
+
+    // Prefer the resource pack, falling back to loose files for anything it
+    // does not hold
+    ResourceManager::set_resource_directory(RESOURCE_DIR);
+#if defined(LEARNWEBGPU_EMBED_RESOURCES)
+    ResourceManager::mount_pack(std::string_view{
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        reinterpret_cast<const char *>(learnwebgpu_resource_pack),
+        learnwebgpu_resource_pack_size});
+#elif defined(RESOURCE_PACK_PATH)
+    ResourceManager::mount_pack(std::filesystem::path{RESOURCE_PACK_PATH});
+#endif
+    if (options.compare_resource_reads)
+    {
+        ResourceManager::report_read_times({"shader.wgsl",
+                                            "mipmap_generation.wgsl",
+                                            "webgpu.txt",
+                                            "texture.ppm"});
+    }
+
     // Open window
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -221,7 +606,11 @@ bool Application::Initialise()
     spdlog::info("Requesting device...");
     wgpu::DeviceDescriptor deviceDesc = {};
     deviceDesc.label = "My Device";
-    deviceDesc.requiredFeatureCount = 0;
+    // Enable any block-compressed texture formats the adapter supports
+    const std::vector<WGPUFeatureName> required_features{
+        TextureLoader::SupportedCompressionFeatures(adapter)};
+    deviceDesc.requiredFeatureCount = required_features.size();
+    deviceDesc.requiredFeatures = required_features.data();
     deviceDesc.requiredLimits = nullptr;
     deviceDesc.defaultQueue.nextInChain = nullptr;
     deviceDesc.defaultQueue.label = "The default queue";
@@ -253,7 +642,7 @@ bool Application::Initialise()
                 spdlog::error("Uncaptured device error: type {} ({})",
                               error_type,
                               message);
-                std::abort();
+                Logging::Abort();
             }
             else
             {
@@ -262,12 +651,18 @@ bool Application::Initialise()
         });
 
     queue = device.value().getQueue();
+    object_cache.Initialise(device.value(), gpu_memory);
 
     // Configure the surface
     wgpu::SurfaceConfiguration config = {};
     config.width = constants::kWindowWidth;
     config.height = constants::kWindowHeight;
     config.usage = wgpu::TextureUsage::RenderAttachment;
+    if (options.readback_directory.has_value())
+    {
+        // Frames are copied out of the surface texture
+        config.usage = config.usage | wgpu::TextureUsage::CopySrc;
+    }
     surface_format = surface.value().getPreferredFormat(adapter);
     config.format = surface_format;
 
@@ -283,44 +678,165 @@ bool Application::Initialise()
     // Release the adapter only after we have fully initialised it
     adapter.release();
 
-    glfwSetKeyCallback(window, key_callback);
+    // Input and window changes are what wake the on-demand loop
+    scheduler.Initialise(options.render_mode);
+    threading = options.threading;
+#if defined(__EMSCRIPTEN__)
+    if (threading != ThreadingModel::MainThread)
+    {
+        spdlog::warn("Threads are unavailable in the browser, so everything "
+                     "runs on the main thread");
+        threading = ThreadingModel::MainThread;
+    }
+#elif defined(WEBGPU_BACKEND_DAWN)
+    if (threading == ThreadingModel::RenderAndPollThreads)
+    {
+        spdlog::warn("Dawn devices cannot be ticked from another thread, so "
+                     "the render thread polls the device");
+        threading = ThreadingModel::RenderThread;
+    }
+#endif
+    spdlog::info("Threading model: {}", threading_model_name(threading));
+    frames_in_flight.Initialise(options.frames_in_flight);
+    show_frame_graph = options.show_frame_graph;
+    animating = options.render_mode == RenderMode::Continuous;
+    last_animation_update = glfwGetTime();
+    glfwSetWindowUserPointer(window, this);
+    glfwSetKeyCallback(window, OnKey);
+    glfwSetMouseButtonCallback(
+        window,
+        [](GLFWwindow *event_window, int button, int action, int mods) {
+            InputEvent event{};
+            event.kind = InputKind::MouseButton;
+            event.code = button;
+            event.action = action;
+            event.mods = mods;
+            QueueInput(event_window, event);
+        });
+    glfwSetScrollCallback(
+        window,
+        [](GLFWwindow *event_window, double x, double y) {
+            InputEvent event{};
+            event.kind = InputKind::Scroll;
+            event.x = x;
+            event.y = y;
+            QueueInput(event_window, event);
+        });
+    glfwSetFramebufferSizeCallback(
+        window,
+        [](GLFWwindow *event_window, int width, int height) {
+            static_cast<Application *>(glfwGetWindowUserPointer(event_window))
+                ->input.Resize(width, height);
+        });
+    // The window system lost the window's contents, such as on uncovering it
+    glfwSetWindowRefreshCallback(window, [](GLFWwindow *event_window) {
+        InputEvent event{};
+        event.kind = InputKind::Refresh;
+        QueueInput(event_window, event);
+    });
+
+    // Start before any GPU objects are created, so the trace holds them all
+    if (options.capture_path.has_value() &&
+        !recorder.Start(options.capture_path.value(),
+                        options.capture_frame_count))
+    {
+        return false;
+    }
 
     InitialisePipeline();
+    InitialiseScene(options.scene_nodes);
     InitialiseBuffers();
+    InitialiseBatchRenderer();
+    InitialiseTextures();
     InitialiseBindGroups();
+    if (options.readback_directory.has_value() &&
+        !InitialiseReadback(options.readback_directory.value()))
+    {
+        return false;
+    }
 
     return true;
 }
 
 void Application::Terminate()
 {
+    WriteProfile();
+    spdlog::info("{}", gpu_memory.Summary());
+    spdlog::info("{}", object_cache.Summary());
+    if (frame_readback.IsActive())
+    {
+        // Deliver what is still in flight before the device goes
+        frame_readback.Terminate();
+        frame_consumer.Stop();
+        spdlog::info("{}", frame_readback.Summary());
+    }
+    texture_loader.Terminate();
     if (bind_group.has_value())
     {
-        bind_group.value().release();
+        object_cache.Release(bind_group.value());
+    }
+    if (sampler.has_value())
+    {
+        sampler.value().release();
+    }
+    if (texture_view.has_value())
+    {
+        texture_view.value().release();
+    }
+    if (texture.has_value())
+    {
+        gpu_memory.Untrack(texture.value());
+        texture.value().destroy();
+        texture.value().release();
     }
     if (layout.has_value())
     {
-        layout.value().release();
+        object_cache.Release(layout.value());
     }
     if (bind_group_layout.has_value())
     {
-        bind_group_layout.value().release();
+        object_cache.Release(bind_group_layout.value());
     }
     if (uniform_buffer.has_value())
     {
+        gpu_memory.Untrack(uniform_buffer.value());
         uniform_buffer.value().release();
     }
+    if (scene_buffer.has_value())
+    {
+        gpu_memory.Untrack(scene_buffer.value());
+        scene_buffer.value().release();
+    }
     if (point_buffer.has_value())
     {
+        gpu_memory.Untrack(point_buffer.value());
         point_buffer.value().release();
     }
     if (index_buffer.has_value())
     {
+        gpu_memory.Untrack(index_buffer.value());
         index_buffer.value().release();
     }
-    if (pipeline.has_value())
+    for (std::optional<wgpu::Buffer> *batch_buffer :
+         {&batch_vertex_buffer, &batch_index_buffer})
+    {
+        if (batch_buffer->has_value())
+        {
+            gpu_memory.Untrack(batch_buffer->value());
+            batch_buffer->value().release();
+        }
+    }
+    pipeline_cache.Terminate();
+    object_cache.Terminate();
+    if (shader_module.has_value())
     {
-        pipeline.value().release();
+        shader_module.value().release();
+    }
+    // Anything still tracked was never released
+    for (const GpuAllocation &leak : gpu_memory.LiveObjects())
+    {
+        spdlog::warn("GPU object still alive at shutdown: {}",
+                     GpuMemoryTracker::Describe(leak));
     }
     if (surface.has_value())
     {
@@ -344,31 +860,69 @@ void Application::Terminate()
 
 void Application::MainLoop()
 {
-    glfwPollEvents();
+    const ProfileZone profile_zone{"MainLoop"};
+    Logging::BeginFrame();
+    // Drain the threads' buffers before they fill
+    if (Profiler::IsEnabled())
+    {
+        Profiler::Collect();
+    }
+    WaitForEvents();
+
+    ProcessInput();
+    UpdateTextures();
+    UpdateAnimation();
+    LogStatistics();
+    if (!scheduler.NeedsFrame())
+    {
+        timing.FrameSkipped();
+        return;
+    }
+
+    // Keep the CPU at most the frame limit ahead of the GPU
+#ifdef __EMSCRIPTEN__
+    // The browser loop cannot block: try again next time, still dirty
+    const std::optional<uint32_t> acquired{frames_in_flight.TryAcquire()};
+    if (!acquired.has_value())
+    {
+        return;
+    }
+    const uint32_t frame_slot{acquired.value()};
+#else
+    const uint32_t frame_slot{frames_in_flight.Acquire([this]() {
+        if (threading != ThreadingModel::RenderAndPollThreads)
+        {
+            PollDevice(false);
+        }
+    })};
+#endif
+
+    recorder.BeginFrame();
 
     // Update uniform buffer
-    const float current_time{static_cast<float>(glfwGetTime())};
-    debug_assert(
-        queue.has_value(),
-        std::runtime_error(fmt::format("Queue should be initialised before "
-                                       "entering the main loop: [{}:{}]",
-                                       __FILE__,
-                                       __LINE__)));
+    const float current_time{static_cast<float>(animation_time)};
+    debug_assert(queue.has_value(),
+                 "Queue should be initialised before entering the main loop");
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
     queue.value().writeBuffer(uniform_buffer.value(),
                               // only update the time field
                               offsetof(MyUniforms, time),
                               &current_time,
                               sizeof(float));
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.WriteBuffer(uniform_buffer.value(),
+                         offsetof(MyUniforms, time),
+                         &current_time,
+                         sizeof(float));
+    UpdateScene();
 
     // Get the next target texture view
-    std::optional<wgpu::TextureView> target_view{GetNextSurfaceTextureView()};
+    wgpu::Texture target_texture{nullptr};
+    std::optional<wgpu::TextureView> target_view{
+        GetNextSurfaceTextureView(target_texture)};
     debug_assert(target_view.has_value(),
-                 std::runtime_error(
-                     fmt::format("Target View should be initialised before "
-                                 "entering the main loop: [{}:{}]",
-                                 __FILE__,
-                                 __LINE__)));
+                 "Target View should be initialised before entering the main "
+                 "loop");
     if (!target_view.has_value())
     {
         return;
@@ -377,16 +931,15 @@ void Application::MainLoop()
     // Create a command encoder for the draw cell
     wgpu::CommandEncoderDescriptor encoderDesc = {};
     encoderDesc.label = "My command encoder";
-    debug_assert(
-        device.has_value(),
-        std::runtime_error(fmt::format("Device should be initialised before "
-                                       "entering the main loop: [{}:{}]",
-                                       __FILE__,
-                                       __LINE__)));
+    debug_assert(device.has_value(),
+                 "Device should be initialised before entering the main loop");
     wgpu::CommandEncoder encoder =
         // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
         wgpuDeviceCreateCommandEncoder(device.value(), &encoderDesc);
 
+    // Mirrors the CPU zone into a debug group around the whole pass
+    GpuProfileZone<wgpu::CommandEncoder> pass_zone{encoder, "Main pass"};
+
     // Create the render pass that clears the screen with our colour
     wgpu::RenderPassDescriptor renderPassDesc = {};
 
@@ -413,119 +966,452 @@ void Application::MainLoop()
 
     // Create the render pass and end it immediately (we only clear the screen, and do not draw anything)
     wgpu::RenderPassEncoder renderPass{encoder.beginRenderPass(renderPassDesc)};
+    recorder.BeginRenderPass(constants::kWindowWidth,
+                             constants::kWindowHeight,
+                             surface_format,
+                             renderPassColorAttachment.clearValue);
+    debug_assert(point_buffer.has_value() && index_buffer.has_value() &&
+                     bind_group.has_value(),
+                 "Buffers and Bind Group should be initialised before "
+                 "entering the main loop");
     if (pipeline.has_value() && pipeline.value() != nullptr)
     {
-        renderPass.setPipeline(pipeline.value());
+        RenderQueue<WebGpuDrawTypes>::DrawPacket packet{};
+        packet.pipeline = pipeline.value();
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        packet.bind_group = bind_group.value();
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        packet.vertex_buffer = {point_buffer.value(),
+                                0,
+                                // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+                                point_buffer.value().getSize()};
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        packet.index_buffer = {index_buffer.value(),
+                               0,
+                               // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+                               index_buffer.value().getSize()};
+        packet.index_format = wgpu::IndexFormat::Uint16;
+        packet.index_count = index_count;
+        packet.key = render_queue.MakeKey(0, packet, 0.0F);
+        render_queue.Push(packet);
     }
     else
     {
-        spdlog::error(
+        LOG_ERROR_RATE_LIMITED(
             "Pipeline should be initialised before entering main loop");
     }
 
-    debug_assert(point_buffer.has_value(),
-                 std::runtime_error(
-                     fmt::format("Point Buffer should be initialised before "
-                                 "entering the main loop: [{}:{}]",
-                                 __FILE__,
-                                 __LINE__)));
-    renderPass.setVertexBuffer(
-        0,
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        point_buffer.value(),
-        0,
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        point_buffer.value().getSize());
-    debug_assert(index_buffer.has_value(),
-                 std::runtime_error(
-                     fmt::format("Index Buffer should be initialised before "
-                                 "entering the main loop: [{}:{}]",
-                                 __FILE__,
-                                 __LINE__)));
-    renderPass.setIndexBuffer(
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        index_buffer.value(),
-        wgpu::IndexFormat::Uint16,
-        0,
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        index_buffer.value().getSize());
-
-    debug_assert(bind_group.has_value(),
-                 std::runtime_error(
-                     fmt::format("Bind Group should be initialised before "
-                                 "entering the main loop: [{}:{}]",
-                                 __FILE__,
-                                 __LINE__)));
-    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-    renderPass.setBindGroup(0, bind_group.value(), 0, nullptr);
+    if (show_frame_graph)
+    {
+        DrawFrameGraph(frame_slot);
+    }
 
-    renderPass.drawIndexed(index_count, 1, 0, 0, 0);
+    {
+        const GpuProfileZone<wgpu::RenderPassEncoder> queue_zone{
+            renderPass, "Render queue"};
+        RecordingRenderPass recording_pass{renderPass, recorder};
+        render_queue.Submit(recording_pass);
+    }
+    LOG_DEBUG_RATE_LIMITED("Render queue: {} draws, {} state changes ({} in "
+                           "submission order)",
+                           render_queue.LastStats().draws,
+                           render_queue.LastStats().StateChanges(),
+                           render_queue.LastStats().unsorted_state_changes);
 
     renderPass.end();
     renderPass.release();
+    recorder.EndRenderPass();
+    pass_zone.End();
+
+    if (frame_readback.IsActive())
+    {
+        const GpuProfileZone<wgpu::CommandEncoder> readback_zone{
+            encoder, "Frame readback"};
+        if (!frame_readback.Capture(encoder, target_texture, frame_index))
+        {
+            LOG_WARN_RATE_LIMITED("Frame {} not read back: every readback "
+                                  "buffer is in flight",
+                                  frame_index);
+        }
+    }
 
     // Finally, encode and submit the render pass
+    ProfileZone submit_zone{"Submit"};
     wgpu::CommandBufferDescriptor cmdBufferDescriptor = {};
     cmdBufferDescriptor.label = "Command buffer";
     wgpu::CommandBuffer command = encoder.finish(cmdBufferDescriptor);
     encoder.release();
 
-    spdlog::trace("Submitting command...");
-    debug_assert(
-        queue.has_value(),
-        std::runtime_error(fmt::format("Queue should be initialised before "
-                                       "entering the main loop: [{}:{}]",
-                                       __FILE__,
-                                       __LINE__)));
+    LOG_TRACE_RATE_LIMITED("Submitting command...");
+    debug_assert(queue.has_value(),
+                 "Queue should be initialised before entering the main loop");
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
     queue.value().submit(1, &command);
+    // Counted before the callback is registered, which may run at once on
+    // a poll thread
+    frames_in_flight.Submitted(FramesInFlight::Clock::now());
+    wgpuQueueOnSubmittedWorkDone(
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        queue.value(),
+        [](WGPUQueueWorkDoneStatus status, void *user_data) {
+            if (status != WGPUQueueWorkDoneStatus_Success)
+            {
+                LOG_WARN_RATE_LIMITED("Queue work done with status {}",
+                                      status);
+            }
+            // Even failed work frees its slot, or nothing would be drawn
+            static_cast<FramesInFlight *>(user_data)->Completed(
+                FramesInFlight::Clock::now());
+        },
+        &frames_in_flight);
+    frame_readback.Submitted();
+    submit_zone.End();
+    recorder.EndFrame();
+    scheduler.FrameRendered();
+    utilisation.FrameRendered(sizeof(float) +
+                              scene.LastStats().bytes_uploaded +
+                              batch_renderer.LastStats().bytes_uploaded);
 
     command.release();
-    spdlog::trace("Command submitted.");
+    LOG_TRACE_RATE_LIMITED("Command submitted.");
 
     // At the end of the frame
     target_view.value().release();
+#ifndef WEBGPU_BACKEND_WGPU
+    target_texture.release();
+#endif
+#ifndef __EMSCRIPTEN__
+    debug_assert(surface.has_value(),
+                 "Surface should be initialised before entering the main "
+                 "loop");
+    {
+        const ProfileZone present_zone{"Present"};
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        surface.value().present();
+    }
+#endif
+    timing.FramePresented(FrameTimingMonitor::Clock::now());
+
+    if (!first_frame_presented)
+    {
+        first_frame_presented = true;
+        const std::chrono::duration<double, std::milli> time_to_first_frame{
+            std::chrono::steady_clock::now() - start_time};
+        spdlog::info("Time to first frame: {:.2f} ms ({} buffer bytes and {} "
+                     "texture bytes uploaded)",
+                     time_to_first_frame.count(),
+                     buffer_bytes_uploaded,
+                     texture_loader.BytesUploaded());
+    }
+
+    const ProfileZone poll_zone{"Poll device"};
+    if (threading != ThreadingModel::RenderAndPollThreads)
+    {
+        PollDevice(false);
+    }
+    // Readback buffers map during the poll
+    frame_readback.Poll(frame_index);
+    ++frame_index;
+}
+
+bool Application::IsRunning()
+{
+    return glfwWindowShouldClose(window) == 0;
+}
+
 #ifndef __EMSCRIPTEN__
-    debug_assert(
-        surface.has_value(),
-        std::runtime_error(fmt::format("Surface should be initialised before "
-                                       "entering the main loop: [{}:{}]",
-                                       __FILE__,
-                                       __LINE__)));
-    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-    surface.value().present();
+void Application::Run()
+{
+    if (threading == ThreadingModel::MainThread)
+    {
+        while (IsRunning())
+        {
+            MainLoop();
+        }
+        return;
+    }
+
+    std::atomic<bool> stop_polling{false};
+    std::thread poll_thread{};
+    if (threading == ThreadingModel::RenderAndPollThreads)
+    {
+        poll_thread = std::thread{[this, &stop_polling]() {
+            Profiler::SetThreadName("Device poll");
+            while (!stop_polling.load())
+            {
+                PollDevice(false);
+                std::this_thread::sleep_for(constants::kDevicePollInterval);
+            }
+        }};
+    }
+    // The render thread owns the device, and everything drawn with it, until
+    // it is joined. Anything it throws is rethrown here once it has stopped,
+    // for main to report.
+    std::exception_ptr render_error{nullptr};
+    std::thread render_thread{[this, &render_error]() {
+        Profiler::SetThreadName("Render");
+        try
+        {
+            while (!input.IsCloseRequested())
+            {
+                MainLoop();
+            }
+        }
+        catch (...)
+        {
+            render_error = std::current_exception();
+            input.RequestClose();
+            glfwPostEmptyEvent();
+        }
+    }};
+
+    // Meanwhile this thread only pumps window events into the input queue
+    while (IsRunning() && !input.IsCloseRequested())
+    {
+        glfwWaitEvents();
+    }
+    input.RequestClose();
+    render_thread.join();
+    stop_polling.store(true);
+    if (poll_thread.joinable())
+    {
+        poll_thread.join();
+    }
+    if (render_error != nullptr)
+    {
+        std::rethrow_exception(render_error);
+    }
+}
+#endif
+
+void Application::WaitForEvents()
+{
+    const ProfileZone profile_zone{"WaitForEvents"};
+#ifndef __EMSCRIPTEN__
+    // With a render thread, the main thread pumps events into the queue
+    const bool pumps_events{threading == ThreadingModel::MainThread};
+    if (scheduler.NeedsFrame() || animating || input.HasPending())
+    {
+        if (pumps_events)
+        {
+            glfwPollEvents();
+        }
+        return;
+    }
+
+    // Let submitted work, and its callbacks, finish before sleeping
+    if (threading != ThreadingModel::RenderAndPollThreads)
+    {
+        PollDevice(true);
+    }
+    // Wake for loading textures, and often enough to report utilisation
+    const double timeout{
+        texture_loader.HasPendingRequests()
+            ? constants::kAssetPollIntervalSeconds
+            : static_cast<double>(ReportTimer::kInterval.count())};
+    if (pumps_events)
+    {
+        glfwWaitEventsTimeout(timeout);
+    }
+    else
+    {
+        input.WaitFor(std::chrono::duration<double>{timeout});
+    }
+#else
+    // The browser schedules frames itself, so there is nothing to wait on
+    glfwPollEvents();
 #endif
+}
 
-    debug_assert(
-        device.has_value(),
-        std::runtime_error(fmt::format("Device should be initialised before "
-                                       "entering the main loop: [{}:{}]",
-                                       __FILE__,
-                                       __LINE__)));
+void Application::ProcessInput()
+{
+    const ProfileZone profile_zone{"ProcessInput"};
+    while (const std::optional<InputEvent> event{input.Pop()})
+    {
+        timing.InputHandled(event->received);
+        if (event->kind == InputKind::Key && event->code == GLFW_KEY_SPACE &&
+            event->action == GLFW_PRESS)
+        {
+            animating = !animating;
+        }
+        if (event->kind == InputKind::Key && event->code == GLFW_KEY_P &&
+            event->action == GLFW_PRESS)
+        {
+            WriteProfile();
+        }
+        scheduler.MarkDirty(event->kind == InputKind::Refresh ? Damage::Resize
+                                                              : Damage::Input);
+    }
+    // The window is not resizable, so there is no surface to reconfigure,
+    // but the window system may still have discarded its contents
+    if (const std::optional<InputQueue::Size> size{input.TakeResize()})
+    {
+        LOG_DEBUG_RATE_LIMITED(
+            "Framebuffer resized to {}x{}", size->first, size->second);
+        scheduler.MarkDirty(Damage::Resize);
+    }
+}
+
+void Application::UpdateAnimation()
+{
+    const double now{glfwGetTime()};
+    if (animating)
+    {
+        animation_time += now - last_animation_update;
+        scheduler.MarkDirty(Damage::Animation);
+    }
+    last_animation_update = now;
+}
+
+void Application::UpdateScene()
+{
+    if (animating)
+    {
+        const auto angle{static_cast<float>(animation_time)};
+        scene.SetLocal(
+            scene_orbit,
+            MakeSceneTransform(constants::kOrbitRadius * std::cos(angle),
+                               constants::kOrbitRadius * std::sin(angle),
+                               0.0F,
+                               1.0F));
+        // A different slice of the extra nodes turns each frame
+        const uint32_t moved{
+            extra_scene_nodes == 0
+                ? 0
+                : std::max(extra_scene_nodes / constants::kSceneMovedFraction,
+                           1U)};
+        for (uint32_t node{0}; node < moved; ++node)
+        {
+            const SceneGraph::NodeId extra_node{first_extra_node +
+                                                moved_scene_cursor};
+            const SceneTransform &local{scene.Local(extra_node)};
+            scene.SetLocal(extra_node,
+                           MakeSceneTransform(local.translation[0],
+                                              local.translation[1],
+                                              angle,
+                                              1.0F));
+            moved_scene_cursor = (moved_scene_cursor + 1) % extra_scene_nodes;
+        }
+    }
+
+    debug_assert(queue.has_value() && scene_buffer.has_value(),
+                 "Queue and Scene Buffer should be initialised before "
+                 "updating the scene");
+    scene.Update([this](uint64_t offset, const void *data, size_t size) {
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        queue.value().writeBuffer(scene_buffer.value(), offset, data, size);
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        recorder.WriteBuffer(scene_buffer.value(), offset, data, size);
+    });
+    LOG_DEBUG_RATE_LIMITED("Scene graph: {} nodes changed, {} transforms "
+                           "recomputed, {} uploads of {} bytes",
+                           scene.LastStats().changed,
+                           scene.LastStats().recomputed,
+                           scene.LastStats().uploads,
+                           scene.LastStats().bytes_uploaded);
+}
+
+void Application::PollDevice(bool wait)
+{
+    debug_assert(device.has_value(),
+                 "Device should be initialised before entering the main loop");
 #if defined(WEBGPU_BACKEND_DAWN)
+    static_cast<void>(wait);
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
     wgpuDeviceTick(device.value());
 #elif defined(WEBGPU_BACKEND_WGPU)
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-    wgpuDevicePoll(device.value(), 0U, nullptr);
+    wgpuDevicePoll(device.value(), wait ? 1U : 0U, nullptr);
+#else
+    static_cast<void>(wait);
 #endif
 }
 
-bool Application::IsRunning()
+void Application::QueueInput(GLFWwindow *event_window, InputEvent event)
 {
-    return glfwWindowShouldClose(window) == 0;
+    event.received = std::chrono::steady_clock::now();
+    static_cast<Application *>(glfwGetWindowUserPointer(event_window))
+        ->input.Push(event);
+}
+
+void Application::OnKey(GLFWwindow *event_window,
+                        int key,
+                        int scancode,
+                        int action,
+                        int mods)
+{
+    key_callback(event_window, key, scancode, action, mods);
+    InputEvent event{};
+    event.kind = InputKind::Key;
+    event.code = key;
+    event.action = action;
+    event.mods = mods;
+    QueueInput(event_window, event);
 }
 
-std::optional<wgpu::TextureView> Application::GetNextSurfaceTextureView()
+void Application::LogStatistics()
+{
+    const auto now{std::chrono::steady_clock::now()};
+    if (gpu_memory.IsSummaryDue(now))
+    {
+        spdlog::info("{}", gpu_memory.Summary());
+        spdlog::info("{}", object_cache.Summary());
+        spdlog::info("{}", scene.Summary());
+        if (frame_readback.IsActive())
+        {
+            spdlog::info("{}", frame_readback.Summary());
+        }
+    }
+    const std::optional<std::string> in_flight_report{
+        frames_in_flight.Sample(now)};
+    if (in_flight_report.has_value())
+    {
+        spdlog::info("{}", in_flight_report.value());
+    }
+    const std::optional<std::string> timing_report{timing.Sample(now)};
+    if (timing_report.has_value())
+    {
+        spdlog::info("{} ({}, {} input events dropped)",
+                     timing_report.value(),
+                     threading_model_name(threading),
+                     input.Dropped());
+    }
+    const std::optional<std::string> report{utilisation.Sample(
+        now,
+        UtilisationMonitor::CpuTime{static_cast<double>(std::clock()) /
+                                    CLOCKS_PER_SEC})};
+    if (report.has_value())
+    {
+        spdlog::info("{}", report.value());
+    }
+}
+
+void Application::WriteProfile()
+{
+    if (!profile_path.has_value())
+    {
+        return;
+    }
+    if (!Profiler::WriteTrace(profile_path.value()))
+    {
+        spdlog::error("Could not write the profile to {}",
+                      profile_path.value().string());
+        return;
+    }
+    spdlog::info("Wrote {} profiler zones to {} ({} dropped)",
+                 Profiler::CollectedCount(),
+                 profile_path.value().string(),
+                 Profiler::Dropped());
+}
+
+std::optional<wgpu::TextureView> Application::GetNextSurfaceTextureView(
+    wgpu::Texture &target_texture)
 {
     // Get the surface texture
     wgpu::SurfaceTexture surfaceTexture;
     debug_assert(surface.has_value(),
-                 std::runtime_error(fmt::format(
-                     "Surface should be initialise before getting the "
-                     "current texture: [{}:{}]",
-                     __FILE__,
-                     __LINE__)));
+                 "Surface should be initialise before getting the current "
+                 "texture");
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
     surface.value().getCurrentTexture(&surfaceTexture);
 
@@ -546,34 +1432,172 @@ std::optional<wgpu::TextureView> Application::GetNextSurfaceTextureView()
     viewDescriptor.arrayLayerCount = 1;
     viewDescriptor.aspect = wgpu::TextureAspect::All;
     const wgpu::TextureView targetView = texture.createView(viewDescriptor);
-
-#ifndef WEBGPU_BACKEND_WGPU
-    Texture(surfaceTexture.texture).release();
-#endif
+    target_texture = texture;
 
     return targetView;
 }
 
 void Application::InitialisePipeline()
 {
+    const ProfileZone profile_zone{"InitialisePipeline"};
     spdlog::info("Creating shader module...");
-    debug_assert(
-        device.has_value(),
-        std::runtime_error(fmt::format("Device should be initialised before "
-                                       "creating a shader module: [{}:{}]",
-                                       __FILE__,
-                                       __LINE__)));
-    wgpu::ShaderModule shader_module{ResourceManager::load_shader_module(
-        RESOURCE_DIR "/shader.wgsl",
+    debug_assert(device.has_value(),
+                 "Device should be initialised before creating a shader "
+                 "module");
+    // Kept for the lifetime of the cache, which creates permutations lazily
+    shader_module = std::optional<wgpu::ShaderModule>{
         // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        device.value())};
+        ResourceManager::load_shader_module("shader.wgsl", device.value())};
 
-    if (shader_module == nullptr)
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    if (shader_module.value() == nullptr)
     {
         spdlog::error("Could not load shader.");
-        std::abort();
+        Logging::Abort();
+    }
+    if (recorder.IsRecording())
+    {
+        const std::optional<ResourceBlob> source{
+            ResourceManager::read("shader.wgsl")};
+        recorder.CreateShaderModule(
+            // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+            shader_module.value(),
+            source.has_value() ? source.value().data() : std::string_view{});
+    }
+
+    std::array<wgpu::BindGroupLayoutEntry, 4> binding_layouts{};
+
+    // uniform binding
+    wgpu::BindGroupLayoutEntry &uniform_binding_layout{binding_layouts[0]};
+    uniform_binding_layout = wgpu::Default;
+    uniform_binding_layout.binding = 0;
+    uniform_binding_layout.visibility =
+        wgpu::ShaderStage::Vertex | wgpu::ShaderStage::Fragment;
+    uniform_binding_layout.buffer.type = wgpu::BufferBindingType::Uniform;
+    uniform_binding_layout.buffer.minBindingSize = sizeof(MyUniforms);
+
+    // texture binding
+    wgpu::BindGroupLayoutEntry &texture_binding_layout{binding_layouts[1]};
+    texture_binding_layout = wgpu::Default;
+    texture_binding_layout.binding = 1;
+    texture_binding_layout.visibility = wgpu::ShaderStage::Fragment;
+    texture_binding_layout.texture.sampleType = wgpu::TextureSampleType::Float;
+    texture_binding_layout.texture.viewDimension =
+        wgpu::TextureViewDimension::_2D;
+
+    // sampler binding
+    wgpu::BindGroupLayoutEntry &sampler_binding_layout{binding_layouts[2]};
+    sampler_binding_layout = wgpu::Default;
+    sampler_binding_layout.binding = 2;
+    sampler_binding_layout.visibility = wgpu::ShaderStage::Fragment;
+    sampler_binding_layout.sampler.type = wgpu::SamplerBindingType::Filtering;
+
+    // scene graph world transforms binding
+    wgpu::BindGroupLayoutEntry &scene_binding_layout{binding_layouts[3]};
+    scene_binding_layout = wgpu::Default;
+    scene_binding_layout.binding = 3;
+    scene_binding_layout.visibility = wgpu::ShaderStage::Vertex;
+    scene_binding_layout.buffer.type = wgpu::BufferBindingType::ReadOnlyStorage;
+    scene_binding_layout.buffer.minBindingSize = sizeof(SceneTransform);
+
+    wgpu::BindGroupLayoutDescriptor bind_group_layout_descriptor{};
+    bind_group_layout_descriptor.entryCount =
+        static_cast<uint32_t>(binding_layouts.size());
+    bind_group_layout_descriptor.entries = binding_layouts.data();
+    bind_group_layout = std::optional<wgpu::BindGroupLayout>{
+        object_cache.GetBindGroupLayout(bind_group_layout_descriptor)};
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.CreateBindGroupLayout(bind_group_layout.value(),
+                                   bind_group_layout_descriptor);
+
+    wgpu::PipelineLayoutDescriptor layout_descriptor{};
+    layout_descriptor.bindGroupLayoutCount = 1;
+    layout_descriptor.bindGroupLayouts =
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access,cppcoreguidelines-pro-type-cstyle-cast)
+        (WGPUBindGroupLayout *)&bind_group_layout.value();
+    layout = std::optional<wgpu::PipelineLayout>{
+        object_cache.GetPipelineLayout(layout_descriptor)};
+
+    pipeline_cache.Initialise(
+        [this](const PipelineConstants &constants) {
+            return CreateRenderPipeline(constants);
+        },
+        [this](wgpu::RenderPipeline &permutation) {
+            object_cache.Release(permutation);
+        });
+
+    // The placeholder texture is plain white, so draw without sampling it
+    // until the real texture has loaded, and have that permutation ready
+    pipeline_cache.Prewarm({GetPipelineConstants(true)});
+    pipeline = pipeline_cache.Get(GetPipelineConstants(false));
+    if (show_frame_graph)
+    {
+        overlay_pipeline = pipeline_cache.Get(GetOverlayPipelineConstants());
     }
 
+    spdlog::info("Created render pipeline");
+}
+
+PipelineConstants Application::GetPipelineConstants(bool use_texture)
+{
+    return {{"aspect_ratio",
+             static_cast<double>(constants::kWindowWidth) /
+                 static_cast<double>(constants::kWindowHeight)},
+            {"use_texture", use_texture ? 1.0 : 0.0}};
+}
+
+PipelineConstants Application::GetOverlayPipelineConstants()
+{
+    return {{"aspect_ratio", 1.0},
+            {"offset_x", 0.0},
+            {"offset_y", 0.0},
+            {"use_scene_node", 0.0},
+            {"use_texture", 0.0},
+            {"use_uniform_colour", 0.0}};
+}
+
+std::vector<wgpu::ConstantEntry> Application::GetConstantEntries(
+    const PipelineConstants &constants,
+    std::initializer_list<std::string_view> keys)
+{
+    std::vector<wgpu::ConstantEntry> entries{};
+    for (const std::string_view key : keys)
+    {
+        const auto constant{constants.find(std::string{key})};
+        if (constant == constants.end())
+        {
+            continue;
+        }
+        wgpu::ConstantEntry entry{};
+        entry.key = constant->first.c_str();
+        entry.value = constant->second;
+        entries.push_back(entry);
+    }
+    return entries;
+}
+
+wgpu::RenderPipeline Application::CreateRenderPipeline(
+    const PipelineConstants &constants)
+{
+    debug_assert(device.has_value() && shader_module.has_value() &&
+                     layout.has_value(),
+                 "Device, shader module and pipeline layout should be "
+                 "initialised before creating a pipeline");
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    const wgpu::ShaderModule module{shader_module.value()};
+
+    // Each stage only gets the overrides its entry point uses
+    const std::vector<wgpu::ConstantEntry> vertex_constants{GetConstantEntries(
+        constants,
+        {"aspect_ratio", "offset_x", "offset_y", "use_scene_node"})};
+    const std::vector<wgpu::ConstantEntry> fragment_constants{
+        GetConstantEntries(
+            constants,
+            {"use_texture",
+             "use_uniform_colour",
+             "texture_taps",
+             "texture_tap_spacing"})};
+
     // Create the render pipeline
     wgpu::RenderPipelineDescriptor pipeline_descriptor{};
     pipeline_descriptor.label = "Render pipeline";
@@ -601,10 +1625,10 @@ void Application::InitialisePipeline()
     pipeline_descriptor.vertex.bufferCount = 1;
     pipeline_descriptor.vertex.buffers = &vertex_buffer_layout;
 
-    pipeline_descriptor.vertex.module = shader_module;
+    pipeline_descriptor.vertex.module = module;
     pipeline_descriptor.vertex.entryPoint = "vs_main";
-    pipeline_descriptor.vertex.constantCount = 0;
-    pipeline_descriptor.vertex.constants = nullptr;
+    pipeline_descriptor.vertex.constantCount = vertex_constants.size();
+    pipeline_descriptor.vertex.constants = vertex_constants.data();
 
     // Each sequence of 3 vertices is considered as a triangle
     pipeline_descriptor.primitive.topology =
@@ -621,10 +1645,10 @@ void Application::InitialisePipeline()
     pipeline_descriptor.primitive.cullMode = wgpu::CullMode::None;
 
     wgpu::FragmentState fragment_state{};
-    fragment_state.module = shader_module;
+    fragment_state.module = module;
     fragment_state.entryPoint = "fs_main";
-    fragment_state.constantCount = 0;
-    fragment_state.constants = nullptr;
+    fragment_state.constantCount = fragment_constants.size();
+    fragment_state.constants = fragment_constants.data();
 
     wgpu::BlendState blend_state{};
     blend_state.color.srcFactor = wgpu::BlendFactor::SrcAlpha;
@@ -648,44 +1672,17 @@ void Application::InitialisePipeline()
     pipeline_descriptor.multisample.mask = ~0U;
 
     pipeline_descriptor.multisample.alphaToCoverageEnabled = 0U;
-    wgpu::BindGroupLayoutEntry binding_layout{wgpu::Default};
-    binding_layout.binding = 0;
-    binding_layout.visibility =
-        wgpu::ShaderStage::Vertex | wgpu::ShaderStage::Fragment;
-    binding_layout.buffer.type = wgpu::BufferBindingType::Uniform;
-    binding_layout.buffer.minBindingSize = sizeof(MyUniforms);
-
-    wgpu::BindGroupLayoutDescriptor bind_group_layout_descriptor{};
-    bind_group_layout_descriptor.entryCount = 1;
-    bind_group_layout_descriptor.entries = &binding_layout;
-    bind_group_layout = std::optional<wgpu::BindGroupLayout>{
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        device.value().createBindGroupLayout(bind_group_layout_descriptor)};
-
-    wgpu::PipelineLayoutDescriptor layout_descriptor{};
-    layout_descriptor.bindGroupLayoutCount = 1;
-    layout_descriptor.bindGroupLayouts =
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access,cppcoreguidelines-pro-type-cstyle-cast)
-        (WGPUBindGroupLayout *)&bind_group_layout.value();
-    layout = std::optional<wgpu::PipelineLayout>{
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        device.value().createPipelineLayout(layout_descriptor)};
 
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
     pipeline_descriptor.layout = layout.value();
 
-    debug_assert(
-        device.has_value(),
-        std::runtime_error(fmt::format("Device should be initialised before "
-                                       "the pipeline: [{}:{}]",
-                                       __FILE__,
-                                       __LINE__)));
-    pipeline = std::optional<wgpu::RenderPipeline>{
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        device.value().createRenderPipeline(pipeline_descriptor)};
-
-    spdlog::info("Created render pipeline");
-    shader_module.release();
+    const wgpu::RenderPipeline render_pipeline{
+        object_cache.GetRenderPipeline(pipeline_descriptor, GPU_CALL_SITE)};
+    recorder.CreateRenderPipeline(render_pipeline,
+                                  pipeline_descriptor,
+                                  // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+                                  bind_group_layout.value());
+    return render_pipeline;
 }
 
 wgpu::RequiredLimits Application::GetRequiredLimits(wgpu::Adapter adapter)
@@ -697,14 +1694,37 @@ wgpu::RequiredLimits Application::GetRequiredLimits(wgpu::Adapter adapter)
 
     required_limits.limits.maxVertexAttributes = 2;
     required_limits.limits.maxVertexBuffers = 1;
-    constexpr int kNumPoints{15};
+    // Large enough for the staging buffer of a 1024 x 1024 RGBA8 texture
+    constexpr uint64_t kMaxTextureStagingBytes{1'024ULL * 1'024 * 4};
+    constexpr uint64_t kMaxSceneBytes{uint64_t{constants::kMaxSceneNodes} *
+                                      sizeof(SceneTransform)};
     required_limits.limits.maxBufferSize =
-        static_cast<long>(kNumPoints) * 5 * sizeof(float);
+        std::min(std::max(kMaxTextureStagingBytes, kMaxSceneBytes),
+                 supported_limits.limits.maxBufferSize);
     required_limits.limits.maxVertexBufferArrayStride = 5 * sizeof(float);
-    required_limits.limits.maxInterStageShaderComponents = 3;
+    required_limits.limits.maxInterStageShaderComponents = 5;
 
     required_limits.limits.maxBindGroups = 1;
+    required_limits.limits.maxBindingsPerBindGroup = 4;
     required_limits.limits.maxUniformBuffersPerShaderStage = 1;
+    required_limits.limits.maxSampledTexturesPerShaderStage = 1;
+    required_limits.limits.maxSamplersPerShaderStage = 1;
+    required_limits.limits.maxStorageBuffersPerShaderStage = 1;
+    required_limits.limits.maxStorageBufferBindingSize =
+        std::min(kMaxSceneBytes,
+                 supported_limits.limits.maxStorageBufferBindingSize);
+    required_limits.limits.maxTextureArrayLayers = 1;
+
+    // Mipmap generation compute pass
+    constexpr uint32_t kMipmapWorkgroupSize{8};
+    required_limits.limits.maxStorageTexturesPerShaderStage = 1;
+    required_limits.limits.maxComputeWorkgroupSizeX = kMipmapWorkgroupSize;
+    required_limits.limits.maxComputeWorkgroupSizeY = kMipmapWorkgroupSize;
+    required_limits.limits.maxComputeWorkgroupSizeZ = 1;
+    required_limits.limits.maxComputeInvocationsPerWorkgroup =
+        kMipmapWorkgroupSize * kMipmapWorkgroupSize;
+    required_limits.limits.maxComputeWorkgroupsPerDimension =
+        supported_limits.limits.maxComputeWorkgroupsPerDimension;
     constexpr uint64_t kFloatBits{16};
     required_limits.limits.maxUniformBufferBindingSize = kFloatBits * 4;
 
@@ -726,19 +1746,70 @@ wgpu::RequiredLimits Application::GetRequiredLimits(wgpu::Adapter adapter)
     return required_limits;
 }
 
+void Application::InitialiseScene(uint32_t extra_nodes)
+{
+    const ProfileZone profile_zone{"InitialiseScene"};
+    // The drawn object hangs off a node orbiting the centre, so only the
+    // orbit moves
+    scene_orbit = scene.Add(
+        SceneGraph::kNoParent,
+        MakeSceneTransform(constants::kOrbitRadius, 0.0F, 0.0F, 1.0F));
+    scene_object = scene.Add(scene_orbit, SceneTransform{});
+
+    // Extra nodes, which are never drawn, in a tree added breadth first so
+    // the first Update reorders it depth first
+    constexpr float kExtraNodeSpacing{0.01F};
+    first_extra_node = scene.Size();
+    extra_scene_nodes = extra_nodes;
+    for (uint32_t node{0}; node < extra_nodes; ++node)
+    {
+        const SceneGraph::NodeId parent{
+            node == 0 ? SceneGraph::kNoParent
+                      : first_extra_node +
+                            (node - 1) / constants::kSceneBranching};
+        scene.Add(parent,
+                  MakeSceneTransform(
+                      kExtraNodeSpacing *
+                          static_cast<float>(node % constants::kSceneBranching),
+                      0.0F,
+                      0.0F,
+                      1.0F));
+    }
+
+    wgpu::BufferDescriptor buffer_descriptor{};
+    buffer_descriptor.size = scene.BufferSize();
+    buffer_descriptor.usage =
+        wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Storage;
+    buffer_descriptor.mappedAtCreation = 0U;
+    buffer_descriptor.label = "Scene transform buffer";
+    debug_assert(device.has_value() && queue.has_value(),
+                 "Device and Queue should be initialised before calling the "
+                 "InitialiseScene function");
+    scene_buffer = std::optional<wgpu::Buffer>{
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        device.value().createBuffer(buffer_descriptor)};
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    TrackBuffer(scene_buffer.value(), buffer_descriptor, GPU_CALL_SITE);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.CreateBuffer(scene_buffer.value(), buffer_descriptor);
+
+    UpdateScene();
+    buffer_bytes_uploaded += scene.LastStats().bytes_uploaded;
+    spdlog::info("Built a scene graph of {} nodes", scene.Size());
+}
+
 void Application::InitialiseBuffers()
 {
+    const ProfileZone profile_zone{"InitialiseBuffers"};
     std::vector<float> point_data;
     std::vector<uint16_t> index_data;
-    const bool success{ResourceManager::load_geometry(RESOURCE_DIR
-                                                      "/webgpu.txt",
-                                                      point_data,
-                                                      index_data)};
+    const bool success{
+        ResourceManager::load_geometry("webgpu.txt", point_data, index_data)};
 
     if (!success)
     {
         spdlog::error("Could not load geometry");
-        std::abort();
+        Logging::Abort();
     }
     index_count = static_cast<uint32_t>(index_data.size());
 
@@ -749,33 +1820,34 @@ void Application::InitialiseBuffers()
     buffer_descriptor.mappedAtCreation = 0U;
     buffer_descriptor.label = "A couple of triangle x,y-vertex sets";
     debug_assert(device.has_value(),
-                 std::runtime_error(
-                     fmt::format("Device should be initialised before calling "
-                                 "the InitialiseBuffers function: [{}:{}]",
-                                 __FILE__,
-                                 __LINE__)));
+                 "Device should be initialised before calling the "
+                 "InitialiseBuffers function");
     point_buffer = std::optional<wgpu::Buffer>{
         // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
         device.value().createBuffer(buffer_descriptor)};
 
     debug_assert(queue.has_value(),
-                 std::runtime_error(
-                     fmt::format("Queue should be initialised before calling "
-                                 "the InitialiseBuffers function: [{}:{}]",
-                                 __FILE__,
-                                 __LINE__)));
-    debug_assert(vertex_buffer.has_value(),
-                 std::runtime_error(
-                     fmt::format("Vertex Buffer should have been initialised "
-                                 "before attempting to write to it in "
-                                 "the InitialiseBuffers function: [{}:{}]",
-                                 __FILE__,
-                                 __LINE__)));
+                 "Queue should be initialised before calling the "
+                 "InitialiseBuffers function");
+    debug_assert(point_buffer.has_value(),
+                 "Point Buffer should have been initialised before "
+                 "attempting to write to it in the InitialiseBuffers "
+                 "function");
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
     queue.value().writeBuffer(point_buffer.value(),
                               0,
                               point_data.data(),
                               buffer_descriptor.size);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    TrackBuffer(point_buffer.value(), buffer_descriptor, GPU_CALL_SITE);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.CreateBuffer(point_buffer.value(), buffer_descriptor);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.WriteBuffer(point_buffer.value(),
+                         0,
+                         point_data.data(),
+                         buffer_descriptor.size);
+    buffer_bytes_uploaded += buffer_descriptor.size;
 
     // Create index buffer
     buffer_descriptor.size = index_data.size() * sizeof(uint16_t);
@@ -783,8 +1855,13 @@ void Application::InitialiseBuffers()
         (buffer_descriptor.size + 3) &
         static_cast<uint64_t>(
             ~(uint8_t)3); // round up to the next multiple of 4
+    // Pad with zeros to the rounded size, so that neither the upload nor the
+    // trace reads past the end of the indices. index_count excludes them.
+    index_data.resize(
+        static_cast<size_t>(buffer_descriptor.size / sizeof(uint16_t)));
     buffer_descriptor.usage =
         wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Index;
+    buffer_descriptor.label = "Index buffer";
     index_buffer = std::optional<wgpu::Buffer>{
         // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
         device.value().createBuffer(buffer_descriptor)};
@@ -794,12 +1871,23 @@ void Application::InitialiseBuffers()
                               0,
                               index_data.data(),
                               buffer_descriptor.size);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    TrackBuffer(index_buffer.value(), buffer_descriptor, GPU_CALL_SITE);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.CreateBuffer(index_buffer.value(), buffer_descriptor);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.WriteBuffer(index_buffer.value(),
+                         0,
+                         index_data.data(),
+                         buffer_descriptor.size);
+    buffer_bytes_uploaded += buffer_descriptor.size;
 
     // Create uniform buffer
     buffer_descriptor.size = sizeof(MyUniforms);
     buffer_descriptor.usage =
         wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Uniform;
     buffer_descriptor.mappedAtCreation = 0U;
+    buffer_descriptor.label = "Uniform buffer";
 
     uniform_buffer = std::optional<wgpu::Buffer>{
         // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
@@ -813,6 +1901,7 @@ void Application::InitialiseBuffers()
     const MyUniforms uniforms{
         {kRedIntensity, kGreenIntensity, kBlueIntensity, 1.0F}, // colour
         current_time,                                           // time
+        scene.Index(scene_object),                              // node
         {}                                                      // _pad
     };
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
@@ -820,47 +1909,368 @@ void Application::InitialiseBuffers()
                               0,
                               &uniforms,
                               sizeof(MyUniforms));
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    TrackBuffer(uniform_buffer.value(), buffer_descriptor, GPU_CALL_SITE);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.CreateBuffer(uniform_buffer.value(), buffer_descriptor);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.WriteBuffer(uniform_buffer.value(),
+                         0,
+                         &uniforms,
+                         sizeof(MyUniforms));
+    buffer_bytes_uploaded += sizeof(MyUniforms);
+}
+
+void Application::InitialiseBatchRenderer()
+{
+    const ProfileZone profile_zone{"InitialiseBatchRenderer"};
+    // Only overlays draw through the batch renderer
+    if (!show_frame_graph)
+    {
+        return;
+    }
+    debug_assert(device.has_value() && queue.has_value(),
+                 "Device and Queue should be initialised before the batch "
+                 "renderer");
+    using Batches = BatchRenderer<WebGpuDrawTypes>;
+
+    wgpu::BufferDescriptor buffer_descriptor{};
+    buffer_descriptor.size =
+        Batches::VertexBufferSize(constants::kBatchQuadsPerFrame,
+                                  frames_in_flight.Limit());
+    buffer_descriptor.usage =
+        wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Vertex;
+    buffer_descriptor.mappedAtCreation = 0U;
+    buffer_descriptor.label = "Batch vertex buffer";
+    batch_vertex_buffer = std::optional<wgpu::Buffer>{
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        device.value().createBuffer(buffer_descriptor)};
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    TrackBuffer(batch_vertex_buffer.value(), buffer_descriptor, GPU_CALL_SITE);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.CreateBuffer(batch_vertex_buffer.value(), buffer_descriptor);
+
+    buffer_descriptor.size =
+        Batches::IndexBufferSize(constants::kBatchQuadsPerFrame,
+                                 frames_in_flight.Limit());
+    buffer_descriptor.usage =
+        wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::Index;
+    buffer_descriptor.label = "Batch index buffer";
+    batch_index_buffer = std::optional<wgpu::Buffer>{
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        device.value().createBuffer(buffer_descriptor)};
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    TrackBuffer(batch_index_buffer.value(), buffer_descriptor, GPU_CALL_SITE);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.CreateBuffer(batch_index_buffer.value(), buffer_descriptor);
+
+    batch_renderer.Initialise(
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        batch_vertex_buffer.value(),
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        batch_index_buffer.value(),
+        wgpu::IndexFormat::Uint16,
+        constants::kBatchQuadsPerFrame,
+        constants::kBatchQuadsPerBatch,
+        // A region for each frame slot
+        frames_in_flight.Limit(),
+        [this](wgpu::Buffer buffer,
+               uint64_t offset,
+               const void *data,
+               size_t size) {
+            // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+            queue.value().writeBuffer(buffer, offset, data, size);
+            recorder.WriteBuffer(buffer, offset, data, size);
+        },
+        [this](const RenderQueue<WebGpuDrawTypes>::DrawPacket &packet) {
+            render_queue.Push(packet);
+        });
+}
+
+bool Application::InitialiseReadback(const std::filesystem::path &directory)
+{
+    const ProfileZone profile_zone{"InitialiseReadback"};
+    std::error_code error{};
+    std::filesystem::create_directories(directory, error);
+    if (error)
+    {
+        spdlog::error("Could not create readback directory {}: {}",
+                      directory.string(),
+                      error.message());
+        return false;
+    }
+    debug_assert(device.has_value(),
+                 "Device should be initialised before frame readback");
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    if (!frame_readback.Initialise(device.value(),
+                                   constants::kWindowWidth,
+                                   constants::kWindowHeight,
+                                   surface_format,
+                                   FrameReadback::kDefaultBufferCount,
+                                   frame_consumer,
+                                   gpu_memory))
+    {
+        return false;
+    }
+    frame_consumer.Start(
+        [directory](const ReadbackFrame &frame) {
+            const std::filesystem::path path{
+                directory / fmt::format("frame_{:06}.ppm", frame.frame_index)};
+            if (!WritePpm(path, frame))
+            {
+                LOG_ERROR_RATE_LIMITED("Could not write {}", path.string());
+            }
+        },
+        FrameConsumer::kDefaultQueueLength);
+    spdlog::info("Reading frames back into {}", directory.string());
+    return true;
+}
+
+void Application::InitialiseTextures()
+{
+    const ProfileZone profile_zone{"InitialiseTextures"};
+    debug_assert(device.has_value() && queue.has_value(),
+                 "Device and Queue should be initialised before calling the "
+                 "InitialiseTextures function");
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    if (!texture_loader.Initialise(device.value(),
+                                   // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+                                   queue.value(),
+                                   "mipmap_generation.wgsl"))
+    {
+        spdlog::error("Could not initialise texture loader");
+        Logging::Abort();
+    }
+
+    wgpu::SamplerDescriptor sampler_descriptor{};
+    sampler_descriptor.label = "Colour texture sampler";
+    sampler_descriptor.addressModeU = wgpu::AddressMode::Repeat;
+    sampler_descriptor.addressModeV = wgpu::AddressMode::Repeat;
+    sampler_descriptor.addressModeW = wgpu::AddressMode::ClampToEdge;
+    sampler_descriptor.magFilter = wgpu::FilterMode::Linear;
+    sampler_descriptor.minFilter = wgpu::FilterMode::Linear;
+    sampler_descriptor.mipmapFilter = wgpu::MipmapFilterMode::Linear;
+    sampler_descriptor.lodMinClamp = 0.0F;
+    constexpr float kMaxLod{32.0F};
+    sampler_descriptor.lodMaxClamp = kMaxLod;
+    sampler_descriptor.compare = wgpu::CompareFunction::Undefined;
+    sampler_descriptor.maxAnisotropy = 1;
+    sampler = std::optional<wgpu::Sampler>{
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        device.value().createSampler(sampler_descriptor)};
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.CreateSampler(sampler.value(), sampler_descriptor);
+
+    // Draw with a plain white texture until the real one has loaded, so the
+    // first frames do not wait on image decoding
+    ImageData placeholder{};
+    placeholder.width = 1;
+    placeholder.height = 1;
+    placeholder.levels.push_back({UINT8_MAX, UINT8_MAX, UINT8_MAX, UINT8_MAX});
+    const LoadedTexture placeholder_texture{
+        texture_loader.Upload(placeholder, "Placeholder texture")};
+    texture = placeholder_texture.texture;
+    texture_view = placeholder_texture.view;
+    TrackTexture(placeholder_texture, GPU_CALL_SITE);
+    recorder.CreateTexture(placeholder_texture.texture);
+    recorder.CreateTextureView(placeholder_texture.view,
+                               placeholder_texture.texture);
+
+    texture_loader.Request("texture.ppm");
+}
+
+void Application::UpdateTextures()
+{
+    const ProfileZone profile_zone{"UpdateTextures"};
+    if (!texture_loader.HasPendingRequests())
+    {
+        return;
+    }
+
+    for (const LoadedTexture &loaded : texture_loader.Poll())
+    {
+        if (texture_view.has_value())
+        {
+            texture_view.value().release();
+        }
+        if (texture.has_value())
+        {
+            gpu_memory.Untrack(texture.value());
+            texture.value().destroy();
+            texture.value().release();
+        }
+        texture = loaded.texture;
+        texture_view = loaded.view;
+        TrackTexture(loaded, GPU_CALL_SITE);
+        recorder.CreateTexture(loaded.texture);
+        recorder.CreateTextureView(loaded.view, loaded.texture);
+        InitialiseBindGroups();
+        // Prewarmed in InitialisePipeline, so this should not stall
+        pipeline = pipeline_cache.Get(GetPipelineConstants(true));
+        scheduler.MarkDirty(Damage::Asset);
+
+        const std::chrono::duration<double, std::milli> time_to_texture{
+            std::chrono::steady_clock::now() - start_time};
+        spdlog::info("Texture ready {:.2f} ms after start-up ({} texture "
+                     "bytes uploaded in total)",
+                     time_to_texture.count(),
+                     texture_loader.BytesUploaded());
+    }
+}
+
+void Application::DrawFrameGraph(uint32_t frame_slot)
+{
+    const ProfileZone profile_zone{"DrawFrameGraph"};
+    const double now{glfwGetTime()};
+    if (last_frame_start.has_value())
+    {
+        frame_times.push_back(now - last_frame_start.value());
+        if (frame_times.size() > constants::kFrameGraphSamples)
+        {
+            frame_times.pop_front();
+        }
+    }
+    last_frame_start = now;
+    if (!overlay_pipeline.has_value() || !bind_group.has_value())
+    {
+        return;
+    }
+
+    // After the scene, which is in render queue pass 0
+    constexpr uint32_t kOverlayPass{1};
+    // The graph's place in clip space
+    constexpr float kLeft{-0.95F};
+    constexpr float kBottom{-0.95F};
+    constexpr float kWidth{0.9F};
+    constexpr float kHeight{0.4F};
+    constexpr float kBarWidth{
+        kWidth / static_cast<float>(constants::kFrameGraphSamples)};
+    constexpr float kBudgetLineWidth{0.005F};
+    constexpr double kFrameBudgetSeconds{1.0 / 60.0};
+    constexpr BatchColour kBackground{0.1F, 0.1F, 0.1F};
+    constexpr BatchColour kWithinBudget{0.2F, 0.8F, 0.3F};
+    constexpr BatchColour kOverBudget{0.9F, 0.3F, 0.2F};
+    constexpr BatchColour kBudgetLine{0.9F, 0.9F, 0.9F};
+
+    batch_renderer.Begin(kOverlayPass, frame_slot);
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    batch_renderer.SetState(overlay_pipeline.value(), bind_group.value());
+    batch_renderer.Quad(
+        kLeft, kBottom, kLeft + kWidth, kBottom + kHeight, kBackground);
+    float bar_left{kLeft};
+    for (const double frame_time : frame_times)
+    {
+        const auto share{static_cast<float>(
+            std::min(frame_time / constants::kFrameGraphSpanSeconds, 1.0))};
+        batch_renderer.Quad(bar_left,
+                            kBottom,
+                            bar_left + kBarWidth,
+                            kBottom + kHeight * share,
+                            frame_time > kFrameBudgetSeconds ? kOverBudget
+                                                             : kWithinBudget);
+        bar_left += kBarWidth;
+    }
+    const float budget_y{
+        kBottom + kHeight * static_cast<float>(
+                                kFrameBudgetSeconds /
+                                constants::kFrameGraphSpanSeconds)};
+    batch_renderer.Line(kLeft,
+                        budget_y,
+                        kLeft + kWidth,
+                        budget_y,
+                        kBudgetLineWidth,
+                        kBudgetLine);
+    batch_renderer.End();
+    LOG_DEBUG_RATE_LIMITED("Batch renderer: {} quads in {} batches, {} bytes "
+                           "uploaded",
+                           batch_renderer.LastStats().quads,
+                           batch_renderer.LastStats().batches,
+                           batch_renderer.LastStats().bytes_uploaded);
 }
 
 void Application::InitialiseBindGroups()
 {
+    const ProfileZone profile_zone{"InitialiseBindGroups"};
     debug_assert(bind_group_layout.has_value(),
-                 std::runtime_error(fmt::format(
-                     "Bind Group Layout should have been initialised "
-                     "before attempting to initialise bind groups "
-                     "the InitialiseBuffers function: [{}:{}]",
-                     __FILE__,
-                     __LINE__)));
+                 "Bind Group Layout should have been initialised before "
+                 "attempting to initialise bind groups the InitialiseBuffers "
+                 "function");
     debug_assert(uniform_buffer.has_value(),
-                 std::runtime_error(
-                     fmt::format("Uniform Buffer should have been initialised "
-                                 "before attempting to initialise bind groups "
-                                 "the InitialiseBuffers function: [{}:{}]",
-                                 __FILE__,
-                                 __LINE__)));
+                 "Uniform Buffer should have been initialised before "
+                 "attempting to initialise bind groups the InitialiseBuffers "
+                 "function");
+
+    debug_assert(texture_view.has_value() && sampler.has_value(),
+                 "Texture View and Sampler should have been initialised "
+                 "before attempting to initialise bind groups");
+    debug_assert(scene_buffer.has_value(),
+                 "Scene Buffer should have been initialised before "
+                 "attempting to initialise bind groups");
+
+    std::array<wgpu::BindGroupEntry, 4> bindings{};
+    bindings[0].binding = 0;
+
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    bindings[0].buffer = uniform_buffer.value();
+    bindings[0].offset = 0;
+    bindings[0].size = sizeof(MyUniforms);
 
-    wgpu::BindGroupEntry binding{};
-    binding.binding = 0;
+    bindings[1].binding = 1;
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    bindings[1].textureView = texture_view.value();
+
+    bindings[2].binding = 2;
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    bindings[2].sampler = sampler.value();
 
+    bindings[3].binding = 3;
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-    binding.buffer = uniform_buffer.value();
-    binding.offset = 0;
-    binding.size = sizeof(MyUniforms);
+    bindings[3].buffer = scene_buffer.value();
+    bindings[3].offset = 0;
+    bindings[3].size = scene.BufferSize();
 
     wgpu::BindGroupDescriptor bind_group_descriptor{};
+    bind_group_descriptor.label = "Bind group";
     // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
     bind_group_descriptor.layout = bind_group_layout.value();
-    bind_group_descriptor.entryCount = 1;
-    bind_group_descriptor.entries = &binding;
+    bind_group_descriptor.entryCount = static_cast<uint32_t>(bindings.size());
+    bind_group_descriptor.entries = bindings.data();
 
     debug_assert(device.has_value(),
-                 std::runtime_error(
-                     fmt::format("Device Buffer should have been initialised "
-                                 "before attempting to initialise bind groups "
-                                 "the InitialiseBuffers function: [{}:{}]",
-                                 __FILE__,
-                                 __LINE__)));
+                 "Device Buffer should have been initialised before "
+                 "attempting to initialise bind groups the InitialiseBuffers "
+                 "function");
+    // Called again whenever a texture is swapped in
+    if (bind_group.has_value())
+    {
+        object_cache.Release(bind_group.value());
+    }
     bind_group = std::optional<wgpu::BindGroup>{
-        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
-        device.value().createBindGroup(bind_group_descriptor)};
+        object_cache.GetBindGroup(bind_group_descriptor, GPU_CALL_SITE)};
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    recorder.CreateBindGroup(bind_group.value(), bind_group_descriptor);
+}
+
+void Application::TrackBuffer(wgpu::Buffer buffer,
+                              const wgpu::BufferDescriptor &descriptor,
+                              GpuCallSite call_site)
+{
+    gpu_memory.Track(buffer,
+                     GpuObjectCategory::Buffer,
+                     descriptor.label != nullptr ? descriptor.label : "",
+                     descriptor.size,
+                     static_cast<uint32_t>(descriptor.usage),
+                     call_site);
+}
+
+void Application::TrackTexture(const LoadedTexture &loaded,
+                               GpuCallSite call_site)
+{
+    wgpu::Texture loaded_texture{loaded.texture};
+    gpu_memory.Track(loaded_texture,
+                     GpuObjectCategory::Texture,
+                     loaded.name.empty() ? "Placeholder texture" : loaded.name,
+                     TextureLoader::ByteSize(loaded_texture),
+                     static_cast<uint32_t>(loaded_texture.getUsage()),
+                     call_site);
 }
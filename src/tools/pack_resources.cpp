@@ -0,0 +1,70 @@
+// Build-time tool that bundles every file under a directory into one
+// resource pack, named by their path relative to that directory.
+//
+// Usage: PackResources <output pack> <resource directory>
+
+#include "utilities/resource_pack.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        fmt::print(stderr,
+                   "Usage: PackResources <output pack> <resource directory>\n");
+        return EXIT_FAILURE;
+    }
+    const std::vector<std::string> arguments{argv, std::next(argv, argc)};
+    const std::filesystem::path output_path{arguments[1]};
+    const std::filesystem::path resource_directory{arguments[2]};
+
+    // Sort for reproducible output
+    std::vector<std::filesystem::path> paths;
+    for (const auto &directory_entry :
+         std::filesystem::recursive_directory_iterator(resource_directory))
+    {
+        if (directory_entry.is_regular_file())
+        {
+            paths.push_back(directory_entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    ResourcePackWriter writer;
+    for (const std::filesystem::path &path : paths)
+    {
+        std::ifstream file{path, std::ios::binary};
+        if (!file.is_open())
+        {
+            fmt::print(stderr,
+                       "Was not able to open file `{}`\n",
+                       path.string());
+            return EXIT_FAILURE;
+        }
+        std::string contents{std::istreambuf_iterator<char>(file),
+                             std::istreambuf_iterator<char>()};
+        writer.Add(std::filesystem::relative(path, resource_directory)
+                       .generic_string(),
+                   std::move(contents));
+    }
+
+    if (!writer.Write(output_path))
+    {
+        fmt::print(stderr, "Could not write `{}`\n", output_path.string());
+        return EXIT_FAILURE;
+    }
+    fmt::print("Packed {} resources into `{}`\n",
+               paths.size(),
+               output_path.string());
+    return EXIT_SUCCESS;
+}
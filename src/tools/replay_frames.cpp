@@ -0,0 +1,947 @@
+// Re-issues a frame trace recorded with `App --capture <trace>` against a
+// headless device, as fast as the device allows, and reports how long each
+// frame took from its first command to the GPU finishing its work.
+//
+// Usage: ReplayFrames <trace> [--fallback-adapter] [--repeat <count>]
+
+#define WEBGPU_CPP_IMPLEMENTATION
+#include <webgpu/webgpu.hpp>
+
+#include "utilities/frame_trace.h"
+
+#include <fmt/format.h>
+
+#include <webgpu/webgpu.h>
+#ifdef WEBGPU_BACKEND_WGPU
+#include <webgpu/wgpu.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+struct ReplayOptions
+{
+    std::filesystem::path trace_path{};
+    bool fallback_adapter{false};
+    uint32_t repeat_count{1};
+};
+
+class Replayer
+{
+public:
+    // Create a device with no surface and return true if it all went well
+    bool Initialise(bool fallback_adapter);
+
+    // Free everything that was created
+    void Terminate();
+
+    // Re-issue every command in the trace, returning the duration of each
+    // frame in milliseconds. Objects already created by an earlier pass are
+    // reused, so the trace can be replayed repeatedly.
+    [[nodiscard]] std::vector<double> Replay(FrameTraceReader &reader);
+
+    [[nodiscard]] uint32_t SkippedCommands() const;
+
+private:
+    using Op = FrameTraceFormat::Op;
+    using BindingKind = FrameTraceFormat::BindingKind;
+    using Clock = std::chrono::steady_clock;
+
+    void Execute(Op op, TracePayloadReader &payload);
+    void CreateBuffer(TracePayloadReader &payload);
+    void WriteBuffer(TracePayloadReader &payload);
+    void CreateTexture(TracePayloadReader &payload);
+    void CreateTextureView(TracePayloadReader &payload);
+    void CreateSampler(TracePayloadReader &payload);
+    void CreateShaderModule(TracePayloadReader &payload);
+    void CreateBindGroupLayout(TracePayloadReader &payload);
+    void CreateRenderPipeline(TracePayloadReader &payload);
+    void CreateBindGroup(TracePayloadReader &payload);
+    void BeginRenderPass(TracePayloadReader &payload);
+    void EndFrame();
+
+    // Block until the GPU has finished everything submitted so far
+    void WaitForQueue();
+
+    template <typename Handle>
+    [[nodiscard]] std::optional<Handle> Find(
+        const std::unordered_map<uint32_t, Handle> &objects,
+        uint32_t id);
+
+    std::optional<wgpu::Device> device{std::nullopt};
+    std::optional<wgpu::Queue> queue{std::nullopt};
+    std::unique_ptr<wgpu::ErrorCallback> error_callback{nullptr};
+
+    std::unordered_map<uint32_t, wgpu::Buffer> buffers{};
+    std::unordered_map<uint32_t, wgpu::Texture> textures{};
+    std::unordered_map<uint32_t, wgpu::TextureView> texture_views{};
+    std::unordered_map<uint32_t, wgpu::Sampler> samplers{};
+    std::unordered_map<uint32_t, wgpu::ShaderModule> shader_modules{};
+    std::unordered_map<uint32_t, wgpu::BindGroupLayout> bind_group_layouts{};
+    // Keyed by bind group layout id
+    std::unordered_map<uint32_t, wgpu::PipelineLayout> pipeline_layouts{};
+    std::unordered_map<uint32_t, wgpu::RenderPipeline> pipelines{};
+    std::unordered_map<uint32_t, wgpu::BindGroup> bind_groups{};
+
+    // Stands in for the surface texture
+    std::optional<wgpu::Texture> target{std::nullopt};
+    std::optional<wgpu::TextureView> target_view{std::nullopt};
+
+    std::optional<wgpu::CommandEncoder> encoder{std::nullopt};
+    std::optional<wgpu::RenderPassEncoder> pass{std::nullopt};
+    std::optional<Clock::time_point> frame_start{std::nullopt};
+    std::vector<double> frame_times{};
+    uint32_t skipped_commands{0};
+};
+
+bool Replayer::Initialise(bool fallback_adapter)
+{
+    wgpu::Instance instance{wgpuCreateInstance(nullptr)};
+    wgpu::RequestAdapterOptions adapter_options{};
+    adapter_options.compatibleSurface = nullptr;
+    adapter_options.forceFallbackAdapter = fallback_adapter ? 1U : 0U;
+    wgpu::Adapter adapter{instance.requestAdapter(adapter_options)};
+    instance.release();
+    if (adapter == nullptr)
+    {
+        fmt::print(stderr, "No suitable adapter found\n");
+        return false;
+    }
+
+    // Allow whatever the adapter can do, as the trace may come from another
+    // machine
+    wgpu::SupportedLimits supported_limits{};
+    adapter.getLimits(&supported_limits);
+    wgpu::RequiredLimits required_limits{wgpu::Default};
+    required_limits.limits = supported_limits.limits;
+    std::vector<WGPUFeatureName> features{};
+    for (const wgpu::FeatureName feature :
+         {wgpu::FeatureName::TextureCompressionBC,
+          wgpu::FeatureName::TextureCompressionETC2,
+          wgpu::FeatureName::TextureCompressionASTC})
+    {
+        if (adapter.hasFeature(feature))
+        {
+            features.push_back(feature);
+        }
+    }
+
+    wgpu::DeviceDescriptor device_descriptor{};
+    device_descriptor.label = "Replay device";
+    device_descriptor.requiredFeatureCount = features.size();
+    device_descriptor.requiredFeatures = features.data();
+    device_descriptor.requiredLimits = &required_limits;
+    device_descriptor.defaultQueue.label = "Replay queue";
+    device = std::optional<wgpu::Device>{
+        adapter.requestDevice(device_descriptor)};
+    adapter.release();
+    if (device.value() == nullptr)
+    {
+        fmt::print(stderr, "Could not create a device\n");
+        return false;
+    }
+
+    error_callback = device.value().setUncapturedErrorCallback(
+        [](WGPUErrorType error_type, char const *message) {
+            fmt::print(stderr,
+                       "Device error {}: {}\n",
+                       static_cast<uint32_t>(error_type),
+                       message != nullptr ? message : "");
+        });
+    queue = device.value().getQueue();
+    return true;
+}
+
+void Replayer::Terminate()
+{
+    auto release_all{[](auto &objects) {
+        for (auto &[id, object] : objects)
+        {
+            object.release();
+        }
+        objects.clear();
+    }};
+    release_all(bind_groups);
+    release_all(pipelines);
+    release_all(pipeline_layouts);
+    release_all(bind_group_layouts);
+    release_all(shader_modules);
+    release_all(samplers);
+    release_all(texture_views);
+    for (auto &[id, texture] : textures)
+    {
+        texture.destroy();
+    }
+    release_all(textures);
+    release_all(buffers);
+    if (target_view.has_value())
+    {
+        target_view.value().release();
+    }
+    if (target.has_value())
+    {
+        target.value().destroy();
+        target.value().release();
+    }
+    if (queue.has_value())
+    {
+        queue.value().release();
+    }
+    if (device.has_value())
+    {
+        device.value().release();
+    }
+}
+
+std::vector<double> Replayer::Replay(FrameTraceReader &reader)
+{
+    frame_times.clear();
+    reader.Rewind();
+    FrameTraceReader::Command command{};
+    while (reader.Next(command))
+    {
+        TracePayloadReader payload{command.payload};
+        Execute(command.op, payload);
+        if (!payload.ok())
+        {
+            fmt::print(stderr,
+                       "Truncated payload for command {}\n",
+                       static_cast<uint32_t>(command.op));
+            break;
+        }
+    }
+    return frame_times;
+}
+
+uint32_t Replayer::SkippedCommands() const
+{
+    return skipped_commands;
+}
+
+void Replayer::Execute(Op op, TracePayloadReader &payload)
+{
+    switch (op)
+    {
+    case Op::CreateBuffer:
+        CreateBuffer(payload);
+        break;
+    case Op::WriteBuffer:
+        WriteBuffer(payload);
+        break;
+    case Op::CreateTexture:
+        CreateTexture(payload);
+        break;
+    case Op::CreateTextureView:
+        CreateTextureView(payload);
+        break;
+    case Op::CreateSampler:
+        CreateSampler(payload);
+        break;
+    case Op::CreateShaderModule:
+        CreateShaderModule(payload);
+        break;
+    case Op::CreateBindGroupLayout:
+        CreateBindGroupLayout(payload);
+        break;
+    case Op::CreateRenderPipeline:
+        CreateRenderPipeline(payload);
+        break;
+    case Op::CreateBindGroup:
+        CreateBindGroup(payload);
+        break;
+    case Op::BeginFrame:
+        // An unfinished frame (the app skipped presenting) runs on into this
+        // one
+        if (!frame_start.has_value())
+        {
+            frame_start = Clock::now();
+        }
+        break;
+    case Op::BeginRenderPass:
+        BeginRenderPass(payload);
+        break;
+    case Op::SetPipeline:
+    {
+        const std::optional<wgpu::RenderPipeline> pipeline{
+            Find(pipelines, payload.Read<uint32_t>())};
+        if (pass.has_value() && pipeline.has_value())
+        {
+            pass.value().setPipeline(pipeline.value());
+        }
+        break;
+    }
+    case Op::SetVertexBuffer:
+    {
+        const auto slot{payload.Read<uint32_t>()};
+        const std::optional<wgpu::Buffer> buffer{
+            Find(buffers, payload.Read<uint32_t>())};
+        const auto offset{payload.Read<uint64_t>()};
+        const auto size{payload.Read<uint64_t>()};
+        if (pass.has_value() && buffer.has_value())
+        {
+            pass.value().setVertexBuffer(slot, buffer.value(), offset, size);
+        }
+        break;
+    }
+    case Op::SetIndexBuffer:
+    {
+        const std::optional<wgpu::Buffer> buffer{
+            Find(buffers, payload.Read<uint32_t>())};
+        const auto format{
+            static_cast<WGPUIndexFormat>(payload.Read<uint32_t>())};
+        const auto offset{payload.Read<uint64_t>()};
+        const auto size{payload.Read<uint64_t>()};
+        if (pass.has_value() && buffer.has_value())
+        {
+            pass.value().setIndexBuffer(buffer.value(), format, offset, size);
+        }
+        break;
+    }
+    case Op::SetBindGroup:
+    {
+        const auto group_index{payload.Read<uint32_t>()};
+        const std::optional<wgpu::BindGroup> bind_group{
+            Find(bind_groups, payload.Read<uint32_t>())};
+        if (pass.has_value() && bind_group.has_value())
+        {
+            pass.value().setBindGroup(group_index,
+                                      bind_group.value(),
+                                      0,
+                                      nullptr);
+        }
+        break;
+    }
+    case Op::DrawIndexed:
+    {
+        const auto index_count{payload.Read<uint32_t>()};
+        const auto instance_count{payload.Read<uint32_t>()};
+        const auto first_index{payload.Read<uint32_t>()};
+        const auto base_vertex{payload.Read<int32_t>()};
+        const auto first_instance{payload.Read<uint32_t>()};
+        if (pass.has_value())
+        {
+            pass.value().drawIndexed(index_count,
+                                     instance_count,
+                                     first_index,
+                                     base_vertex,
+                                     first_instance);
+        }
+        break;
+    }
+    case Op::EndRenderPass:
+        if (pass.has_value())
+        {
+            pass.value().end();
+            pass.value().release();
+            pass.reset();
+        }
+        break;
+    case Op::EndFrame:
+        EndFrame();
+        break;
+    default:
+        // From a newer recorder
+        ++skipped_commands;
+        break;
+    }
+}
+
+void Replayer::CreateBuffer(TracePayloadReader &payload)
+{
+    const auto id{payload.Read<uint32_t>()};
+    wgpu::BufferDescriptor descriptor{};
+    descriptor.size = payload.Read<uint64_t>();
+    descriptor.usage = payload.Read<uint32_t>();
+    descriptor.mappedAtCreation = 0U;
+    if (payload.ok() && buffers.find(id) == buffers.end())
+    {
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        buffers.emplace(id, device.value().createBuffer(descriptor));
+    }
+}
+
+void Replayer::WriteBuffer(TracePayloadReader &payload)
+{
+    const std::optional<wgpu::Buffer> buffer{
+        Find(buffers, payload.Read<uint32_t>())};
+    const auto offset{payload.Read<uint64_t>()};
+    const std::string_view data{payload.ReadBytes()};
+    if (payload.ok() && buffer.has_value())
+    {
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        queue.value().writeBuffer(buffer.value(),
+                                  offset,
+                                  data.data(),
+                                  data.size());
+    }
+}
+
+void Replayer::CreateTexture(TracePayloadReader &payload)
+{
+    const auto id{payload.Read<uint32_t>()};
+    wgpu::TextureDescriptor descriptor{};
+    descriptor.label = "Replayed texture";
+    descriptor.dimension = wgpu::TextureDimension::_2D;
+    descriptor.size.width = payload.Read<uint32_t>();
+    descriptor.size.height = payload.Read<uint32_t>();
+    descriptor.size.depthOrArrayLayers = 1;
+    descriptor.format =
+        static_cast<WGPUTextureFormat>(payload.Read<uint32_t>());
+    descriptor.mipLevelCount = payload.Read<uint32_t>();
+    descriptor.sampleCount = 1;
+    descriptor.usage = payload.Read<uint32_t>();
+    descriptor.viewFormatCount = 0;
+    descriptor.viewFormats = nullptr;
+    if (payload.ok() && textures.find(id) == textures.end())
+    {
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        textures.emplace(id, device.value().createTexture(descriptor));
+    }
+}
+
+void Replayer::CreateTextureView(TracePayloadReader &payload)
+{
+    const auto id{payload.Read<uint32_t>()};
+    std::optional<wgpu::Texture> texture{
+        Find(textures, payload.Read<uint32_t>())};
+    if (payload.ok() && texture.has_value() &&
+        texture_views.find(id) == texture_views.end())
+    {
+        texture_views.emplace(id, texture.value().createView());
+    }
+}
+
+void Replayer::CreateSampler(TracePayloadReader &payload)
+{
+    const auto id{payload.Read<uint32_t>()};
+    wgpu::SamplerDescriptor descriptor{};
+    descriptor.label = "Replayed sampler";
+    descriptor.addressModeU =
+        static_cast<WGPUAddressMode>(payload.Read<uint32_t>());
+    descriptor.addressModeV =
+        static_cast<WGPUAddressMode>(payload.Read<uint32_t>());
+    descriptor.addressModeW =
+        static_cast<WGPUAddressMode>(payload.Read<uint32_t>());
+    descriptor.magFilter =
+        static_cast<WGPUFilterMode>(payload.Read<uint32_t>());
+    descriptor.minFilter =
+        static_cast<WGPUFilterMode>(payload.Read<uint32_t>());
+    descriptor.mipmapFilter =
+        static_cast<WGPUMipmapFilterMode>(payload.Read<uint32_t>());
+    descriptor.lodMinClamp = payload.Read<float>();
+    descriptor.lodMaxClamp = payload.Read<float>();
+    descriptor.compare = wgpu::CompareFunction::Undefined;
+    descriptor.maxAnisotropy = 1;
+    if (payload.ok() && samplers.find(id) == samplers.end())
+    {
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        samplers.emplace(id, device.value().createSampler(descriptor));
+    }
+}
+
+void Replayer::CreateShaderModule(TracePayloadReader &payload)
+{
+    const auto id{payload.Read<uint32_t>()};
+    // The WGSL descriptor needs a NUL-terminated string
+    const std::string source{payload.ReadString()};
+    if (!payload.ok() || shader_modules.find(id) != shader_modules.end())
+    {
+        return;
+    }
+
+    wgpu::ShaderModuleWGSLDescriptor code_descriptor{};
+    code_descriptor.chain.next = nullptr;
+    code_descriptor.chain.sType = wgpu::SType::ShaderModuleWGSLDescriptor;
+    code_descriptor.code = source.c_str();
+    wgpu::ShaderModuleDescriptor descriptor{};
+#ifdef WEBGPU_BACKEND_WGPU
+    descriptor.hintCount = 0;
+    descriptor.hints = nullptr;
+#endif
+    descriptor.nextInChain = &code_descriptor.chain;
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    shader_modules.emplace(id, device.value().createShaderModule(descriptor));
+}
+
+void Replayer::CreateBindGroupLayout(TracePayloadReader &payload)
+{
+    const auto id{payload.Read<uint32_t>()};
+    std::vector<wgpu::BindGroupLayoutEntry> entries(payload.Read<uint32_t>());
+    for (wgpu::BindGroupLayoutEntry &entry : entries)
+    {
+        entry = wgpu::Default;
+        entry.binding = payload.Read<uint32_t>();
+        entry.visibility = payload.Read<uint32_t>();
+        const auto kind{static_cast<BindingKind>(payload.Read<uint8_t>())};
+        const auto type{payload.Read<uint32_t>()};
+        const auto min_binding_size{payload.Read<uint64_t>()};
+        const auto view_dimension{payload.Read<uint32_t>()};
+        if (kind == BindingKind::Buffer)
+        {
+            entry.buffer.type = static_cast<WGPUBufferBindingType>(type);
+            entry.buffer.minBindingSize = min_binding_size;
+        }
+        else if (kind == BindingKind::Texture)
+        {
+            entry.texture.sampleType = static_cast<WGPUTextureSampleType>(type);
+            entry.texture.viewDimension =
+                static_cast<WGPUTextureViewDimension>(view_dimension);
+        }
+        else
+        {
+            entry.sampler.type = static_cast<WGPUSamplerBindingType>(type);
+        }
+    }
+    if (!payload.ok() ||
+        bind_group_layouts.find(id) != bind_group_layouts.end())
+    {
+        return;
+    }
+
+    wgpu::BindGroupLayoutDescriptor descriptor{};
+    descriptor.entryCount = entries.size();
+    descriptor.entries = entries.data();
+    const wgpu::BindGroupLayout layout{
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        device.value().createBindGroupLayout(descriptor)};
+    bind_group_layouts.emplace(id, layout);
+
+    wgpu::PipelineLayoutDescriptor layout_descriptor{};
+    layout_descriptor.bindGroupLayoutCount = 1;
+    layout_descriptor.bindGroupLayouts =
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast)
+        (WGPUBindGroupLayout *)&bind_group_layouts.at(id);
+    pipeline_layouts.emplace(
+        id,
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        device.value().createPipelineLayout(layout_descriptor));
+}
+
+void Replayer::CreateRenderPipeline(TracePayloadReader &payload)
+{
+    const auto id{payload.Read<uint32_t>()};
+    const std::optional<wgpu::PipelineLayout> layout{
+        Find(pipeline_layouts, payload.Read<uint32_t>())};
+    const std::optional<wgpu::ShaderModule> module{
+        Find(shader_modules, payload.Read<uint32_t>())};
+
+    // Keys are kept here, as the constant entries point at them
+    struct Stage
+    {
+        std::string entry_point;
+        std::vector<std::string> keys;
+        std::vector<wgpu::ConstantEntry> constants;
+    };
+    std::array<Stage, 2> stages{};
+    for (Stage &stage : stages)
+    {
+        stage.entry_point = payload.ReadString();
+        const auto constant_count{payload.Read<uint32_t>()};
+        for (uint32_t index{0}; index < constant_count && payload.ok(); ++index)
+        {
+            stage.keys.emplace_back(payload.ReadString());
+            wgpu::ConstantEntry constant{};
+            constant.value = payload.Read<double>();
+            stage.constants.push_back(constant);
+        }
+        for (size_t index{0}; index < stage.keys.size(); ++index)
+        {
+            stage.constants[index].key = stage.keys[index].c_str();
+        }
+    }
+
+    wgpu::VertexBufferLayout vertex_buffer_layout{};
+    vertex_buffer_layout.arrayStride = payload.Read<uint64_t>();
+    vertex_buffer_layout.stepMode = wgpu::VertexStepMode::Vertex;
+    std::vector<wgpu::VertexAttribute> attributes(payload.Read<uint32_t>());
+    for (wgpu::VertexAttribute &attribute : attributes)
+    {
+        attribute.format =
+            static_cast<WGPUVertexFormat>(payload.Read<uint32_t>());
+        attribute.offset = payload.Read<uint64_t>();
+        attribute.shaderLocation = payload.Read<uint32_t>();
+    }
+    vertex_buffer_layout.attributeCount = attributes.size();
+    vertex_buffer_layout.attributes = attributes.data();
+
+    wgpu::RenderPipelineDescriptor descriptor{};
+    descriptor.label = "Replayed render pipeline";
+    descriptor.primitive.topology =
+        static_cast<WGPUPrimitiveTopology>(payload.Read<uint32_t>());
+    descriptor.primitive.stripIndexFormat = wgpu::IndexFormat::Undefined;
+    descriptor.primitive.frontFace =
+        static_cast<WGPUFrontFace>(payload.Read<uint32_t>());
+    descriptor.primitive.cullMode =
+        static_cast<WGPUCullMode>(payload.Read<uint32_t>());
+
+    wgpu::ColorTargetState colour_target{};
+    colour_target.format =
+        static_cast<WGPUTextureFormat>(payload.Read<uint32_t>());
+    colour_target.writeMask = wgpu::ColorWriteMask::All;
+    const bool has_blend{payload.Read<uint8_t>() != 0};
+    wgpu::BlendState blend_state{};
+    for (WGPUBlendComponent *component :
+         {&blend_state.color, &blend_state.alpha})
+    {
+        component->operation =
+            static_cast<WGPUBlendOperation>(payload.Read<uint32_t>());
+        component->srcFactor =
+            static_cast<WGPUBlendFactor>(payload.Read<uint32_t>());
+        component->dstFactor =
+            static_cast<WGPUBlendFactor>(payload.Read<uint32_t>());
+    }
+    colour_target.blend = has_blend ? &blend_state : nullptr;
+
+    if (!payload.ok() || !layout.has_value() || !module.has_value() ||
+        pipelines.find(id) != pipelines.end())
+    {
+        return;
+    }
+
+    descriptor.layout = layout.value();
+    descriptor.vertex.module = module.value();
+    descriptor.vertex.entryPoint = stages[0].entry_point.c_str();
+    descriptor.vertex.constantCount = stages[0].constants.size();
+    descriptor.vertex.constants = stages[0].constants.data();
+    descriptor.vertex.bufferCount = attributes.empty() ? 0 : 1;
+    descriptor.vertex.buffers = &vertex_buffer_layout;
+
+    wgpu::FragmentState fragment_state{};
+    fragment_state.module = module.value();
+    fragment_state.entryPoint = stages[1].entry_point.c_str();
+    fragment_state.constantCount = stages[1].constants.size();
+    fragment_state.constants = stages[1].constants.data();
+    fragment_state.targetCount = 1;
+    fragment_state.targets = &colour_target;
+    descriptor.fragment = &fragment_state;
+
+    descriptor.depthStencil = nullptr;
+    descriptor.multisample.count = 1;
+    descriptor.multisample.mask = ~0U;
+    descriptor.multisample.alphaToCoverageEnabled = 0U;
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    pipelines.emplace(id, device.value().createRenderPipeline(descriptor));
+}
+
+void Replayer::CreateBindGroup(TracePayloadReader &payload)
+{
+    const auto id{payload.Read<uint32_t>()};
+    const std::optional<wgpu::BindGroupLayout> layout{
+        Find(bind_group_layouts, payload.Read<uint32_t>())};
+    std::vector<wgpu::BindGroupEntry> entries(payload.Read<uint32_t>());
+    bool resolved{true};
+    for (wgpu::BindGroupEntry &entry : entries)
+    {
+        entry.binding = payload.Read<uint32_t>();
+        const auto kind{static_cast<BindingKind>(payload.Read<uint8_t>())};
+        const auto resource_id{payload.Read<uint32_t>()};
+        entry.offset = payload.Read<uint64_t>();
+        entry.size = payload.Read<uint64_t>();
+        if (kind == BindingKind::Buffer)
+        {
+            const std::optional<wgpu::Buffer> buffer{
+                Find(buffers, resource_id)};
+            resolved = resolved && buffer.has_value();
+            entry.buffer = buffer.value_or(nullptr);
+        }
+        else if (kind == BindingKind::Texture)
+        {
+            const std::optional<wgpu::TextureView> view{
+                Find(texture_views, resource_id)};
+            resolved = resolved && view.has_value();
+            entry.textureView = view.value_or(nullptr);
+        }
+        else
+        {
+            const std::optional<wgpu::Sampler> sampler{
+                Find(samplers, resource_id)};
+            resolved = resolved && sampler.has_value();
+            entry.sampler = sampler.value_or(nullptr);
+        }
+    }
+    if (!payload.ok() || !resolved || !layout.has_value() ||
+        bind_groups.find(id) != bind_groups.end())
+    {
+        return;
+    }
+
+    wgpu::BindGroupDescriptor descriptor{};
+    descriptor.layout = layout.value();
+    descriptor.entryCount = entries.size();
+    descriptor.entries = entries.data();
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    bind_groups.emplace(id, device.value().createBindGroup(descriptor));
+}
+
+void Replayer::BeginRenderPass(TracePayloadReader &payload)
+{
+    const auto width{payload.Read<uint32_t>()};
+    const auto height{payload.Read<uint32_t>()};
+    const auto format{static_cast<WGPUTextureFormat>(payload.Read<uint32_t>())};
+    wgpu::Color clear_value{};
+    clear_value.r = payload.Read<double>();
+    clear_value.g = payload.Read<double>();
+    clear_value.b = payload.Read<double>();
+    clear_value.a = payload.Read<double>();
+    if (!payload.ok())
+    {
+        return;
+    }
+
+    if (!target.has_value() || target.value().getWidth() != width ||
+        target.value().getHeight() != height ||
+        target.value().getFormat() != format)
+    {
+        if (target_view.has_value())
+        {
+            target_view.value().release();
+        }
+        if (target.has_value())
+        {
+            target.value().destroy();
+            target.value().release();
+        }
+        wgpu::TextureDescriptor target_descriptor{};
+        target_descriptor.label = "Replay target";
+        target_descriptor.dimension = wgpu::TextureDimension::_2D;
+        target_descriptor.size = {width, height, 1};
+        target_descriptor.format = format;
+        target_descriptor.mipLevelCount = 1;
+        target_descriptor.sampleCount = 1;
+        target_descriptor.usage = wgpu::TextureUsage::RenderAttachment;
+        target_descriptor.viewFormatCount = 0;
+        target_descriptor.viewFormats = nullptr;
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        target = device.value().createTexture(target_descriptor);
+        target_view = target.value().createView();
+    }
+
+    if (!encoder.has_value())
+    {
+        wgpu::CommandEncoderDescriptor encoder_descriptor{};
+        encoder_descriptor.label = "Replay command encoder";
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        encoder = device.value().createCommandEncoder(encoder_descriptor);
+    }
+
+    wgpu::RenderPassColorAttachment colour_attachment{};
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    colour_attachment.view = target_view.value();
+    colour_attachment.resolveTarget = nullptr;
+    colour_attachment.loadOp = wgpu::LoadOp::Clear;
+    colour_attachment.storeOp = wgpu::StoreOp::Store;
+    colour_attachment.clearValue = clear_value;
+#ifndef WEBGPU_BACKEND_WGPU
+    colour_attachment.depthSlice = WGPU_DEPTH_SLICE_UNDEFINED;
+#endif
+    wgpu::RenderPassDescriptor pass_descriptor{};
+    pass_descriptor.colorAttachmentCount = 1;
+    pass_descriptor.colorAttachments = &colour_attachment;
+    pass_descriptor.depthStencilAttachment = nullptr;
+    pass_descriptor.timestampWrites = nullptr;
+    pass = encoder.value().beginRenderPass(pass_descriptor);
+}
+
+void Replayer::EndFrame()
+{
+    if (encoder.has_value())
+    {
+        wgpu::CommandBufferDescriptor command_buffer_descriptor{};
+        command_buffer_descriptor.label = "Replay command buffer";
+        wgpu::CommandBuffer command{
+            encoder.value().finish(command_buffer_descriptor)};
+        encoder.value().release();
+        encoder.reset();
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        queue.value().submit(1, &command);
+        command.release();
+    }
+    WaitForQueue();
+
+    if (frame_start.has_value())
+    {
+        const std::chrono::duration<double, std::milli> frame_time{
+            Clock::now() - frame_start.value()};
+        frame_times.push_back(frame_time.count());
+        frame_start.reset();
+    }
+}
+
+void Replayer::WaitForQueue()
+{
+    bool done{false};
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    wgpuQueueOnSubmittedWorkDone(
+        queue.value(),
+        [](WGPUQueueWorkDoneStatus /* status */, void *user_data) {
+            *static_cast<bool *>(user_data) = true;
+        },
+        &done);
+    while (!done)
+    {
+#if defined(WEBGPU_BACKEND_DAWN)
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        wgpuDeviceTick(device.value());
+#elif defined(WEBGPU_BACKEND_WGPU)
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+        wgpuDevicePoll(device.value(), 1U, nullptr);
+#endif
+    }
+}
+
+template <typename Handle>
+std::optional<Handle> Replayer::Find(
+    const std::unordered_map<uint32_t, Handle> &objects,
+    uint32_t id)
+{
+    const auto found{objects.find(id)};
+    if (found == objects.end())
+    {
+        // Created before the capture started, or failed to replay
+        ++skipped_commands;
+        return std::nullopt;
+    }
+    return found->second;
+}
+
+std::optional<ReplayOptions> parse_options(
+    const std::vector<std::string> &arguments)
+{
+    ReplayOptions options{};
+    bool has_trace_path{false};
+    for (auto argument{std::next(arguments.begin())};
+         argument != arguments.end();
+         ++argument)
+    {
+        if (*argument == "--fallback-adapter")
+        {
+            options.fallback_adapter = true;
+        }
+        else if (*argument == "--repeat" &&
+                 std::next(argument) != arguments.end())
+        {
+            try
+            {
+                options.repeat_count =
+                    static_cast<uint32_t>(std::stoul(*++argument));
+            }
+            catch (const std::exception &)
+            {
+                return std::nullopt;
+            }
+        }
+        else if (!has_trace_path)
+        {
+            options.trace_path = *argument;
+            has_trace_path = true;
+        }
+        else
+        {
+            return std::nullopt;
+        }
+    }
+    if (!has_trace_path || options.repeat_count == 0)
+    {
+        return std::nullopt;
+    }
+    return options;
+}
+
+void print_summary(std::vector<double> frame_times)
+{
+    if (frame_times.empty())
+    {
+        fmt::print("No frames replayed\n");
+        return;
+    }
+    std::sort(frame_times.begin(), frame_times.end());
+    const double total{
+        std::accumulate(frame_times.begin(), frame_times.end(), 0.0)};
+    auto percentile{[&frame_times](double fraction) {
+        const auto index{static_cast<size_t>(
+            fraction * static_cast<double>(frame_times.size() - 1))};
+        return frame_times[index];
+    }};
+    constexpr double kMedian{0.5};
+    constexpr double kPercentile95{0.95};
+    fmt::print("{} frames: mean {:.3f} ms, min {:.3f} ms, median {:.3f} ms, "
+               "95th percentile {:.3f} ms, max {:.3f} ms\n",
+               frame_times.size(),
+               total / static_cast<double>(frame_times.size()),
+               frame_times.front(),
+               percentile(kMedian),
+               percentile(kPercentile95),
+               frame_times.back());
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    const std::optional<ReplayOptions> options{
+        parse_options({argv, std::next(argv, argc)})};
+    if (!options.has_value())
+    {
+        fmt::print(stderr,
+                   "Usage: ReplayFrames <trace> [--fallback-adapter] "
+                   "[--repeat <count>]\n");
+        return EXIT_FAILURE;
+    }
+
+    std::optional<FrameTraceReader> reader{
+        FrameTraceReader::Open(options.value().trace_path)};
+    if (!reader.has_value())
+    {
+        fmt::print(stderr,
+                   "`{}` is not a frame trace\n",
+                   options.value().trace_path.string());
+        return EXIT_FAILURE;
+    }
+
+    Replayer replayer{};
+    if (!replayer.Initialise(options.value().fallback_adapter))
+    {
+        replayer.Terminate();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<double> all_frame_times{};
+    for (uint32_t pass{0}; pass < options.value().repeat_count; ++pass)
+    {
+        const std::vector<double> frame_times{
+            replayer.Replay(reader.value())};
+        for (size_t frame{0}; frame < frame_times.size(); ++frame)
+        {
+            fmt::print("pass {} frame {}: {:.3f} ms\n",
+                       pass,
+                       frame,
+                       frame_times[frame]);
+        }
+        all_frame_times.insert(all_frame_times.end(),
+                               frame_times.begin(),
+                               frame_times.end());
+    }
+    print_summary(all_frame_times);
+    if (replayer.SkippedCommands() > 0)
+    {
+        fmt::print("{} commands referred to objects missing from the trace\n",
+                   replayer.SkippedCommands());
+    }
+
+    replayer.Terminate();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,355 @@
+#ifndef SRC_UTILITIES_BATCH_RENDERER_H
+#define SRC_UTILITIES_BATCH_RENDERER_H
+
+#include "render_queue.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// One vertex in the layout of `VertexInput` in shader.wgsl
+struct BatchVertex
+{
+    std::array<float, 2> position{};
+    std::array<float, 3> colour{};
+};
+
+static_assert(sizeof(BatchVertex) == 5 * sizeof(float),
+              "BatchVertex must match the shader's vertex buffer layout");
+
+using BatchColour = std::array<float, 3>;
+
+// Counts for one frame of immediate-mode drawing
+struct BatchStats
+{
+    uint32_t quads{0};
+    uint32_t batches{0};
+    // Batches ended by a pipeline or bind group change
+    uint32_t state_flushes{0};
+    // Batches ended by running out of batch space
+    uint32_t full_flushes{0};
+    // Quads that did not fit in the frame's region and were not drawn
+    uint32_t dropped_quads{0};
+    uint64_t bytes_uploaded{0};
+};
+
+// Immediate-mode drawing of quads and lines for overlays and debug shapes.
+// Each frame's vertices and indices are appended to a region of a dynamic
+// vertex and index buffer pair. There is a region for each frame that may be
+// in flight, so a frame never writes where an earlier frame's draws read;
+// frames either name their frame slot's region or take turns. Pending
+// geometry is uploaded and handed to the render queue as one draw when the
+// pipeline or bind group changes, when a batch fills, and at `End`.
+//
+// Batches are drawn in the order they were made, after everything in
+// earlier render queue passes. Quads beyond `quads_per_frame` in one frame
+// are dropped and counted, as there is nowhere to put them until the next
+// frame.
+//
+// `Types` is as for RenderQueue. `Upload` writes bytes into a buffer, like
+// wgpu::Queue::writeBuffer; offsets and sizes are multiples of 4 bytes.
+template <typename Types>
+class BatchRenderer
+{
+public:
+    using DrawPacket = typename RenderQueue<Types>::DrawPacket;
+    using Upload = std::function<void(typename Types::Buffer buffer,
+                                      uint64_t offset,
+                                      const void *data,
+                                      size_t size)>;
+    using Emit = std::function<void(const DrawPacket &packet)>;
+
+    static constexpr uint32_t kDefaultRegionCount{2};
+    static constexpr uint32_t kVerticesPerQuad{4};
+    static constexpr uint32_t kIndicesPerQuad{6};
+    // The most 16-bit indices can address from a batch's base vertex
+    static constexpr uint32_t kMaxQuadsPerBatch{65536 / kVerticesPerQuad};
+
+    // Buffer sizes needed for `quads_per_frame` in each of `region_count`
+    // regions
+    [[nodiscard]] static constexpr uint64_t VertexBufferSize(
+        uint32_t quads_per_frame,
+        uint32_t region_count);
+    [[nodiscard]] static constexpr uint64_t IndexBufferSize(
+        uint32_t quads_per_frame,
+        uint32_t region_count);
+
+    // `index_format` is the Types::IndexFormat value for 16-bit indices
+    void Initialise(typename Types::Buffer vertex_buffer,
+                    typename Types::Buffer index_buffer,
+                    typename Types::IndexFormat index_format,
+                    uint32_t quads_per_frame,
+                    uint32_t quads_per_batch,
+                    uint32_t region_count,
+                    Upload upload,
+                    Emit emit);
+
+    // Start a frame in the next region, drawing in render queue pass `pass`
+    void Begin(uint32_t pass);
+    // Start a frame in region `frame_slot`, such as the slot FramesInFlight
+    // handed out
+    void Begin(uint32_t pass, uint32_t frame_slot);
+    // Flush what is pending and return the frame's counts
+    BatchStats End();
+
+    void SetState(typename Types::Pipeline pipeline,
+                  typename Types::BindGroup bind_group);
+
+    // An axis-aligned rectangle between two corners, in clip space
+    void Quad(float x0,
+              float y0,
+              float x1,
+              float y1,
+              const BatchColour &colour);
+    // A line `width` wide, drawn as a quad
+    void Line(float x0,
+              float y0,
+              float x1,
+              float y1,
+              float width,
+              const BatchColour &colour);
+
+    [[nodiscard]] const BatchStats &LastStats() const;
+
+private:
+    void AppendQuad(const std::array<std::array<float, 2>, 4> &corners,
+                    const BatchColour &colour);
+    // Upload the pending batch and hand it to the render queue
+    void Flush();
+
+    typename Types::Buffer vertices_buffer{};
+    typename Types::Buffer indices_buffer{};
+    typename Types::IndexFormat format{};
+    uint32_t region_quads{0};
+    uint32_t batch_quads{0};
+    uint32_t regions{kDefaultRegionCount};
+    Upload upload_bytes{};
+    Emit emit_packet{};
+
+    typename Types::Pipeline current_pipeline{};
+    typename Types::BindGroup current_bind_group{};
+    uint32_t render_pass{0};
+    uint32_t region{kDefaultRegionCount - 1};
+    // Quads flushed from this frame's region so far
+    uint32_t flushed_quads{0};
+    uint32_t sequence{0};
+    std::vector<BatchVertex> vertices{};
+    std::vector<uint16_t> indices{};
+    BatchStats stats{};
+    BatchStats last_stats{};
+};
+
+template <typename Types>
+constexpr uint64_t BatchRenderer<Types>::VertexBufferSize(
+    uint32_t quads_per_frame,
+    uint32_t region_count)
+{
+    return uint64_t{region_count} * quads_per_frame * kVerticesPerQuad *
+           sizeof(BatchVertex);
+}
+
+template <typename Types>
+constexpr uint64_t BatchRenderer<Types>::IndexBufferSize(
+    uint32_t quads_per_frame,
+    uint32_t region_count)
+{
+    return uint64_t{region_count} * quads_per_frame * kIndicesPerQuad *
+           sizeof(uint16_t);
+}
+
+template <typename Types>
+void BatchRenderer<Types>::Initialise(typename Types::Buffer vertex_buffer,
+                                      typename Types::Buffer index_buffer,
+                                      typename Types::IndexFormat index_format,
+                                      uint32_t quads_per_frame,
+                                      uint32_t quads_per_batch,
+                                      uint32_t region_count,
+                                      Upload upload,
+                                      Emit emit)
+{
+    vertices_buffer = vertex_buffer;
+    indices_buffer = index_buffer;
+    format = index_format;
+    region_quads = quads_per_frame;
+    batch_quads =
+        std::min({quads_per_batch, quads_per_frame, kMaxQuadsPerBatch});
+    regions = std::max(region_count, 1U);
+    region = regions - 1;
+    upload_bytes = std::move(upload);
+    emit_packet = std::move(emit);
+    vertices.reserve(size_t{batch_quads} * kVerticesPerQuad);
+    indices.reserve(size_t{batch_quads} * kIndicesPerQuad);
+}
+
+template <typename Types>
+void BatchRenderer<Types>::Begin(uint32_t pass)
+{
+    Begin(pass, (region + 1) % regions);
+}
+
+template <typename Types>
+void BatchRenderer<Types>::Begin(uint32_t pass, uint32_t frame_slot)
+{
+    render_pass = pass;
+    region = frame_slot % regions;
+    flushed_quads = 0;
+    sequence = 0;
+    vertices.clear();
+    indices.clear();
+    stats = {};
+}
+
+template <typename Types>
+BatchStats BatchRenderer<Types>::End()
+{
+    Flush();
+    last_stats = stats;
+    return last_stats;
+}
+
+template <typename Types>
+void BatchRenderer<Types>::SetState(typename Types::Pipeline pipeline,
+                                    typename Types::BindGroup bind_group)
+{
+    if (pipeline == current_pipeline && bind_group == current_bind_group)
+    {
+        return;
+    }
+    if (!vertices.empty())
+    {
+        ++stats.state_flushes;
+        Flush();
+    }
+    current_pipeline = pipeline;
+    current_bind_group = bind_group;
+}
+
+template <typename Types>
+void BatchRenderer<Types>::Quad(float x0,
+                                float y0,
+                                float x1,
+                                float y1,
+                                const BatchColour &colour)
+{
+    AppendQuad({{{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}}}, colour);
+}
+
+template <typename Types>
+void BatchRenderer<Types>::Line(float x0,
+                                float y0,
+                                float x1,
+                                float y1,
+                                float width,
+                                const BatchColour &colour)
+{
+    const float dx{x1 - x0};
+    const float dy{y1 - y0};
+    const float length{std::sqrt(dx * dx + dy * dy)};
+    if (length == 0.0F)
+    {
+        return;
+    }
+    // Half the width along the line's normal
+    const float nx{-dy / length * width * 0.5F};
+    const float ny{dx / length * width * 0.5F};
+    AppendQuad({{{x0 + nx, y0 + ny},
+                 {x0 - nx, y0 - ny},
+                 {x1 - nx, y1 - ny},
+                 {x1 + nx, y1 + ny}}},
+               colour);
+}
+
+template <typename Types>
+const BatchStats &BatchRenderer<Types>::LastStats() const
+{
+    return last_stats;
+}
+
+template <typename Types>
+void BatchRenderer<Types>::AppendQuad(
+    const std::array<std::array<float, 2>, 4> &corners,
+    const BatchColour &colour)
+{
+    const uint32_t pending{static_cast<uint32_t>(vertices.size()) /
+                           kVerticesPerQuad};
+    if (flushed_quads + pending >= region_quads)
+    {
+        ++stats.dropped_quads;
+        return;
+    }
+    if (pending == batch_quads)
+    {
+        ++stats.full_flushes;
+        Flush();
+    }
+
+    // Indices count from the batch's first vertex, its draw's base vertex
+    const auto first{static_cast<uint16_t>(vertices.size())};
+    for (const std::array<float, 2> &corner : corners)
+    {
+        vertices.push_back({corner, colour});
+    }
+    // Two anti-clockwise triangles
+    constexpr std::array<uint16_t, kIndicesPerQuad> kCorners{0, 1, 2, 0, 2, 3};
+    for (const uint16_t corner : kCorners)
+    {
+        indices.push_back(static_cast<uint16_t>(first + corner));
+    }
+    ++stats.quads;
+}
+
+template <typename Types>
+void BatchRenderer<Types>::Flush()
+{
+    if (vertices.empty())
+    {
+        return;
+    }
+    const auto quads{static_cast<uint32_t>(vertices.size()) /
+                     kVerticesPerQuad};
+    const uint64_t vertex_region_size{uint64_t{region_quads} *
+                                      kVerticesPerQuad * sizeof(BatchVertex)};
+    const uint64_t index_region_size{uint64_t{region_quads} * kIndicesPerQuad *
+                                     sizeof(uint16_t)};
+    const uint64_t vertex_region{region * vertex_region_size};
+    const uint64_t index_region{region * index_region_size};
+
+    const size_t vertex_bytes{vertices.size() * sizeof(BatchVertex)};
+    const size_t index_bytes{indices.size() * sizeof(uint16_t)};
+    upload_bytes(vertices_buffer,
+                 vertex_region + uint64_t{flushed_quads} * kVerticesPerQuad *
+                                     sizeof(BatchVertex),
+                 vertices.data(),
+                 vertex_bytes);
+    upload_bytes(indices_buffer,
+                 index_region + uint64_t{flushed_quads} * kIndicesPerQuad *
+                                    sizeof(uint16_t),
+                 indices.data(),
+                 index_bytes);
+
+    DrawPacket packet{};
+    // Only the sequence varies, so batches keep the order they were made in
+    packet.key = SortKey::Pack(render_pass, 0, 0, 0, sequence++);
+    packet.pipeline = current_pipeline;
+    packet.bind_group = current_bind_group;
+    packet.vertex_buffer = {vertices_buffer, vertex_region, vertex_region_size};
+    packet.index_buffer = {indices_buffer, index_region, index_region_size};
+    packet.index_format = format;
+    packet.index_count = quads * kIndicesPerQuad;
+    packet.first_index = flushed_quads * kIndicesPerQuad;
+    packet.base_vertex = static_cast<int32_t>(flushed_quads * kVerticesPerQuad);
+    emit_packet(packet);
+
+    flushed_quads += quads;
+    ++stats.batches;
+    stats.bytes_uploaded += vertex_bytes + index_bytes;
+    vertices.clear();
+    indices.clear();
+}
+
+#endif
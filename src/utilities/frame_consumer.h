@@ -0,0 +1,268 @@
+#ifndef SRC_UTILITIES_FRAME_CONSUMER_H
+#define SRC_UTILITIES_FRAME_CONSUMER_H
+
+#include <fmt/format.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class PixelOrder : uint8_t
+{
+    RGBA,
+    BGRA,
+};
+
+// One frame read back from the GPU, with rows tightly packed at four bytes a
+// pixel
+struct ReadbackFrame
+{
+    uint64_t frame_index{0};
+    uint32_t width{0};
+    uint32_t height{0};
+    PixelOrder order{PixelOrder::RGBA};
+    std::vector<uint8_t> pixels{};
+};
+
+// Texture to buffer copies need each row to start on this many bytes
+inline constexpr uint32_t kReadbackRowAlignment{256};
+inline constexpr uint32_t kReadbackBytesPerPixel{4};
+
+[[nodiscard]] constexpr uint32_t PaddedBytesPerRow(uint32_t width)
+{
+    const uint32_t bytes{width * kReadbackBytesPerPixel};
+    return (bytes + kReadbackRowAlignment - 1) / kReadbackRowAlignment *
+           kReadbackRowAlignment;
+}
+
+// Copy `frame.height` rows of `frame.width` pixels out of `padded`, where
+// they start `padded_bytes_per_row` apart
+void UnpadRows(const uint8_t *padded,
+               uint32_t padded_bytes_per_row,
+               ReadbackFrame &frame);
+
+// Write `frame` as a binary PPM, the format the texture loader reads. Alpha
+// is dropped.
+[[nodiscard]] bool WritePpm(const std::filesystem::path &path,
+                            const ReadbackFrame &frame);
+
+// Hands read back frames to a consumer, such as an encoder or a disk writer,
+// on a thread of its own, so a slow consumer never holds up a frame. Frames
+// that arrive while `queue_length` are already waiting are dropped and
+// counted. Without threads (Emscripten), frames are consumed as they arrive.
+//
+// Pixel buffers the consumer has finished with are kept for `SpareBuffer`, so
+// capturing every frame does not allocate every frame.
+class FrameConsumer
+{
+public:
+    using Consume = std::function<void(const ReadbackFrame &frame)>;
+
+    static constexpr size_t kDefaultQueueLength{8};
+
+    FrameConsumer() = default;
+    FrameConsumer(const FrameConsumer &) = delete;
+    FrameConsumer &operator=(const FrameConsumer &) = delete;
+    FrameConsumer(FrameConsumer &&) = delete;
+    FrameConsumer &operator=(FrameConsumer &&) = delete;
+    ~FrameConsumer();
+
+    void Start(Consume frame_consumer, size_t queue_length);
+    // Consume the frames already queued, then stop the thread
+    void Stop();
+
+    // Queue `frame` for the consumer, or return false if the queue is full
+    bool Push(ReadbackFrame frame);
+
+    // An empty pixel buffer, reusing one the consumer has finished with
+    [[nodiscard]] std::vector<uint8_t> SpareBuffer();
+
+    [[nodiscard]] uint64_t Consumed() const;
+    [[nodiscard]] uint64_t Dropped() const;
+
+private:
+    void Run();
+    void Recycle(std::vector<uint8_t> pixels);
+
+    Consume consume{};
+    size_t capacity{kDefaultQueueLength};
+    mutable std::mutex mutex{};
+    std::condition_variable frame_ready{};
+    std::deque<ReadbackFrame> queue{};
+    std::vector<std::vector<uint8_t>> spare_buffers{};
+    bool stopping{false};
+    uint64_t consumed{0};
+    uint64_t dropped{0};
+    std::thread worker{};
+};
+
+inline void UnpadRows(const uint8_t *padded,
+                      uint32_t padded_bytes_per_row,
+                      ReadbackFrame &frame)
+{
+    const size_t row_bytes{size_t{frame.width} * kReadbackBytesPerPixel};
+    frame.pixels.resize(row_bytes * frame.height);
+    for (size_t row{0}; row < frame.height; ++row)
+    {
+        std::memcpy(&frame.pixels.at(row * row_bytes),
+                    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                    padded + row * padded_bytes_per_row,
+                    row_bytes);
+    }
+}
+
+inline bool WritePpm(const std::filesystem::path &path,
+                     const ReadbackFrame &frame)
+{
+    std::ofstream file{path, std::ios::binary};
+    if (!file)
+    {
+        return false;
+    }
+    file << fmt::format("P6\n{} {}\n255\n", frame.width, frame.height);
+
+    const bool bgra{frame.order == PixelOrder::BGRA};
+    std::vector<char> rgb(size_t{frame.width} * frame.height * 3);
+    for (size_t pixel{0}; pixel * kReadbackBytesPerPixel < frame.pixels.size();
+         ++pixel)
+    {
+        const size_t source{pixel * kReadbackBytesPerPixel};
+        rgb.at(pixel * 3) =
+            static_cast<char>(frame.pixels.at(source + (bgra ? 2 : 0)));
+        rgb.at(pixel * 3 + 1) = static_cast<char>(frame.pixels.at(source + 1));
+        rgb.at(pixel * 3 + 2) =
+            static_cast<char>(frame.pixels.at(source + (bgra ? 0 : 2)));
+    }
+    file.write(rgb.data(), static_cast<std::streamsize>(rgb.size()));
+    return static_cast<bool>(file);
+}
+
+inline FrameConsumer::~FrameConsumer()
+{
+    Stop();
+}
+
+inline void FrameConsumer::Start(Consume frame_consumer, size_t queue_length)
+{
+    consume = std::move(frame_consumer);
+    capacity = queue_length;
+    stopping = false;
+#ifndef __EMSCRIPTEN__
+    worker = std::thread{[this]() { Run(); }};
+#endif
+}
+
+inline void FrameConsumer::Stop()
+{
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        stopping = true;
+    }
+    frame_ready.notify_one();
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+inline bool FrameConsumer::Push(ReadbackFrame frame)
+{
+#ifdef __EMSCRIPTEN__
+    consume(frame);
+    ++consumed;
+    Recycle(std::move(frame.pixels));
+    return true;
+#else
+    bool queued{false};
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        queued = !stopping && queue.size() < capacity;
+        if (queued)
+        {
+            queue.push_back(std::move(frame));
+        }
+        else
+        {
+            ++dropped;
+        }
+    }
+    if (!queued)
+    {
+        Recycle(std::move(frame.pixels));
+        return false;
+    }
+    frame_ready.notify_one();
+    return true;
+#endif
+}
+
+inline std::vector<uint8_t> FrameConsumer::SpareBuffer()
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    if (spare_buffers.empty())
+    {
+        return {};
+    }
+    std::vector<uint8_t> pixels{std::move(spare_buffers.back())};
+    spare_buffers.pop_back();
+    return pixels;
+}
+
+inline uint64_t FrameConsumer::Consumed() const
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    return consumed;
+}
+
+inline uint64_t FrameConsumer::Dropped() const
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    return dropped;
+}
+
+inline void FrameConsumer::Run()
+{
+    while (true)
+    {
+        ReadbackFrame frame{};
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            frame_ready.wait(lock,
+                             [this]() { return stopping || !queue.empty(); });
+            if (queue.empty())
+            {
+                return;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        consume(frame);
+        {
+            const std::lock_guard<std::mutex> lock{mutex};
+            ++consumed;
+        }
+        Recycle(std::move(frame.pixels));
+    }
+}
+
+inline void FrameConsumer::Recycle(std::vector<uint8_t> pixels)
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    // Enough for every queued frame plus the one being consumed
+    if (spare_buffers.size() <= capacity)
+    {
+        pixels.clear();
+        spare_buffers.push_back(std::move(pixels));
+    }
+}
+
+#endif
@@ -0,0 +1,370 @@
+#ifndef SRC_UTILITIES_FRAME_READBACK_H
+#define SRC_UTILITIES_FRAME_READBACK_H
+
+#include "frame_consumer.h"
+#include "gpu_memory_tracker.h"
+#include "logging.h"
+#include "wgpu_format.h"
+
+#include <webgpu/webgpu.h>
+#include <webgpu/webgpu.hpp>
+#ifdef WEBGPU_BACKEND_WGPU
+#include <webgpu/wgpu.h>
+#endif
+
+#include <fmt/format.h>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+struct ReadbackStats
+{
+    // Frames copied into a readback buffer
+    uint64_t captured{0};
+    // Frames handed to the consumer
+    uint64_t delivered{0};
+    // Frames dropped because every readback buffer was still in flight
+    uint64_t dropped_busy{0};
+    // Frames dropped because the consumer's queue was full
+    uint64_t dropped_consumer{0};
+    // Frames whose buffer failed to map
+    uint64_t failed{0};
+    // Most frames between a capture and its delivery
+    uint64_t max_latency_frames{0};
+};
+
+// Reads rendered frames back without stalling. Each captured frame is copied
+// into one of a pool of MapRead buffers and mapped with `mapAsync`; the
+// mapping completes during the main loop's device poll, and `Poll` then hands
+// the pixels to a FrameConsumer. A frame that finds every buffer still in
+// flight is dropped and counted rather than waited for, so the pool size is
+// the most latency capture can add.
+//
+// The texture must be 4 bytes a pixel, RGBA8 or BGRA8, and have CopySrc
+// usage. Mapping callbacks run on whichever thread polls the device, which
+// may be another than the one capturing.
+class FrameReadback
+{
+public:
+    static constexpr size_t kDefaultBufferCount{4};
+
+    [[nodiscard]] bool Initialise(wgpu::Device readback_device,
+                                  uint32_t texture_width,
+                                  uint32_t texture_height,
+                                  wgpu::TextureFormat format,
+                                  size_t buffer_count,
+                                  FrameConsumer &frame_consumer,
+                                  GpuMemoryTracker &tracker);
+    // Wait for mappings still in flight and deliver them, then release the
+    // buffers
+    void Terminate();
+
+    // Encode a copy of `texture` for frame `frame_index`, or return false and
+    // drop the frame if no buffer is free
+    bool Capture(wgpu::CommandEncoder &encoder,
+                 wgpu::Texture texture,
+                 uint64_t frame_index);
+    // Start mapping the buffers captured into, once their copies have been
+    // submitted
+    void Submitted();
+    // Hand frames whose buffers have mapped to the consumer, oldest first.
+    // Never blocks.
+    void Poll(uint64_t frame_index);
+
+    [[nodiscard]] bool IsActive() const;
+    [[nodiscard]] const ReadbackStats &Stats() const;
+    // One line of counts, for the periodic statistics and shutdown
+    [[nodiscard]] std::string Summary() const;
+
+    [[nodiscard]] static std::optional<PixelOrder> OrderOf(
+        wgpu::TextureFormat format);
+
+private:
+    enum class State : uint8_t
+    {
+        Free,
+        // A copy is encoded but not yet submitted
+        Copied,
+        Mapping,
+        Mapped,
+        Failed,
+    };
+
+    struct Slot
+    {
+        wgpu::Buffer buffer{nullptr};
+        std::atomic<State> state{State::Free};
+        uint64_t frame_index{0};
+    };
+
+    static void OnMapped(WGPUBufferMapAsyncStatus status, void *user_data);
+    [[nodiscard]] bool HasMappingsInFlight() const;
+
+    std::optional<wgpu::Device> device{std::nullopt};
+    FrameConsumer *consumer{nullptr};
+    GpuMemoryTracker *gpu_memory{nullptr};
+    uint32_t width{0};
+    uint32_t height{0};
+    PixelOrder order{PixelOrder::RGBA};
+    uint32_t padded_bytes_per_row{0};
+    // Boxed, as mapping callbacks hold their addresses
+    std::vector<std::unique_ptr<Slot>> slots{};
+    ReadbackStats stats{};
+};
+
+inline bool FrameReadback::Initialise(wgpu::Device readback_device,
+                                      uint32_t texture_width,
+                                      uint32_t texture_height,
+                                      wgpu::TextureFormat format,
+                                      size_t buffer_count,
+                                      FrameConsumer &frame_consumer,
+                                      GpuMemoryTracker &tracker)
+{
+    const std::optional<PixelOrder> pixel_order{OrderOf(format)};
+    if (!pixel_order.has_value())
+    {
+        spdlog::error("Cannot read back frames of texture format {:#x}",
+                      static_cast<uint32_t>(format));
+        return false;
+    }
+    device = readback_device;
+    consumer = &frame_consumer;
+    gpu_memory = &tracker;
+    width = texture_width;
+    height = texture_height;
+    order = pixel_order.value();
+    padded_bytes_per_row = PaddedBytesPerRow(width);
+
+    wgpu::BufferDescriptor descriptor{};
+    descriptor.label = "Frame readback buffer";
+    descriptor.size = uint64_t{padded_bytes_per_row} * height;
+    descriptor.usage = wgpu::BufferUsage::CopyDst | wgpu::BufferUsage::MapRead;
+    descriptor.mappedAtCreation = 0U;
+    for (size_t index{0}; index < buffer_count; ++index)
+    {
+        auto slot{std::make_unique<Slot>()};
+        slot->buffer = readback_device.createBuffer(descriptor);
+        tracker.Track(slot->buffer,
+                      GpuObjectCategory::Buffer,
+                      descriptor.label,
+                      descriptor.size,
+                      static_cast<uint32_t>(descriptor.usage),
+                      GPU_CALL_SITE);
+        slots.push_back(std::move(slot));
+    }
+    return true;
+}
+
+inline void FrameReadback::Terminate()
+{
+    if (device.has_value())
+    {
+        // The callbacks point at the slots, so let them run first
+        while (HasMappingsInFlight())
+        {
+#if defined(WEBGPU_BACKEND_DAWN)
+            wgpuDeviceTick(device.value());
+#elif defined(WEBGPU_BACKEND_WGPU)
+            wgpuDevicePoll(device.value(), 1U, nullptr);
+#else
+            break;
+#endif
+        }
+        uint64_t last_frame_index{0};
+        for (const std::unique_ptr<Slot> &slot : slots)
+        {
+            last_frame_index = std::max(last_frame_index, slot->frame_index);
+        }
+        Poll(last_frame_index);
+    }
+    for (const std::unique_ptr<Slot> &slot : slots)
+    {
+        gpu_memory->Untrack(slot->buffer);
+        slot->buffer.release();
+    }
+    // Slots whose callbacks have yet to run must outlive them
+    if (!HasMappingsInFlight())
+    {
+        slots.clear();
+    }
+    device.reset();
+}
+
+inline bool FrameReadback::Capture(wgpu::CommandEncoder &encoder,
+                                   wgpu::Texture texture,
+                                   uint64_t frame_index)
+{
+    const auto free_slot{std::find_if(
+        slots.begin(), slots.end(), [](const std::unique_ptr<Slot> &slot) {
+            return slot->state == State::Free;
+        })};
+    if (free_slot == slots.end())
+    {
+        ++stats.dropped_busy;
+        return false;
+    }
+    Slot &slot{**free_slot};
+
+    wgpu::ImageCopyTexture source{};
+    source.texture = texture;
+    source.mipLevel = 0;
+    source.origin = {0, 0, 0};
+    source.aspect = wgpu::TextureAspect::All;
+
+    wgpu::ImageCopyBuffer destination{};
+    destination.buffer = slot.buffer;
+    destination.layout.offset = 0;
+    destination.layout.bytesPerRow = padded_bytes_per_row;
+    destination.layout.rowsPerImage = height;
+
+    const WGPUExtent3D copy_size{width, height, 1};
+    encoder.copyTextureToBuffer(source, destination, copy_size);
+    slot.state = State::Copied;
+    slot.frame_index = frame_index;
+    ++stats.captured;
+    return true;
+}
+
+inline void FrameReadback::Submitted()
+{
+    for (const std::unique_ptr<Slot> &slot : slots)
+    {
+        if (slot->state == State::Copied)
+        {
+            slot->state = State::Mapping;
+            wgpuBufferMapAsync(slot->buffer,
+                               WGPUMapMode_Read,
+                               0,
+                               size_t{padded_bytes_per_row} * height,
+                               OnMapped,
+                               slot.get());
+        }
+    }
+}
+
+inline void FrameReadback::Poll(uint64_t frame_index)
+{
+    std::vector<Slot *> ready{};
+    for (const std::unique_ptr<Slot> &slot : slots)
+    {
+        if (slot->state == State::Failed)
+        {
+            ++stats.failed;
+            slot->state = State::Free;
+        }
+        else if (slot->state == State::Mapped)
+        {
+            ready.push_back(slot.get());
+        }
+    }
+    std::sort(ready.begin(),
+              ready.end(),
+              [](const Slot *left, const Slot *right) {
+                  return left->frame_index < right->frame_index;
+              });
+
+    for (Slot *slot : ready)
+    {
+        ReadbackFrame frame{slot->frame_index,
+                            width,
+                            height,
+                            order,
+                            consumer->SpareBuffer()};
+        const auto *mapped{static_cast<const uint8_t *>(
+            slot->buffer.getConstMappedRange(
+                0, size_t{padded_bytes_per_row} * height))};
+        if (mapped != nullptr)
+        {
+            UnpadRows(mapped, padded_bytes_per_row, frame);
+        }
+        slot->buffer.unmap();
+        slot->state = State::Free;
+
+        stats.max_latency_frames = std::max(stats.max_latency_frames,
+                                            frame_index - slot->frame_index);
+        if (mapped == nullptr)
+        {
+            ++stats.failed;
+        }
+        else if (consumer->Push(std::move(frame)))
+        {
+            ++stats.delivered;
+        }
+        else
+        {
+            ++stats.dropped_consumer;
+        }
+    }
+}
+
+inline bool FrameReadback::IsActive() const
+{
+    return !slots.empty();
+}
+
+inline const ReadbackStats &FrameReadback::Stats() const
+{
+    return stats;
+}
+
+inline std::string FrameReadback::Summary() const
+{
+    return fmt::format("Frame readback: {} captured, {} delivered, {} dropped "
+                       "with every buffer in flight, {} dropped by a busy "
+                       "consumer, {} failed, latency up to {} frames",
+                       stats.captured,
+                       stats.delivered,
+                       stats.dropped_busy,
+                       stats.dropped_consumer,
+                       stats.failed,
+                       stats.max_latency_frames);
+}
+
+inline std::optional<PixelOrder> FrameReadback::OrderOf(
+    wgpu::TextureFormat format)
+{
+    switch (format)
+    {
+    case wgpu::TextureFormat::RGBA8Unorm:
+    case wgpu::TextureFormat::RGBA8UnormSrgb:
+        return PixelOrder::RGBA;
+    case wgpu::TextureFormat::BGRA8Unorm:
+    case wgpu::TextureFormat::BGRA8UnormSrgb:
+        return PixelOrder::BGRA;
+    default:
+        return std::nullopt;
+    }
+}
+
+inline void FrameReadback::OnMapped(WGPUBufferMapAsyncStatus status,
+                                    void *user_data)
+{
+    auto *slot{static_cast<Slot *>(user_data)};
+    if (status == WGPUBufferMapAsyncStatus_Success)
+    {
+        slot->state = State::Mapped;
+        return;
+    }
+    LOG_ERROR_RATE_LIMITED("Could not map the readback buffer of frame {}: "
+                           "status {}",
+                           slot->frame_index,
+                           status);
+    slot->state = State::Failed;
+}
+
+inline bool FrameReadback::HasMappingsInFlight() const
+{
+    return std::any_of(
+        slots.begin(), slots.end(), [](const std::unique_ptr<Slot> &slot) {
+            return slot->state == State::Mapping;
+        });
+}
+
+#endif
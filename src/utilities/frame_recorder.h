@@ -0,0 +1,603 @@
+#ifndef SRC_UTILITIES_FRAME_RECORDER_H
+#define SRC_UTILITIES_FRAME_RECORDER_H
+
+#include "frame_trace.h"
+
+#include <webgpu/webgpu.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+// Records the app's GPU work into a frame trace, for ReplayFrames to re-issue
+// on another device or backend. Object creation is recorded from `Start`
+// onwards, and frame commands for the next `frame_count` frames; the trace is
+// then closed. Every call is a no-op when no capture is in progress.
+//
+// Pipelines are recorded with their first vertex buffer layout and colour
+// target, and a single shader module, which is all the app uses.
+class FrameRecorder
+{
+public:
+    [[nodiscard]] bool Start(const std::filesystem::path &path,
+                             uint32_t frame_count);
+    [[nodiscard]] bool IsRecording() const;
+
+    void CreateBuffer(wgpu::Buffer buffer,
+                      const wgpu::BufferDescriptor &descriptor);
+    void WriteBuffer(wgpu::Buffer buffer,
+                     uint64_t offset,
+                     const void *data,
+                     size_t size);
+    void CreateTexture(wgpu::Texture texture);
+    void CreateTextureView(wgpu::TextureView view, wgpu::Texture texture);
+    void CreateSampler(wgpu::Sampler sampler,
+                       const wgpu::SamplerDescriptor &descriptor);
+    void CreateShaderModule(wgpu::ShaderModule module, std::string_view source);
+    void CreateBindGroupLayout(
+        wgpu::BindGroupLayout layout,
+        const wgpu::BindGroupLayoutDescriptor &descriptor);
+    void CreateRenderPipeline(wgpu::RenderPipeline pipeline,
+                              const wgpu::RenderPipelineDescriptor &descriptor,
+                              wgpu::BindGroupLayout bind_group_layout);
+    void CreateBindGroup(wgpu::BindGroup bind_group,
+                         const wgpu::BindGroupDescriptor &descriptor);
+
+    void BeginFrame();
+    void BeginRenderPass(uint32_t width,
+                         uint32_t height,
+                         wgpu::TextureFormat format,
+                         wgpu::Color clear_value);
+    void SetPipeline(wgpu::RenderPipeline pipeline);
+    void SetVertexBuffer(uint32_t slot,
+                         wgpu::Buffer buffer,
+                         uint64_t offset,
+                         uint64_t size);
+    void SetIndexBuffer(wgpu::Buffer buffer,
+                        wgpu::IndexFormat format,
+                        uint64_t offset,
+                        uint64_t size);
+    void SetBindGroup(uint32_t group_index, wgpu::BindGroup bind_group);
+    void DrawIndexed(uint32_t index_count,
+                     uint32_t instance_count,
+                     uint32_t first_index,
+                     int32_t base_vertex,
+                     uint32_t first_instance);
+    void EndRenderPass();
+    // Submission point. Closes the trace after the last captured frame.
+    void EndFrame();
+
+private:
+    using Op = FrameTraceFormat::Op;
+    using BindingKind = FrameTraceFormat::BindingKind;
+
+    // Give a newly created object the next id
+    uint32_t AssignId(const void *handle);
+    // Id of an object recorded earlier, or 0 if it was created before the
+    // capture started
+    [[nodiscard]] uint32_t Id(const void *handle) const;
+
+    std::atomic<bool> recording{false};
+    FrameTraceWriter writer{};
+    mutable std::mutex ids_mutex{};
+    std::unordered_map<const void *, uint32_t> ids{};
+    uint32_t next_id{1};
+    uint32_t frame_index{0};
+    uint32_t frames_to_capture{0};
+};
+
+// Encodes render pass commands into `pass` and records them too, for code
+// that draws through an encoder it is handed, such as RenderQueue
+class RecordingRenderPass
+{
+public:
+    RecordingRenderPass(wgpu::RenderPassEncoder render_pass,
+                        FrameRecorder &frame_recorder);
+
+    void setPipeline(wgpu::RenderPipeline pipeline);
+    void setBindGroup(uint32_t group_index,
+                      wgpu::BindGroup bind_group,
+                      size_t dynamic_offset_count,
+                      const uint32_t *dynamic_offsets);
+    void setVertexBuffer(uint32_t slot,
+                         wgpu::Buffer buffer,
+                         uint64_t offset,
+                         uint64_t size);
+    void setIndexBuffer(wgpu::Buffer buffer,
+                        wgpu::IndexFormat format,
+                        uint64_t offset,
+                        uint64_t size);
+    void drawIndexed(uint32_t index_count,
+                     uint32_t instance_count,
+                     uint32_t first_index,
+                     int32_t base_vertex,
+                     uint32_t first_instance);
+
+private:
+    wgpu::RenderPassEncoder pass;
+    FrameRecorder *recorder;
+};
+
+inline bool FrameRecorder::Start(const std::filesystem::path &path,
+                                 uint32_t frame_count)
+{
+    if (!writer.Open(path))
+    {
+        spdlog::error("Was not able to open `{}` for frame capture",
+                      path.string());
+        return false;
+    }
+    frames_to_capture = frame_count;
+    recording = true;
+    spdlog::info("Capturing {} frames to `{}`", frame_count, path.string());
+    return true;
+}
+
+inline bool FrameRecorder::IsRecording() const
+{
+    return recording;
+}
+
+inline void FrameRecorder::CreateBuffer(
+    wgpu::Buffer buffer,
+    const wgpu::BufferDescriptor &descriptor)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(AssignId(buffer))
+        .Write(descriptor.size)
+        .Write(static_cast<uint32_t>(descriptor.usage));
+    writer.Write(Op::CreateBuffer, payload);
+}
+
+inline void FrameRecorder::WriteBuffer(wgpu::Buffer buffer,
+                                       uint64_t offset,
+                                       const void *data,
+                                       size_t size)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(Id(buffer)).Write(offset).WriteBytes(data, size);
+    writer.Write(Op::WriteBuffer, payload);
+}
+
+inline void FrameRecorder::CreateTexture(wgpu::Texture texture)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(AssignId(texture))
+        .Write(texture.getWidth())
+        .Write(texture.getHeight())
+        .Write(static_cast<uint32_t>(texture.getFormat()))
+        .Write(texture.getMipLevelCount())
+        .Write(static_cast<uint32_t>(texture.getUsage()));
+    writer.Write(Op::CreateTexture, payload);
+}
+
+inline void FrameRecorder::CreateTextureView(wgpu::TextureView view,
+                                             wgpu::Texture texture)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(AssignId(view)).Write(Id(texture));
+    writer.Write(Op::CreateTextureView, payload);
+}
+
+inline void FrameRecorder::CreateSampler(
+    wgpu::Sampler sampler,
+    const wgpu::SamplerDescriptor &descriptor)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(AssignId(sampler))
+        .Write(static_cast<uint32_t>(descriptor.addressModeU))
+        .Write(static_cast<uint32_t>(descriptor.addressModeV))
+        .Write(static_cast<uint32_t>(descriptor.addressModeW))
+        .Write(static_cast<uint32_t>(descriptor.magFilter))
+        .Write(static_cast<uint32_t>(descriptor.minFilter))
+        .Write(static_cast<uint32_t>(descriptor.mipmapFilter))
+        .Write(descriptor.lodMinClamp)
+        .Write(descriptor.lodMaxClamp);
+    writer.Write(Op::CreateSampler, payload);
+}
+
+inline void FrameRecorder::CreateShaderModule(wgpu::ShaderModule module,
+                                              std::string_view source)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(AssignId(module)).WriteString(source);
+    writer.Write(Op::CreateShaderModule, payload);
+}
+
+inline void FrameRecorder::CreateBindGroupLayout(
+    wgpu::BindGroupLayout layout,
+    const wgpu::BindGroupLayoutDescriptor &descriptor)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(AssignId(layout))
+        .Write(static_cast<uint32_t>(descriptor.entryCount));
+    for (size_t index{0}; index < descriptor.entryCount; ++index)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const WGPUBindGroupLayoutEntry &entry{descriptor.entries[index]};
+        payload.Write(entry.binding).Write(
+            static_cast<uint32_t>(entry.visibility));
+        if (entry.buffer.type != WGPUBufferBindingType_Undefined)
+        {
+            payload
+                .Write(BindingKind::Buffer)
+                .Write(static_cast<uint32_t>(entry.buffer.type))
+                .Write(entry.buffer.minBindingSize)
+                .Write(uint32_t{0});
+        }
+        else if (entry.texture.sampleType != WGPUTextureSampleType_Undefined)
+        {
+            payload
+                .Write(BindingKind::Texture)
+                .Write(static_cast<uint32_t>(entry.texture.sampleType))
+                .Write(uint64_t{0})
+                .Write(static_cast<uint32_t>(entry.texture.viewDimension));
+        }
+        else
+        {
+            payload
+                .Write(BindingKind::Sampler)
+                .Write(static_cast<uint32_t>(entry.sampler.type))
+                .Write(uint64_t{0})
+                .Write(uint32_t{0});
+        }
+    }
+    writer.Write(Op::CreateBindGroupLayout, payload);
+}
+
+inline void FrameRecorder::CreateRenderPipeline(
+    wgpu::RenderPipeline pipeline,
+    const wgpu::RenderPipelineDescriptor &descriptor,
+    wgpu::BindGroupLayout bind_group_layout)
+{
+    if (!IsRecording() || descriptor.fragment == nullptr)
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(AssignId(pipeline))
+        .Write(Id(bind_group_layout))
+        .Write(Id(descriptor.vertex.module));
+
+    auto write_stage{[&payload](const char *entry_point,
+                                size_t constant_count,
+                                const WGPUConstantEntry *constants) {
+        payload.WriteString(entry_point).Write(
+            static_cast<uint32_t>(constant_count));
+        for (size_t index{0}; index < constant_count; ++index)
+        {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            payload.WriteString(constants[index].key)
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                .Write(constants[index].value);
+        }
+    }};
+    const WGPUFragmentState &fragment{*descriptor.fragment};
+    write_stage(descriptor.vertex.entryPoint,
+                descriptor.vertex.constantCount,
+                descriptor.vertex.constants);
+    write_stage(fragment.entryPoint,
+                fragment.constantCount,
+                fragment.constants);
+
+    if (descriptor.vertex.bufferCount > 0)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const WGPUVertexBufferLayout &layout{descriptor.vertex.buffers[0]};
+        payload.Write(layout.arrayStride)
+            .Write(static_cast<uint32_t>(layout.attributeCount));
+        for (size_t index{0}; index < layout.attributeCount; ++index)
+        {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            const WGPUVertexAttribute &attribute{layout.attributes[index]};
+            payload.Write(static_cast<uint32_t>(attribute.format))
+                .Write(attribute.offset)
+                .Write(attribute.shaderLocation);
+        }
+    }
+    else
+    {
+        payload.Write(uint64_t{0}).Write(uint32_t{0});
+    }
+
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const WGPUColorTargetState &target{fragment.targets[0]};
+    payload.Write(static_cast<uint32_t>(descriptor.primitive.topology))
+        .Write(static_cast<uint32_t>(descriptor.primitive.frontFace))
+        .Write(static_cast<uint32_t>(descriptor.primitive.cullMode))
+        .Write(static_cast<uint32_t>(target.format))
+        .Write(static_cast<uint8_t>(target.blend != nullptr ? 1 : 0));
+    const WGPUBlendState blend{target.blend != nullptr ? *target.blend
+                                                       : WGPUBlendState{}};
+    for (const WGPUBlendComponent &component : {blend.color, blend.alpha})
+    {
+        payload.Write(static_cast<uint32_t>(component.operation))
+            .Write(static_cast<uint32_t>(component.srcFactor))
+            .Write(static_cast<uint32_t>(component.dstFactor));
+    }
+    writer.Write(Op::CreateRenderPipeline, payload);
+}
+
+inline void FrameRecorder::CreateBindGroup(
+    wgpu::BindGroup bind_group,
+    const wgpu::BindGroupDescriptor &descriptor)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(AssignId(bind_group))
+        .Write(Id(descriptor.layout))
+        .Write(static_cast<uint32_t>(descriptor.entryCount));
+    for (size_t index{0}; index < descriptor.entryCount; ++index)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const WGPUBindGroupEntry &entry{descriptor.entries[index]};
+        payload.Write(entry.binding);
+        if (entry.buffer != nullptr)
+        {
+            payload
+                .Write(BindingKind::Buffer)
+                .Write(Id(entry.buffer));
+        }
+        else if (entry.textureView != nullptr)
+        {
+            payload
+                .Write(BindingKind::Texture)
+                .Write(Id(entry.textureView));
+        }
+        else
+        {
+            payload
+                .Write(BindingKind::Sampler)
+                .Write(Id(entry.sampler));
+        }
+        payload.Write(entry.offset).Write(entry.size);
+    }
+    writer.Write(Op::CreateBindGroup, payload);
+}
+
+inline void FrameRecorder::BeginFrame()
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(frame_index);
+    writer.Write(Op::BeginFrame, payload);
+}
+
+inline void FrameRecorder::BeginRenderPass(uint32_t width,
+                                           uint32_t height,
+                                           wgpu::TextureFormat format,
+                                           wgpu::Color clear_value)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(width)
+        .Write(height)
+        .Write(static_cast<uint32_t>(format))
+        .Write(clear_value.r)
+        .Write(clear_value.g)
+        .Write(clear_value.b)
+        .Write(clear_value.a);
+    writer.Write(Op::BeginRenderPass, payload);
+}
+
+inline void FrameRecorder::SetPipeline(wgpu::RenderPipeline pipeline)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(Id(pipeline));
+    writer.Write(Op::SetPipeline, payload);
+}
+
+inline void FrameRecorder::SetVertexBuffer(uint32_t slot,
+                                           wgpu::Buffer buffer,
+                                           uint64_t offset,
+                                           uint64_t size)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(slot).Write(Id(buffer)).Write(offset).Write(size);
+    writer.Write(Op::SetVertexBuffer, payload);
+}
+
+inline void FrameRecorder::SetIndexBuffer(wgpu::Buffer buffer,
+                                          wgpu::IndexFormat format,
+                                          uint64_t offset,
+                                          uint64_t size)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(Id(buffer))
+        .Write(static_cast<uint32_t>(format))
+        .Write(offset)
+        .Write(size);
+    writer.Write(Op::SetIndexBuffer, payload);
+}
+
+inline void FrameRecorder::SetBindGroup(uint32_t group_index,
+                                        wgpu::BindGroup bind_group)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(group_index).Write(Id(bind_group));
+    writer.Write(Op::SetBindGroup, payload);
+}
+
+inline void FrameRecorder::DrawIndexed(uint32_t index_count,
+                                       uint32_t instance_count,
+                                       uint32_t first_index,
+                                       int32_t base_vertex,
+                                       uint32_t first_instance)
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    TracePayloadWriter payload{};
+    payload.Write(index_count)
+        .Write(instance_count)
+        .Write(first_index)
+        .Write(base_vertex)
+        .Write(first_instance);
+    writer.Write(Op::DrawIndexed, payload);
+}
+
+inline void FrameRecorder::EndRenderPass()
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    writer.Write(Op::EndRenderPass, TracePayloadWriter{});
+}
+
+inline void FrameRecorder::EndFrame()
+{
+    if (!IsRecording())
+    {
+        return;
+    }
+    writer.Write(Op::EndFrame, TracePayloadWriter{});
+    ++frame_index;
+    if (frame_index >= frames_to_capture)
+    {
+        recording = false;
+        spdlog::info("Frame capture complete: {} frames, {} bytes",
+                     frame_index,
+                     writer.BytesWritten());
+        writer.Close();
+    }
+}
+
+inline RecordingRenderPass::RecordingRenderPass(
+    wgpu::RenderPassEncoder render_pass,
+    FrameRecorder &frame_recorder)
+    : pass{render_pass}, recorder{&frame_recorder}
+{
+}
+
+inline void RecordingRenderPass::setPipeline(wgpu::RenderPipeline pipeline)
+{
+    pass.setPipeline(pipeline);
+    recorder->SetPipeline(pipeline);
+}
+
+inline void RecordingRenderPass::setBindGroup(uint32_t group_index,
+                                              wgpu::BindGroup bind_group,
+                                              size_t dynamic_offset_count,
+                                              const uint32_t *dynamic_offsets)
+{
+    pass.setBindGroup(group_index,
+                      bind_group,
+                      dynamic_offset_count,
+                      dynamic_offsets);
+    recorder->SetBindGroup(group_index, bind_group);
+}
+
+inline void RecordingRenderPass::setVertexBuffer(uint32_t slot,
+                                                 wgpu::Buffer buffer,
+                                                 uint64_t offset,
+                                                 uint64_t size)
+{
+    pass.setVertexBuffer(slot, buffer, offset, size);
+    recorder->SetVertexBuffer(slot, buffer, offset, size);
+}
+
+inline void RecordingRenderPass::setIndexBuffer(wgpu::Buffer buffer,
+                                                wgpu::IndexFormat format,
+                                                uint64_t offset,
+                                                uint64_t size)
+{
+    pass.setIndexBuffer(buffer, format, offset, size);
+    recorder->SetIndexBuffer(buffer, format, offset, size);
+}
+
+inline void RecordingRenderPass::drawIndexed(uint32_t index_count,
+                                             uint32_t instance_count,
+                                             uint32_t first_index,
+                                             int32_t base_vertex,
+                                             uint32_t first_instance)
+{
+    pass.drawIndexed(index_count,
+                     instance_count,
+                     first_index,
+                     base_vertex,
+                     first_instance);
+    recorder->DrawIndexed(index_count,
+                          instance_count,
+                          first_index,
+                          base_vertex,
+                          first_instance);
+}
+
+inline uint32_t FrameRecorder::AssignId(const void *handle)
+{
+    const std::lock_guard<std::mutex> lock{ids_mutex};
+    const uint32_t id{next_id++};
+    // Handles may be reused once released, so the newest object wins
+    ids[handle] = id;
+    return id;
+}
+
+inline uint32_t FrameRecorder::Id(const void *handle) const
+{
+    const std::lock_guard<std::mutex> lock{ids_mutex};
+    const auto found{ids.find(handle)};
+    return found == ids.end() ? 0 : found->second;
+}
+
+#endif
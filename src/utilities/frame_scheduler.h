@@ -0,0 +1,247 @@
+#ifndef SRC_UTILITIES_FRAME_SCHEDULER_H
+#define SRC_UTILITIES_FRAME_SCHEDULER_H
+
+#include "report_timer.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+enum class RenderMode : uint8_t
+{
+    // Draw on every main loop iteration
+    Continuous,
+    // Draw only once something has changed, and sleep otherwise
+    OnDemand,
+};
+
+// Reasons the scene needs drawing again. Combined as bit flags.
+enum class Damage : uint8_t
+{
+    Input = 1U << 0U,
+    Resize = 1U << 1U,
+    Animation = 1U << 2U,
+    Asset = 1U << 3U,
+};
+
+// Decides which main loop iterations draw a frame. Starts dirty, so the
+// first iteration always draws.
+class FrameScheduler
+{
+public:
+    void Initialise(RenderMode render_mode);
+
+    void MarkDirty(Damage reason);
+    [[nodiscard]] bool NeedsFrame() const;
+    // Clear the damage once a frame has been drawn, returning the flags that
+    // caused it
+    uint8_t FrameRendered();
+
+    [[nodiscard]] RenderMode Mode() const;
+
+private:
+    RenderMode mode{RenderMode::Continuous};
+    uint8_t damage{static_cast<uint8_t>(Damage::Resize)};
+};
+
+// Measures the work done over each ReportTimer interval: frames drawn, uniform
+// bytes uploaded and the share of one core the process used. Intervals where
+// nothing was drawn are reported as idle.
+class UtilisationMonitor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using CpuTime = std::chrono::duration<double>;
+
+    void FrameRendered(uint64_t bytes_uploaded);
+
+    // Return a report line once per interval. `cpu_time` is the process CPU
+    // time used so far, such as from `std::clock`.
+    [[nodiscard]] std::optional<std::string> Sample(Clock::time_point now,
+                                                    CpuTime cpu_time);
+
+private:
+    ReportTimer timer{};
+    CpuTime interval_cpu_time{};
+    uint32_t frames{0};
+    uint64_t bytes{0};
+};
+
+// Measures input latency, from an event arriving to the present of the
+// frame that handled it, and frame jitter, the standard deviation of the time
+// between consecutive presents. Loop iterations that draw nothing break the
+// run, so idle gaps on demand are not counted as frame intervals.
+class FrameTimingMonitor
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Input that arrived at `received` was handled by the frame being drawn
+    void InputHandled(Clock::time_point received);
+    // The frame being drawn was presented at `now`
+    void FramePresented(Clock::time_point now);
+    // A loop iteration drew nothing
+    void FrameSkipped();
+
+    // Return a report line once per interval, unless nothing was measured
+    [[nodiscard]] std::optional<std::string> Sample(Clock::time_point now);
+
+private:
+    ReportTimer timer{};
+    std::optional<Clock::time_point> last_present{std::nullopt};
+    // Arrival times of the input handled by the frame being drawn
+    std::vector<Clock::time_point> frame_input{};
+    // In seconds
+    uint32_t intervals{0};
+    double interval_sum{0.0};
+    double interval_sum_of_squares{0.0};
+    double worst_interval{0.0};
+    uint32_t inputs{0};
+    double latency_sum{0.0};
+    double worst_latency{0.0};
+};
+
+inline void FrameScheduler::Initialise(RenderMode render_mode)
+{
+    mode = render_mode;
+}
+
+inline void FrameScheduler::MarkDirty(Damage reason)
+{
+    damage |= static_cast<uint8_t>(reason);
+}
+
+inline bool FrameScheduler::NeedsFrame() const
+{
+    return mode == RenderMode::Continuous || damage != 0;
+}
+
+inline uint8_t FrameScheduler::FrameRendered()
+{
+    const uint8_t cause{damage};
+    damage = 0;
+    return cause;
+}
+
+inline RenderMode FrameScheduler::Mode() const
+{
+    return mode;
+}
+
+inline void UtilisationMonitor::FrameRendered(uint64_t bytes_uploaded)
+{
+    ++frames;
+    bytes += bytes_uploaded;
+}
+
+inline std::optional<std::string> UtilisationMonitor::Sample(
+    Clock::time_point now,
+    CpuTime cpu_time)
+{
+    if (!timer.IsRunning())
+    {
+        interval_cpu_time = cpu_time;
+    }
+    const std::optional<ReportTimer::Seconds> interval{timer.Tick(now)};
+    if (!interval.has_value())
+    {
+        return std::nullopt;
+    }
+    const ReportTimer::Seconds elapsed{interval.value()};
+
+    constexpr double kPercent{100.0};
+    std::string report{fmt::format(
+        "{}: {} frames drawn in {:.1f} s, {} bytes uploaded, CPU {:.1f}% of "
+        "one core",
+        frames == 0 ? "Idle" : "Active",
+        frames,
+        elapsed.count(),
+        bytes,
+        kPercent * (cpu_time - interval_cpu_time) / elapsed)};
+    interval_cpu_time = cpu_time;
+    frames = 0;
+    bytes = 0;
+    return report;
+}
+
+inline void FrameTimingMonitor::InputHandled(Clock::time_point received)
+{
+    frame_input.push_back(received);
+}
+
+inline void FrameTimingMonitor::FramePresented(Clock::time_point now)
+{
+    if (last_present.has_value())
+    {
+        const double interval{
+            std::chrono::duration<double>{now - last_present.value()}
+                .count()};
+        ++intervals;
+        interval_sum += interval;
+        interval_sum_of_squares += interval * interval;
+        worst_interval = std::max(worst_interval, interval);
+    }
+    last_present = now;
+
+    for (const Clock::time_point received : frame_input)
+    {
+        const double latency{
+            std::chrono::duration<double>{now - received}.count()};
+        ++inputs;
+        latency_sum += latency;
+        worst_latency = std::max(worst_latency, latency);
+    }
+    frame_input.clear();
+}
+
+inline void FrameTimingMonitor::FrameSkipped()
+{
+    last_present.reset();
+}
+
+inline std::optional<std::string> FrameTimingMonitor::Sample(
+    Clock::time_point now)
+{
+    if (!timer.Tick(now).has_value())
+    {
+        return std::nullopt;
+    }
+    if (intervals == 0 && inputs == 0)
+    {
+        return std::nullopt;
+    }
+
+    constexpr double kMilliseconds{1000.0};
+    const double count{intervals == 0 ? 1.0 : intervals};
+    const double mean{interval_sum / count};
+    // Rounding can take the variance of near-identical intervals below zero
+    const double variance{
+        std::max(0.0, interval_sum_of_squares / count - mean * mean)};
+    std::string report{fmt::format(
+        "Frame timing: {} intervals, mean {:.2f} ms, jitter {:.2f} ms, worst "
+        "{:.2f} ms; input latency mean {:.2f} ms, worst {:.2f} ms over {} "
+        "events",
+        intervals,
+        kMilliseconds * mean,
+        kMilliseconds * std::sqrt(variance),
+        kMilliseconds * worst_interval,
+        kMilliseconds * latency_sum / (inputs == 0 ? 1.0 : inputs),
+        kMilliseconds * worst_latency,
+        inputs)};
+    intervals = 0;
+    interval_sum = 0.0;
+    interval_sum_of_squares = 0.0;
+    worst_interval = 0.0;
+    inputs = 0;
+    latency_sum = 0.0;
+    worst_latency = 0.0;
+    return report;
+}
+
+#endif
@@ -0,0 +1,422 @@
+#ifndef SRC_UTILITIES_FRAME_TRACE_H
+#define SRC_UTILITIES_FRAME_TRACE_H
+
+#include "resource_pack.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// A frame trace is a flat, binary list of the GPU work the app issued:
+//
+//   header   | magic `LWFT`, u32 version
+//   commands | u8 opcode, u32 payload size, payload
+//
+// Payloads are sequences of little-endian integers and floats, with strings
+// and byte blobs prefixed by their u32 length; each opcode's layout is
+// documented alongside it below. Objects are referred to by u32 ids, assigned
+// in creation order. Enum values are the webgpu.h ones of the recording
+// build. Readers skip opcodes they do not know, using the payload size.
+class FrameTraceFormat
+{
+public:
+    static constexpr std::array<char, 4> kMagic{'L', 'W', 'F', 'T'};
+    static constexpr uint32_t kVersion{1};
+    static constexpr size_t kHeaderSize{8};
+    static constexpr size_t kCommandHeaderSize{5};
+
+    enum class Op : uint8_t
+    {
+        // id, u64 size, u32 usage
+        CreateBuffer = 1,
+        // buffer id, u64 offset, bytes
+        WriteBuffer = 2,
+        // id, u32 width, height, format, mip level count, usage. Contents
+        // are not captured: they do not change the cost of a draw.
+        CreateTexture = 3,
+        // id, texture id
+        CreateTextureView = 4,
+        // id, u32 address mode u, v, w, mag, min and mipmap filter,
+        // f32 lod min and max clamp
+        CreateSampler = 5,
+        // id, string WGSL source
+        CreateShaderModule = 6,
+        // id, u32 entry count, then per entry: u32 binding, visibility,
+        // u8 kind (see BindingKind), u32 buffer, sample or sampler type,
+        // u64 minimum binding size, u32 view dimension
+        CreateBindGroupLayout = 7,
+        // id, bind group layout id, shader module id, then for the vertex and
+        // fragment stage: string entry point, u32 constant count, then per
+        // constant: string key, f64 value. Then u64 array stride, u32
+        // attribute count, per attribute: u32 format, u64 offset, u32 shader
+        // location. Then u32 topology, front face, cull mode, target format,
+        // u8 has blend, u32 colour operation, source, destination factor,
+        // alpha operation, source, destination factor.
+        CreateRenderPipeline = 8,
+        // id, layout id, u32 entry count, then per entry: u32 binding,
+        // u8 kind (see BindingKind), resource id, u64 offset, u64 size
+        CreateBindGroup = 9,
+        // u32 frame index
+        BeginFrame = 10,
+        // u32 target width, height, format, f64 clear r, g, b, a
+        BeginRenderPass = 11,
+        // pipeline id
+        SetPipeline = 12,
+        // u32 slot, buffer id, u64 offset, u64 size
+        SetVertexBuffer = 13,
+        // buffer id, u32 format, u64 offset, u64 size
+        SetIndexBuffer = 14,
+        // u32 group index, bind group id
+        SetBindGroup = 15,
+        // u32 index count, instance count, first index, i32 base vertex,
+        // u32 first instance
+        DrawIndexed = 16,
+        EndRenderPass = 17,
+        // The frame's commands are submitted here
+        EndFrame = 18,
+    };
+
+    enum class BindingKind : uint8_t
+    {
+        Buffer = 0,
+        Texture = 1,
+        Sampler = 2,
+    };
+};
+
+// Builds one command payload
+class TracePayloadWriter
+{
+public:
+    template <typename T>
+    TracePayloadWriter &Write(T value);
+    TracePayloadWriter &WriteString(std::string_view value);
+    TracePayloadWriter &WriteBytes(const void *data, size_t size);
+
+    [[nodiscard]] const std::vector<uint8_t> &data() const;
+
+private:
+    std::vector<uint8_t> bytes{};
+};
+
+// Reads one command payload back. Reading past the end yields zeroes and
+// clears `ok()`, so callers can decode a whole command before checking.
+class TracePayloadReader
+{
+public:
+    explicit TracePayloadReader(std::string_view payload);
+
+    template <typename T>
+    [[nodiscard]] T Read();
+    [[nodiscard]] std::string_view ReadString();
+    [[nodiscard]] std::string_view ReadBytes();
+
+    [[nodiscard]] bool ok() const;
+
+private:
+    [[nodiscard]] std::optional<std::string_view> Take(size_t size);
+
+    std::string_view remaining{};
+    bool valid{true};
+};
+
+// Appends commands to a trace file. Safe to call from several threads, as
+// pipelines may be created off the main thread.
+class FrameTraceWriter
+{
+public:
+    [[nodiscard]] bool Open(const std::filesystem::path &path);
+    void Write(FrameTraceFormat::Op op, const TracePayloadWriter &payload);
+    void Close();
+
+    [[nodiscard]] bool IsOpen() const;
+    [[nodiscard]] uint64_t BytesWritten() const;
+
+private:
+    mutable std::mutex mutex{};
+    std::ofstream file{};
+    uint64_t bytes_written{0};
+};
+
+class FrameTraceReader
+{
+public:
+    struct Command
+    {
+        FrameTraceFormat::Op op{};
+        std::string_view payload{};
+    };
+
+    // Map the trace at `path`, returning nothing if it is not a trace
+    [[nodiscard]] static std::optional<FrameTraceReader> Open(
+        const std::filesystem::path &path);
+    [[nodiscard]] static std::optional<FrameTraceReader> FromMemory(
+        std::string_view bytes);
+
+    // Step to the next command, returning false at the end of the trace or
+    // on a truncated command
+    [[nodiscard]] bool Next(Command &command);
+
+    // Start again from the first command
+    void Rewind();
+
+private:
+    [[nodiscard]] static bool HasValidHeader(std::string_view bytes);
+
+    std::optional<MappedFile> file{std::nullopt};
+    std::string_view trace{};
+    size_t position{FrameTraceFormat::kHeaderSize};
+};
+
+template <typename T>
+inline TracePayloadWriter &TracePayloadWriter::Write(T value)
+{
+    std::array<uint8_t, sizeof(T)> encoded{};
+    if constexpr (std::is_enum_v<T>)
+    {
+        return Write(static_cast<std::underlying_type_t<T>>(value));
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        using Bits = std::conditional_t<sizeof(T) == sizeof(uint32_t),
+                                        uint32_t,
+                                        uint64_t>;
+        Bits bits{};
+        std::memcpy(&bits, &value, sizeof(T));
+        ResourcePackFormat::Store(encoded.data(), bits);
+    }
+    else
+    {
+        ResourcePackFormat::Store(encoded.data(), value);
+    }
+    bytes.insert(bytes.end(), encoded.begin(), encoded.end());
+    return *this;
+}
+
+inline TracePayloadWriter &TracePayloadWriter::WriteString(
+    std::string_view value)
+{
+    return WriteBytes(value.data(), value.size());
+}
+
+inline TracePayloadWriter &TracePayloadWriter::WriteBytes(const void *data,
+                                                          size_t size)
+{
+    Write(static_cast<uint32_t>(size));
+    const auto *first{static_cast<const uint8_t *>(data)};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    bytes.insert(bytes.end(), first, first + size);
+    return *this;
+}
+
+inline const std::vector<uint8_t> &TracePayloadWriter::data() const
+{
+    return bytes;
+}
+
+inline TracePayloadReader::TracePayloadReader(std::string_view payload)
+    : remaining{payload}
+{
+}
+
+template <typename T>
+inline T TracePayloadReader::Read()
+{
+    const std::optional<std::string_view> encoded{Take(sizeof(T))};
+    if (!encoded.has_value())
+    {
+        return T{};
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *bytes{reinterpret_cast<const uint8_t *>(encoded->data())};
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        using Bits = std::conditional_t<sizeof(T) == sizeof(uint32_t),
+                                        uint32_t,
+                                        uint64_t>;
+        const Bits bits{ResourcePackFormat::Load<Bits>(bytes)};
+        T value{};
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
+    else if constexpr (std::is_signed_v<T>)
+    {
+        using Unsigned = std::make_unsigned_t<T>;
+        return static_cast<T>(ResourcePackFormat::Load<Unsigned>(bytes));
+    }
+    else
+    {
+        return ResourcePackFormat::Load<T>(bytes);
+    }
+}
+
+inline std::string_view TracePayloadReader::ReadString()
+{
+    return ReadBytes();
+}
+
+inline std::string_view TracePayloadReader::ReadBytes()
+{
+    const auto size{Read<uint32_t>()};
+    return Take(size).value_or(std::string_view{});
+}
+
+inline bool TracePayloadReader::ok() const
+{
+    return valid;
+}
+
+inline std::optional<std::string_view> TracePayloadReader::Take(size_t size)
+{
+    if (!valid || size > remaining.size())
+    {
+        valid = false;
+        return std::nullopt;
+    }
+    const std::string_view taken{remaining.substr(0, size)};
+    remaining.remove_prefix(size);
+    return taken;
+}
+
+inline bool FrameTraceWriter::Open(const std::filesystem::path &path)
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    TracePayloadWriter header{};
+    for (const char character : FrameTraceFormat::kMagic)
+    {
+        header.Write(static_cast<uint8_t>(character));
+    }
+    header.Write(FrameTraceFormat::kVersion);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file.write(reinterpret_cast<const char *>(header.data().data()),
+               static_cast<std::streamsize>(header.data().size()));
+    bytes_written = header.data().size();
+    return static_cast<bool>(file);
+}
+
+inline void FrameTraceWriter::Write(FrameTraceFormat::Op op,
+                                    const TracePayloadWriter &payload)
+{
+    TracePayloadWriter command_header{};
+    command_header.Write(static_cast<uint8_t>(op))
+        .Write(static_cast<uint32_t>(payload.data().size()));
+
+    const std::lock_guard<std::mutex> lock{mutex};
+    if (!file.is_open())
+    {
+        return;
+    }
+    for (const std::vector<uint8_t> *bytes :
+         {&command_header.data(), &payload.data()})
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        file.write(reinterpret_cast<const char *>(bytes->data()),
+                   static_cast<std::streamsize>(bytes->size()));
+        bytes_written += bytes->size();
+    }
+}
+
+inline void FrameTraceWriter::Close()
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    file.close();
+}
+
+inline bool FrameTraceWriter::IsOpen() const
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    return file.is_open();
+}
+
+inline uint64_t FrameTraceWriter::BytesWritten() const
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    return bytes_written;
+}
+
+inline std::optional<FrameTraceReader> FrameTraceReader::Open(
+    const std::filesystem::path &path)
+{
+    std::optional<MappedFile> mapped{MappedFile::Open(path)};
+    if (!mapped.has_value() || !HasValidHeader(mapped.value().data()))
+    {
+        return std::nullopt;
+    }
+    FrameTraceReader reader{};
+    reader.trace = mapped.value().data();
+    reader.file = std::move(mapped);
+    return reader;
+}
+
+inline std::optional<FrameTraceReader> FrameTraceReader::FromMemory(
+    std::string_view bytes)
+{
+    if (!HasValidHeader(bytes))
+    {
+        return std::nullopt;
+    }
+    FrameTraceReader reader{};
+    reader.trace = bytes;
+    return reader;
+}
+
+inline bool FrameTraceReader::Next(Command &command)
+{
+    if (trace.size() - position < FrameTraceFormat::kCommandHeaderSize)
+    {
+        return false;
+    }
+    TracePayloadReader header{
+        trace.substr(position, FrameTraceFormat::kCommandHeaderSize)};
+    const auto op{static_cast<FrameTraceFormat::Op>(header.Read<uint8_t>())};
+    const auto size{static_cast<size_t>(header.Read<uint32_t>())};
+    const size_t payload_start{position + FrameTraceFormat::kCommandHeaderSize};
+    if (size > trace.size() - payload_start)
+    {
+        return false;
+    }
+    command.op = op;
+    command.payload = trace.substr(payload_start, size);
+    position = payload_start + size;
+    return true;
+}
+
+inline void FrameTraceReader::Rewind()
+{
+    position = FrameTraceFormat::kHeaderSize;
+}
+
+inline bool FrameTraceReader::HasValidHeader(std::string_view bytes)
+{
+    if (bytes.size() < FrameTraceFormat::kHeaderSize)
+    {
+        return false;
+    }
+    TracePayloadReader header{bytes.substr(0, FrameTraceFormat::kHeaderSize)};
+    for (const char character : FrameTraceFormat::kMagic)
+    {
+        if (header.Read<uint8_t>() != static_cast<uint8_t>(character))
+        {
+            return false;
+        }
+    }
+    return header.Read<uint32_t>() == FrameTraceFormat::kVersion;
+}
+
+#endif
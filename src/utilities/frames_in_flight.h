@@ -0,0 +1,217 @@
+#ifndef SRC_UTILITIES_FRAMES_IN_FLIGHT_H
+#define SRC_UTILITIES_FRAMES_IN_FLIGHT_H
+
+#include "profiler.h"
+#include "report_timer.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+
+// Bounds how far the CPU runs ahead of the GPU. Each frame acquires a frame
+// slot before drawing, waiting while `Limit` submitted frames are still
+// unfinished, and reports completion from a queue work-done callback.
+// Per-frame resources indexed by slot are never in use by the GPU when the
+// CPU is given their slot.
+//
+// A lower limit trades throughput for latency: the GPU may idle between
+// frames, but what is drawn is shown sooner. Both are reported.
+//
+// Completion may be reported from any thread. While waiting, the acquiring
+// thread polls the device through `Poll` so callbacks can run, sleeping up
+// to `kWaitSlice` between polls unless woken by a completion.
+class FramesInFlight
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    // Let the device run callbacks without blocking
+    using Poll = std::function<void()>;
+
+    static constexpr uint32_t kDefaultLimit{2};
+    static constexpr uint32_t kMaxLimit{4};
+    static constexpr std::chrono::microseconds kWaitSlice{500};
+
+    void Initialise(uint32_t frame_limit);
+    [[nodiscard]] uint32_t Limit() const;
+
+    // Wait until fewer than `Limit` frames are in flight, then return the
+    // slot of the frame about to be drawn
+    [[nodiscard]] uint32_t Acquire(const Poll &poll);
+    // As Acquire, but return nothing rather than wait, for loops that must
+    // not block
+    [[nodiscard]] std::optional<uint32_t> TryAcquire();
+    // The frame acquired for was submitted at `now`
+    void Submitted(Clock::time_point now);
+    // The GPU finished the oldest frame still in flight
+    void Completed(Clock::time_point now);
+
+    [[nodiscard]] uint32_t InFlight() const;
+
+    // Return a report line once per interval, unless no frame was submitted
+    [[nodiscard]] std::optional<std::string> Sample(Clock::time_point now);
+
+private:
+    [[nodiscard]] bool HasFreeSlot() const;
+    [[nodiscard]] uint32_t Slot() const;
+
+    mutable std::mutex mutex{};
+    std::condition_variable completed{};
+    uint32_t limit{kDefaultLimit};
+    uint64_t submitted{0};
+    // When each frame in flight was submitted, oldest first
+    std::deque<Clock::time_point> submit_times{};
+
+    // Statistics for the current interval, in seconds
+    ReportTimer timer{};
+    uint32_t frames{0};
+    uint32_t throttled{0};
+    double wait_sum{0.0};
+    double worst_wait{0.0};
+    uint32_t completions{0};
+    double latency_sum{0.0};
+    double worst_latency{0.0};
+    size_t most_in_flight{0};
+};
+
+inline void FramesInFlight::Initialise(uint32_t frame_limit)
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    limit = std::clamp(frame_limit, 1U, kMaxLimit);
+}
+
+inline uint32_t FramesInFlight::Limit() const
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    return limit;
+}
+
+inline uint32_t FramesInFlight::Acquire(const Poll &poll)
+{
+    std::unique_lock<std::mutex> lock{mutex};
+    if (HasFreeSlot())
+    {
+        return Slot();
+    }
+
+    const ProfileZone profile_zone{"Wait for a frame slot"};
+    const Clock::time_point start{Clock::now()};
+    while (!HasFreeSlot())
+    {
+        // Callbacks may run inside the poll, and take the lock
+        lock.unlock();
+        poll();
+        lock.lock();
+        completed.wait_for(lock, kWaitSlice, [this]() {
+            return HasFreeSlot();
+        });
+    }
+    const double wait{
+        std::chrono::duration<double>{Clock::now() - start}.count()};
+    ++throttled;
+    wait_sum += wait;
+    worst_wait = std::max(worst_wait, wait);
+    return Slot();
+}
+
+inline std::optional<uint32_t> FramesInFlight::TryAcquire()
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    if (!HasFreeSlot())
+    {
+        ++throttled;
+        return std::nullopt;
+    }
+    return Slot();
+}
+
+inline void FramesInFlight::Submitted(Clock::time_point now)
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    ++submitted;
+    ++frames;
+    submit_times.push_back(now);
+    most_in_flight = std::max(most_in_flight, submit_times.size());
+}
+
+inline void FramesInFlight::Completed(Clock::time_point now)
+{
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        if (submit_times.empty())
+        {
+            return;
+        }
+        const double latency{
+            std::chrono::duration<double>{now - submit_times.front()}
+                .count()};
+        submit_times.pop_front();
+        ++completions;
+        latency_sum += latency;
+        worst_latency = std::max(worst_latency, latency);
+    }
+    completed.notify_all();
+}
+
+inline uint32_t FramesInFlight::InFlight() const
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    return static_cast<uint32_t>(submit_times.size());
+}
+
+inline std::optional<std::string> FramesInFlight::Sample(
+    Clock::time_point now)
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    const std::optional<ReportTimer::Seconds> elapsed{timer.Tick(now)};
+    if (!elapsed.has_value())
+    {
+        return std::nullopt;
+    }
+    if (frames == 0)
+    {
+        return std::nullopt;
+    }
+
+    constexpr double kMilliseconds{1000.0};
+    std::string report{fmt::format(
+        "Frames in flight (limit {}): {:.1f} frames/s, up to {} in flight, "
+        "{} throttled waiting {:.2f} ms on average, worst {:.2f} ms; submit "
+        "to GPU done mean {:.2f} ms, worst {:.2f} ms",
+        limit,
+        frames / elapsed.value().count(),
+        most_in_flight,
+        throttled,
+        kMilliseconds * wait_sum / std::max(throttled, 1U),
+        kMilliseconds * worst_wait,
+        kMilliseconds * latency_sum / std::max(completions, 1U),
+        kMilliseconds * worst_latency)};
+    frames = 0;
+    throttled = 0;
+    wait_sum = 0.0;
+    worst_wait = 0.0;
+    completions = 0;
+    latency_sum = 0.0;
+    worst_latency = 0.0;
+    most_in_flight = submit_times.size();
+    return report;
+}
+
+inline bool FramesInFlight::HasFreeSlot() const
+{
+    return submit_times.size() < limit;
+}
+
+inline uint32_t FramesInFlight::Slot() const
+{
+    return static_cast<uint32_t>(submitted % limit);
+}
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef SRC_UTILITIES_GPU_MEMORY_TRACKER_H
+#define SRC_UTILITIES_GPU_MEMORY_TRACKER_H
+
+#include "report_timer.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Where a GPU object was created
+struct GpuCallSite
+{
+    const char *file{""};
+    int line{0};
+};
+
+#define GPU_CALL_SITE (GpuCallSite{__FILE__, __LINE__})
+
+enum class GpuObjectCategory : uint8_t
+{
+    Buffer,
+    Texture,
+    BindGroup,
+    Pipeline,
+};
+
+inline constexpr size_t kGpuObjectCategoryCount{4};
+
+struct GpuAllocation
+{
+    std::string label{};
+    GpuObjectCategory category{GpuObjectCategory::Buffer};
+    uint64_t bytes{0};
+    uint32_t usage{0};
+    GpuCallSite call_site{};
+};
+
+// Live totals, indexed by GpuObjectCategory
+struct GpuMemoryTotals
+{
+    std::array<uint64_t, kGpuObjectCategoryCount> bytes{};
+    std::array<size_t, kGpuObjectCategoryCount> objects{};
+    uint64_t total_bytes{0};
+    // Largest `total_bytes` seen since start-up
+    uint64_t high_water_mark{0};
+};
+
+// Keeps account of the GPU objects the app holds, keyed by their handle.
+// Objects are tracked when created and untracked just before they are
+// released, so whatever is still tracked at shutdown has leaked.
+//
+// Sizes are what the app asked for: drivers may pad or place allocations in
+// ways this cannot see. Bind groups and pipelines are counted but have no
+// size. Safe to call from several threads, as pipelines are created off the
+// main thread.
+class GpuMemoryTracker
+{
+public:
+    void Track(const void *handle,
+               GpuObjectCategory category,
+               std::string_view label,
+               uint64_t bytes,
+               uint32_t usage,
+               GpuCallSite call_site);
+
+    // Forget an object that is about to be released. Unknown handles, such
+    // as those created before tracking started, are ignored.
+    void Untrack(const void *handle);
+
+    [[nodiscard]] GpuMemoryTotals Totals() const;
+
+    // Objects still alive, largest first
+    [[nodiscard]] std::vector<GpuAllocation> LiveObjects() const;
+
+    // Return true on the first call, then once per ReportTimer interval, for
+    // a periodic `Summary` log line
+    [[nodiscard]] bool IsSummaryDue(std::chrono::steady_clock::time_point now);
+
+    // One line of live totals by category and the high-water mark
+    [[nodiscard]] std::string Summary() const;
+
+    [[nodiscard]] static std::string Describe(const GpuAllocation &allocation);
+    [[nodiscard]] static std::string_view CategoryName(
+        GpuObjectCategory category);
+
+private:
+    using LiveObjectMap = std::unordered_map<const void *, GpuAllocation>;
+
+    // Drop an object from the totals. The caller holds `mutex`.
+    void Erase(LiveObjectMap::iterator object);
+
+    mutable std::mutex mutex{};
+    LiveObjectMap live{};
+    GpuMemoryTotals totals{};
+    ReportTimer summary_timer{};
+};
+
+inline void GpuMemoryTracker::Track(const void *handle,
+                                    GpuObjectCategory category,
+                                    std::string_view label,
+                                    uint64_t bytes,
+                                    uint32_t usage,
+                                    GpuCallSite call_site)
+{
+    if (handle == nullptr)
+    {
+        return;
+    }
+    const std::lock_guard<std::mutex> lock{mutex};
+    // A handle reused after an untracked release replaces the stale entry
+    const auto stale{live.find(handle)};
+    if (stale != live.end())
+    {
+        Erase(stale);
+    }
+
+    const auto index{static_cast<size_t>(category)};
+    totals.bytes.at(index) += bytes;
+    ++totals.objects.at(index);
+    totals.total_bytes += bytes;
+    totals.high_water_mark =
+        std::max(totals.high_water_mark, totals.total_bytes);
+    live.emplace(handle,
+                 GpuAllocation{
+                     std::string{label}, category, bytes, usage, call_site});
+}
+
+inline void GpuMemoryTracker::Untrack(const void *handle)
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    const auto found{live.find(handle)};
+    if (found != live.end())
+    {
+        Erase(found);
+    }
+}
+
+inline GpuMemoryTotals GpuMemoryTracker::Totals() const
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    return totals;
+}
+
+inline std::vector<GpuAllocation> GpuMemoryTracker::LiveObjects() const
+{
+    std::vector<GpuAllocation> objects{};
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        objects.reserve(live.size());
+        for (const auto &[handle, allocation] : live)
+        {
+            objects.push_back(allocation);
+        }
+    }
+    std::sort(objects.begin(),
+              objects.end(),
+              [](const GpuAllocation &left, const GpuAllocation &right) {
+                  return std::tie(right.bytes, left.label) <
+                         std::tie(left.bytes, right.label);
+              });
+    return objects;
+}
+
+inline bool GpuMemoryTracker::IsSummaryDue(
+    std::chrono::steady_clock::time_point now)
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    const bool first{!summary_timer.IsRunning()};
+    return summary_timer.Tick(now).has_value() || first;
+}
+
+inline std::string GpuMemoryTracker::Summary() const
+{
+    const GpuMemoryTotals current{Totals()};
+    std::string summary{"GPU memory:"};
+    for (size_t index{0}; index < kGpuObjectCategoryCount; ++index)
+    {
+        fmt::format_to(std::back_inserter(summary),
+                       " {} {} ({} bytes),",
+                       current.objects.at(index),
+                       CategoryName(static_cast<GpuObjectCategory>(index)),
+                       current.bytes.at(index));
+    }
+    fmt::format_to(std::back_inserter(summary),
+                   " {} bytes in total, peak {} bytes",
+                   current.total_bytes,
+                   current.high_water_mark);
+    return summary;
+}
+
+inline std::string GpuMemoryTracker::Describe(const GpuAllocation &allocation)
+{
+    return fmt::format(
+        "`{}` [{}] {} bytes, usage {:#x}, created at {}:{}",
+        allocation.label,
+        CategoryName(allocation.category),
+        allocation.bytes,
+        allocation.usage,
+        std::filesystem::path{allocation.call_site.file}.filename().string(),
+        allocation.call_site.line);
+}
+
+inline void GpuMemoryTracker::Erase(LiveObjectMap::iterator object)
+{
+    const auto index{static_cast<size_t>(object->second.category)};
+    totals.bytes.at(index) -= object->second.bytes;
+    --totals.objects.at(index);
+    totals.total_bytes -= object->second.bytes;
+    live.erase(object);
+}
+
+inline std::string_view GpuMemoryTracker::CategoryName(
+    GpuObjectCategory category)
+{
+    switch (category)
+    {
+    case GpuObjectCategory::Buffer:
+        return "buffers";
+    case GpuObjectCategory::Texture:
+        return "textures";
+    case GpuObjectCategory::BindGroup:
+        return "bind groups";
+    case GpuObjectCategory::Pipeline:
+        return "pipelines";
+    }
+    return "unknown";
+}
+
+#endif
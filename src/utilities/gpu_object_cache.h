@@ -0,0 +1,652 @@
+#ifndef SRC_UTILITIES_GPU_OBJECT_CACHE_H
+#define SRC_UTILITIES_GPU_OBJECT_CACHE_H
+
+#include "gpu_memory_tracker.h"
+#include "object_cache.h"
+
+#include <webgpu/webgpu.h>
+#include <webgpu/webgpu.hpp>
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Deduplicates bind group layouts, pipeline layouts, render pipelines and bind
+// groups by the contents of their descriptors, so asking twice for the same
+// object returns the first one rather than creating (and, for pipelines,
+// compiling) another. Labels are not part of the key: the first label wins.
+//
+// Objects named in a descriptor are part of its key by handle, so a cached
+// object keeps a reference to each of them. That stops a released handle
+// being reused at the same address and matching a stale key. Descriptors with
+// chained extension structs are not understood, so are created uncached.
+//
+// Every `Get` must be paired with a `Release`. Bind groups and pipelines are
+// accounted for in the GPU memory tracker from creation until eviction.
+class GpuObjectCache
+{
+public:
+    enum class Kind : uint8_t
+    {
+        BindGroupLayout,
+        PipelineLayout,
+        RenderPipeline,
+        BindGroup,
+    };
+    static constexpr size_t kKindCount{4};
+
+    void Initialise(wgpu::Device cache_device, GpuMemoryTracker &tracker);
+    // Destroy every cached object. Call once the app has released its own
+    // references.
+    void Terminate();
+
+    [[nodiscard]] wgpu::BindGroupLayout GetBindGroupLayout(
+        const wgpu::BindGroupLayoutDescriptor &descriptor);
+    [[nodiscard]] wgpu::PipelineLayout GetPipelineLayout(
+        const wgpu::PipelineLayoutDescriptor &descriptor);
+    // Safe to call from worker threads
+    [[nodiscard]] wgpu::RenderPipeline GetRenderPipeline(
+        const wgpu::RenderPipelineDescriptor &descriptor,
+        GpuCallSite call_site);
+    [[nodiscard]] wgpu::BindGroup GetBindGroup(
+        const wgpu::BindGroupDescriptor &descriptor,
+        GpuCallSite call_site);
+
+    void Release(wgpu::BindGroupLayout bind_group_layout);
+    void Release(wgpu::PipelineLayout pipeline_layout);
+    void Release(wgpu::RenderPipeline render_pipeline);
+    void Release(wgpu::BindGroup bind_group);
+
+    [[nodiscard]] ObjectCacheStats Stats(Kind kind) const;
+    // One line of requests, hit rate and creation calls by kind
+    [[nodiscard]] std::string Summary() const;
+
+    // Keys for each descriptor, or nothing when it has chained structs
+    [[nodiscard]] static std::optional<ObjectKey> KeyFor(
+        const WGPUBindGroupLayoutDescriptor &descriptor);
+    [[nodiscard]] static std::optional<ObjectKey> KeyFor(
+        const WGPUPipelineLayoutDescriptor &descriptor);
+    [[nodiscard]] static std::optional<ObjectKey> KeyFor(
+        const WGPURenderPipelineDescriptor &descriptor);
+    [[nodiscard]] static std::optional<ObjectKey> KeyFor(
+        const WGPUBindGroupDescriptor &descriptor);
+
+    [[nodiscard]] static std::string_view KindName(Kind kind);
+
+private:
+    // The objects a cached object's key names, referenced for as long as it
+    // stays cached
+    class RetainedObjects
+    {
+    public:
+        void Add(WGPUBindGroupLayout object);
+        void Add(WGPUPipelineLayout object);
+        void Add(WGPUShaderModule object);
+        void Add(WGPUBuffer object);
+        void Add(WGPUSampler object);
+        void Add(WGPUTextureView object);
+        void Reference() const;
+        void Release() const;
+
+    private:
+        std::vector<std::function<void()>> references{};
+        std::vector<std::function<void()>> releases{};
+    };
+
+    // Untrack and release an object the cache created
+    template <typename Handle>
+    void Destroy(Handle handle);
+    // Return the cached object for `key`, or a fresh uncached one when there
+    // is no key
+    template <typename Handle, typename Create>
+    [[nodiscard]] Handle Acquire(DeduplicatingCache<Handle> &cache,
+                                 const std::optional<ObjectKey> &key,
+                                 const Create &create,
+                                 const RetainedObjects &retained);
+    void Track(const void *handle,
+               GpuObjectCategory category,
+               const char *label,
+               GpuCallSite call_site);
+
+    static void AddStage(ObjectKey &key,
+                         WGPUShaderModule module,
+                         const char *entry_point,
+                         size_t constant_count,
+                         const WGPUConstantEntry *constants);
+
+    std::optional<wgpu::Device> device{std::nullopt};
+    GpuMemoryTracker *gpu_memory{nullptr};
+    DeduplicatingCache<wgpu::BindGroupLayout> bind_group_layouts{};
+    DeduplicatingCache<wgpu::PipelineLayout> pipeline_layouts{};
+    DeduplicatingCache<wgpu::RenderPipeline> render_pipelines{};
+    DeduplicatingCache<wgpu::BindGroup> bind_groups{};
+};
+
+inline void GpuObjectCache::Initialise(wgpu::Device cache_device,
+                                       GpuMemoryTracker &tracker)
+{
+    device = cache_device;
+    gpu_memory = &tracker;
+}
+
+inline void GpuObjectCache::Terminate()
+{
+    // Dependants first, so nothing outlives what it refers to
+    bind_groups.Clear();
+    render_pipelines.Clear();
+    pipeline_layouts.Clear();
+    bind_group_layouts.Clear();
+}
+
+inline wgpu::BindGroupLayout GpuObjectCache::GetBindGroupLayout(
+    const wgpu::BindGroupLayoutDescriptor &descriptor)
+{
+    return Acquire(
+        bind_group_layouts,
+        KeyFor(descriptor),
+        [this, &descriptor]() {
+            // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+            return device.value().createBindGroupLayout(descriptor);
+        },
+        RetainedObjects{});
+}
+
+inline wgpu::PipelineLayout GpuObjectCache::GetPipelineLayout(
+    const wgpu::PipelineLayoutDescriptor &descriptor)
+{
+    RetainedObjects retained{};
+    for (size_t index{0}; index < descriptor.bindGroupLayoutCount; ++index)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        retained.Add(descriptor.bindGroupLayouts[index]);
+    }
+    return Acquire(
+        pipeline_layouts,
+        KeyFor(descriptor),
+        [this, &descriptor]() {
+            // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+            return device.value().createPipelineLayout(descriptor);
+        },
+        retained);
+}
+
+inline wgpu::RenderPipeline GpuObjectCache::GetRenderPipeline(
+    const wgpu::RenderPipelineDescriptor &descriptor,
+    GpuCallSite call_site)
+{
+    RetainedObjects retained{};
+    retained.Add(descriptor.layout);
+    retained.Add(descriptor.vertex.module);
+    if (descriptor.fragment != nullptr)
+    {
+        retained.Add(descriptor.fragment->module);
+    }
+    return Acquire(
+        render_pipelines,
+        KeyFor(descriptor),
+        [this, &descriptor, call_site]() {
+            const wgpu::RenderPipeline render_pipeline{
+                // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+                device.value().createRenderPipeline(descriptor)};
+            Track(render_pipeline,
+                  GpuObjectCategory::Pipeline,
+                  descriptor.label,
+                  call_site);
+            return render_pipeline;
+        },
+        retained);
+}
+
+inline wgpu::BindGroup GpuObjectCache::GetBindGroup(
+    const wgpu::BindGroupDescriptor &descriptor,
+    GpuCallSite call_site)
+{
+    RetainedObjects retained{};
+    retained.Add(descriptor.layout);
+    for (size_t index{0}; index < descriptor.entryCount; ++index)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const WGPUBindGroupEntry &entry{descriptor.entries[index]};
+        retained.Add(entry.buffer);
+        retained.Add(entry.sampler);
+        retained.Add(entry.textureView);
+    }
+    return Acquire(
+        bind_groups,
+        KeyFor(descriptor),
+        [this, &descriptor, call_site]() {
+            const wgpu::BindGroup bind_group{
+                // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+                device.value().createBindGroup(descriptor)};
+            Track(bind_group,
+                  GpuObjectCategory::BindGroup,
+                  descriptor.label,
+                  call_site);
+            return bind_group;
+        },
+        retained);
+}
+
+inline void GpuObjectCache::Release(wgpu::BindGroupLayout bind_group_layout)
+{
+    if (!bind_group_layouts.Release(bind_group_layout))
+    {
+        Destroy(bind_group_layout);
+    }
+}
+
+inline void GpuObjectCache::Release(wgpu::PipelineLayout pipeline_layout)
+{
+    if (!pipeline_layouts.Release(pipeline_layout))
+    {
+        Destroy(pipeline_layout);
+    }
+}
+
+inline void GpuObjectCache::Release(wgpu::RenderPipeline render_pipeline)
+{
+    if (!render_pipelines.Release(render_pipeline))
+    {
+        Destroy(render_pipeline);
+    }
+}
+
+inline void GpuObjectCache::Release(wgpu::BindGroup bind_group)
+{
+    if (!bind_groups.Release(bind_group))
+    {
+        Destroy(bind_group);
+    }
+}
+
+inline ObjectCacheStats GpuObjectCache::Stats(Kind kind) const
+{
+    switch (kind)
+    {
+    case Kind::BindGroupLayout:
+        return bind_group_layouts.Stats();
+    case Kind::PipelineLayout:
+        return pipeline_layouts.Stats();
+    case Kind::RenderPipeline:
+        return render_pipelines.Stats();
+    case Kind::BindGroup:
+        return bind_groups.Stats();
+    }
+    return {};
+}
+
+inline std::string GpuObjectCache::Summary() const
+{
+    constexpr double kPercent{100.0};
+    std::string summary{"Object cache:"};
+    for (size_t index{0}; index < kKindCount; ++index)
+    {
+        const auto kind{static_cast<Kind>(index)};
+        const ObjectCacheStats stats{Stats(kind)};
+        fmt::format_to(std::back_inserter(summary),
+                       "{} {} {} requests ({:.0f}% hits, {} created, {} "
+                       "evicted, {} in use, {} idle)",
+                       index == 0 ? "" : ";",
+                       KindName(kind),
+                       stats.requests,
+                       kPercent * stats.HitRate(),
+                       stats.creations,
+                       stats.evictions,
+                       stats.referenced,
+                       stats.unreferenced);
+    }
+    return summary;
+}
+
+inline std::optional<ObjectKey> GpuObjectCache::KeyFor(
+    const WGPUBindGroupLayoutDescriptor &descriptor)
+{
+    if (descriptor.nextInChain != nullptr)
+    {
+        return std::nullopt;
+    }
+    ObjectKey key{};
+    key.Add(static_cast<uint64_t>(descriptor.entryCount));
+    for (size_t index{0}; index < descriptor.entryCount; ++index)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const WGPUBindGroupLayoutEntry &entry{descriptor.entries[index]};
+        if (entry.nextInChain != nullptr ||
+            entry.buffer.nextInChain != nullptr ||
+            entry.sampler.nextInChain != nullptr ||
+            entry.texture.nextInChain != nullptr ||
+            entry.storageTexture.nextInChain != nullptr)
+        {
+            return std::nullopt;
+        }
+        key.Add(entry.binding)
+            .Add(entry.visibility)
+            .Add(entry.buffer.type)
+            .Add(entry.buffer.hasDynamicOffset)
+            .Add(entry.buffer.minBindingSize)
+            .Add(entry.sampler.type)
+            .Add(entry.texture.sampleType)
+            .Add(entry.texture.viewDimension)
+            .Add(entry.texture.multisampled)
+            .Add(entry.storageTexture.access)
+            .Add(entry.storageTexture.format)
+            .Add(entry.storageTexture.viewDimension);
+    }
+    return key;
+}
+
+inline std::optional<ObjectKey> GpuObjectCache::KeyFor(
+    const WGPUPipelineLayoutDescriptor &descriptor)
+{
+    if (descriptor.nextInChain != nullptr)
+    {
+        return std::nullopt;
+    }
+    ObjectKey key{};
+    key.Add(static_cast<uint64_t>(descriptor.bindGroupLayoutCount));
+    for (size_t index{0}; index < descriptor.bindGroupLayoutCount; ++index)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        key.Add(descriptor.bindGroupLayouts[index]);
+    }
+    return key;
+}
+
+inline std::optional<ObjectKey> GpuObjectCache::KeyFor(
+    const WGPURenderPipelineDescriptor &descriptor)
+{
+    const WGPUFragmentState *fragment{descriptor.fragment};
+    const WGPUDepthStencilState *depth_stencil{descriptor.depthStencil};
+    if (descriptor.nextInChain != nullptr ||
+        descriptor.vertex.nextInChain != nullptr ||
+        descriptor.primitive.nextInChain != nullptr ||
+        descriptor.multisample.nextInChain != nullptr ||
+        (fragment != nullptr && fragment->nextInChain != nullptr) ||
+        (depth_stencil != nullptr && depth_stencil->nextInChain != nullptr))
+    {
+        return std::nullopt;
+    }
+
+    ObjectKey key{};
+    key.Add(descriptor.layout);
+
+    const WGPUVertexState &vertex{descriptor.vertex};
+    AddStage(key,
+             vertex.module,
+             vertex.entryPoint,
+             vertex.constantCount,
+             vertex.constants);
+    key.Add(static_cast<uint64_t>(vertex.bufferCount));
+    for (size_t index{0}; index < vertex.bufferCount; ++index)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const WGPUVertexBufferLayout &buffer{vertex.buffers[index]};
+        key.Add(buffer.arrayStride)
+            .Add(buffer.stepMode)
+            .Add(static_cast<uint64_t>(buffer.attributeCount));
+        for (size_t attribute_index{0};
+             attribute_index < buffer.attributeCount;
+             ++attribute_index)
+        {
+            const WGPUVertexAttribute &attribute{
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                buffer.attributes[attribute_index]};
+            key.Add(attribute.format)
+                .Add(attribute.offset)
+                .Add(attribute.shaderLocation);
+        }
+    }
+
+    key.Add(descriptor.primitive.topology)
+        .Add(descriptor.primitive.stripIndexFormat)
+        .Add(descriptor.primitive.frontFace)
+        .Add(descriptor.primitive.cullMode);
+
+    key.Add(depth_stencil != nullptr);
+    if (depth_stencil != nullptr)
+    {
+        key.Add(depth_stencil->format)
+            .Add(depth_stencil->depthWriteEnabled)
+            .Add(depth_stencil->depthCompare);
+        for (const WGPUStencilFaceState &face :
+             {depth_stencil->stencilFront, depth_stencil->stencilBack})
+        {
+            key.Add(face.compare)
+                .Add(face.failOp)
+                .Add(face.depthFailOp)
+                .Add(face.passOp);
+        }
+        key.Add(depth_stencil->stencilReadMask)
+            .Add(depth_stencil->stencilWriteMask)
+            .Add(depth_stencil->depthBias)
+            .Add(depth_stencil->depthBiasSlopeScale)
+            .Add(depth_stencil->depthBiasClamp);
+    }
+
+    key.Add(descriptor.multisample.count)
+        .Add(descriptor.multisample.mask)
+        .Add(descriptor.multisample.alphaToCoverageEnabled);
+
+    key.Add(fragment != nullptr);
+    if (fragment != nullptr)
+    {
+        AddStage(key,
+                 fragment->module,
+                 fragment->entryPoint,
+                 fragment->constantCount,
+                 fragment->constants);
+        key.Add(static_cast<uint64_t>(fragment->targetCount));
+        for (size_t index{0}; index < fragment->targetCount; ++index)
+        {
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+            const WGPUColorTargetState &target{fragment->targets[index]};
+            if (target.nextInChain != nullptr)
+            {
+                return std::nullopt;
+            }
+            key.Add(target.format)
+                .Add(target.writeMask)
+                .Add(target.blend != nullptr);
+            if (target.blend != nullptr)
+            {
+                for (const WGPUBlendComponent &component :
+                     {target.blend->color, target.blend->alpha})
+                {
+                    key.Add(component.operation)
+                        .Add(component.srcFactor)
+                        .Add(component.dstFactor);
+                }
+            }
+        }
+    }
+    return key;
+}
+
+inline std::optional<ObjectKey> GpuObjectCache::KeyFor(
+    const WGPUBindGroupDescriptor &descriptor)
+{
+    if (descriptor.nextInChain != nullptr)
+    {
+        return std::nullopt;
+    }
+    ObjectKey key{};
+    key.Add(descriptor.layout)
+        .Add(static_cast<uint64_t>(descriptor.entryCount));
+    for (size_t index{0}; index < descriptor.entryCount; ++index)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const WGPUBindGroupEntry &entry{descriptor.entries[index]};
+        if (entry.nextInChain != nullptr)
+        {
+            return std::nullopt;
+        }
+        key.Add(entry.binding)
+            .Add(entry.buffer)
+            .Add(entry.offset)
+            .Add(entry.size)
+            .Add(entry.sampler)
+            .Add(entry.textureView);
+    }
+    return key;
+}
+
+inline std::string_view GpuObjectCache::KindName(Kind kind)
+{
+    switch (kind)
+    {
+    case Kind::BindGroupLayout:
+        return "bind group layouts";
+    case Kind::PipelineLayout:
+        return "pipeline layouts";
+    case Kind::RenderPipeline:
+        return "render pipelines";
+    case Kind::BindGroup:
+        return "bind groups";
+    }
+    return "unknown";
+}
+
+inline void GpuObjectCache::RetainedObjects::Add(WGPUBindGroupLayout object)
+{
+    if (object != nullptr)
+    {
+        references.emplace_back(
+            [object]() { wgpuBindGroupLayoutReference(object); });
+        releases.emplace_back(
+            [object]() { wgpuBindGroupLayoutRelease(object); });
+    }
+}
+
+inline void GpuObjectCache::RetainedObjects::Add(WGPUPipelineLayout object)
+{
+    if (object != nullptr)
+    {
+        references.emplace_back(
+            [object]() { wgpuPipelineLayoutReference(object); });
+        releases.emplace_back(
+            [object]() { wgpuPipelineLayoutRelease(object); });
+    }
+}
+
+inline void GpuObjectCache::RetainedObjects::Add(WGPUShaderModule object)
+{
+    if (object != nullptr)
+    {
+        references.emplace_back(
+            [object]() { wgpuShaderModuleReference(object); });
+        releases.emplace_back([object]() { wgpuShaderModuleRelease(object); });
+    }
+}
+
+inline void GpuObjectCache::RetainedObjects::Add(WGPUBuffer object)
+{
+    if (object != nullptr)
+    {
+        references.emplace_back([object]() { wgpuBufferReference(object); });
+        releases.emplace_back([object]() { wgpuBufferRelease(object); });
+    }
+}
+
+inline void GpuObjectCache::RetainedObjects::Add(WGPUSampler object)
+{
+    if (object != nullptr)
+    {
+        references.emplace_back([object]() { wgpuSamplerReference(object); });
+        releases.emplace_back([object]() { wgpuSamplerRelease(object); });
+    }
+}
+
+inline void GpuObjectCache::RetainedObjects::Add(WGPUTextureView object)
+{
+    if (object != nullptr)
+    {
+        references.emplace_back(
+            [object]() { wgpuTextureViewReference(object); });
+        releases.emplace_back([object]() { wgpuTextureViewRelease(object); });
+    }
+}
+
+inline void GpuObjectCache::RetainedObjects::Reference() const
+{
+    for (const std::function<void()> &reference : references)
+    {
+        reference();
+    }
+}
+
+inline void GpuObjectCache::RetainedObjects::Release() const
+{
+    for (const std::function<void()> &release : releases)
+    {
+        release();
+    }
+}
+
+template <typename Handle>
+void GpuObjectCache::Destroy(Handle handle)
+{
+    if (gpu_memory != nullptr)
+    {
+        gpu_memory->Untrack(handle);
+    }
+    handle.release();
+}
+
+template <typename Handle, typename Create>
+Handle GpuObjectCache::Acquire(DeduplicatingCache<Handle> &cache,
+                               const std::optional<ObjectKey> &key,
+                               const Create &create,
+                               const RetainedObjects &retained)
+{
+    if (!key.has_value())
+    {
+        return create();
+    }
+    return cache.Acquire(key.value(), [this, &create, retained]() {
+        const Handle handle{create()};
+        retained.Reference();
+        return typename DeduplicatingCache<Handle>::Created{
+            handle, [this, handle, retained]() {
+                Destroy(handle);
+                retained.Release();
+            }};
+    });
+}
+
+inline void GpuObjectCache::Track(const void *handle,
+                                  GpuObjectCategory category,
+                                  const char *label,
+                                  GpuCallSite call_site)
+{
+    if (gpu_memory != nullptr)
+    {
+        gpu_memory->Track(
+            handle, category, label != nullptr ? label : "", 0, 0, call_site);
+    }
+}
+
+inline void GpuObjectCache::AddStage(ObjectKey &key,
+                                     WGPUShaderModule module,
+                                     const char *entry_point,
+                                     size_t constant_count,
+                                     const WGPUConstantEntry *constants)
+{
+    key.Add(module).AddString(entry_point).Add(
+        static_cast<uint64_t>(constant_count));
+    for (size_t index{0}; index < constant_count; ++index)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        const WGPUConstantEntry &constant{constants[index]};
+        key.AddString(constant.key).Add(constant.value);
+    }
+}
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef SRC_UTILITIES_IMAGE_DECODER_H
+#define SRC_UTILITIES_IMAGE_DECODER_H
+
+#include "resource_pack.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Pixel layouts an image can hold. The compressed ones all use 4x4 blocks of
+// 16 bytes.
+enum class ImageFormat : uint8_t
+{
+    Rgba8,
+    Bc7,
+    Etc2,
+    Astc4x4,
+};
+
+// Decoded (or pre-compressed) pixel data, ready to be uploaded. Each entry in
+// `levels` holds one tightly packed mip level.
+struct ImageData
+{
+    uint32_t width{};
+    uint32_t height{};
+    ImageFormat format{ImageFormat::Rgba8};
+    std::vector<std::vector<uint8_t>> levels;
+};
+
+enum class ImageDecodeError : uint8_t
+{
+    None,
+    BadMagic,
+    UnsupportedFormat,
+    MalformedHeader,
+    BadSize,
+    Truncated,
+};
+
+// Decodes images on the CPU, without touching the GPU, so that it can run on
+// any thread.
+//
+// The decoders reject images that are empty or wider or taller than
+// `max_dimension`, and headers that promise more data than the blob holds,
+// before allocating anything for the pixels.
+class ImageDecoder
+{
+public:
+    // WebGPU's default `maxTextureDimension2D`, which every device supports
+    static constexpr uint32_t kDefaultMaxDimension{8'192};
+    static constexpr uint32_t kBlockDimension{4};
+    static constexpr uint32_t kBytesPerBlock{16};
+    static constexpr uint32_t kBytesPerRgba8Texel{4};
+
+    // Binary PPM (P6) with 8-bit channels, expanded to RGBA8
+    [[nodiscard]] static std::optional<ImageData> DecodePpm(
+        const ResourceBlob &blob,
+        ImageDecodeError &error,
+        uint32_t max_dimension = kDefaultMaxDimension);
+
+    // `.ctex` layout: the magic `CTEX`, then little-endian u32 format id,
+    // width, height and level count, then for each level a u32 byte count
+    // followed by that many bytes of block data. Format ids 0, 1 and 2 are
+    // BC7, ETC2 and ASTC 4x4.
+    [[nodiscard]] static std::optional<ImageData> DecodeCompressed(
+        const ResourceBlob &blob,
+        ImageDecodeError &error,
+        uint32_t max_dimension = kDefaultMaxDimension);
+
+    // Levels in a full mip chain, down to 1x1
+    [[nodiscard]] static uint32_t MipLevelCount(uint32_t width,
+                                                uint32_t height);
+
+    [[nodiscard]] static std::string_view Describe(ImageDecodeError error);
+
+private:
+    static constexpr std::array<char, 4> kCompressedMagic{'C', 'T', 'E', 'X'};
+    // Indexed by `.ctex` format id
+    static constexpr std::array<ImageFormat, 3> kCompressedFormats{
+        ImageFormat::Bc7, ImageFormat::Etc2, ImageFormat::Astc4x4};
+
+    [[nodiscard]] static bool IsValidSize(uint32_t width,
+                                          uint32_t height,
+                                          uint32_t max_dimension);
+};
+
+inline std::optional<ImageData> ImageDecoder::DecodePpm(
+    const ResourceBlob &blob,
+    ImageDecodeError &error,
+    uint32_t max_dimension)
+{
+    ResourceBlobStreamBuffer buffer{blob};
+    std::istream file{&buffer};
+
+    // Header fields are whitespace separated and may be interleaved with
+    // comment lines
+    auto read_header_field{[&file]() -> std::string {
+        std::string field;
+        while (file >> field)
+        {
+            if (field[0] != '#')
+            {
+                return field;
+            }
+            std::string comment;
+            std::getline(file, comment);
+        }
+        return {};
+    }};
+
+    if (read_header_field() != "P6")
+    {
+        error = ImageDecodeError::BadMagic;
+        return std::nullopt;
+    }
+    ImageData image{};
+    try
+    {
+        image.width = static_cast<uint32_t>(std::stoul(read_header_field()));
+        image.height = static_cast<uint32_t>(std::stoul(read_header_field()));
+        if (std::stoul(read_header_field()) != 255)
+        {
+            error = ImageDecodeError::UnsupportedFormat;
+            return std::nullopt;
+        }
+    }
+    catch (const std::exception &)
+    {
+        error = ImageDecodeError::MalformedHeader;
+        return std::nullopt;
+    }
+    if (!IsValidSize(image.width, image.height, max_dimension))
+    {
+        error = ImageDecodeError::BadSize;
+        return std::nullopt;
+    }
+    // A single whitespace character separates the header from the pixels
+    file.get();
+
+    constexpr size_t kBytesPerRgb8Texel{3};
+    const size_t texel_count{static_cast<size_t>(image.width) * image.height};
+    if (texel_count * kBytesPerRgb8Texel >
+        static_cast<size_t>(buffer.in_avail()))
+    {
+        error = ImageDecodeError::Truncated;
+        return std::nullopt;
+    }
+    std::vector<uint8_t> rgb(texel_count * kBytesPerRgb8Texel);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file.read(reinterpret_cast<char *>(rgb.data()),
+              static_cast<std::streamsize>(rgb.size()));
+    if (!file)
+    {
+        error = ImageDecodeError::Truncated;
+        return std::nullopt;
+    }
+
+    std::vector<uint8_t> rgba(texel_count * kBytesPerRgba8Texel);
+    for (size_t texel{0}; texel < texel_count; ++texel)
+    {
+        rgba[texel * kBytesPerRgba8Texel] = rgb[texel * kBytesPerRgb8Texel];
+        rgba[texel * kBytesPerRgba8Texel + 1] =
+            rgb[texel * kBytesPerRgb8Texel + 1];
+        rgba[texel * kBytesPerRgba8Texel + 2] =
+            rgb[texel * kBytesPerRgb8Texel + 2];
+        rgba[texel * kBytesPerRgba8Texel + 3] = UINT8_MAX;
+    }
+    image.levels.push_back(std::move(rgba));
+
+    error = ImageDecodeError::None;
+    return image;
+}
+
+inline std::optional<ImageData> ImageDecoder::DecodeCompressed(
+    const ResourceBlob &blob,
+    ImageDecodeError &error,
+    uint32_t max_dimension)
+{
+    ResourceBlobStreamBuffer buffer{blob};
+    std::istream file{&buffer};
+
+    auto read_u32{[&file]() -> uint32_t {
+        std::array<uint8_t, 4> bytes{};
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        file.read(reinterpret_cast<char *>(bytes.data()),
+                  static_cast<std::streamsize>(bytes.size()));
+        return static_cast<uint32_t>(bytes[0]) |
+               (static_cast<uint32_t>(bytes[1]) << 8U) |
+               (static_cast<uint32_t>(bytes[2]) << 16U) |
+               (static_cast<uint32_t>(bytes[3]) << 24U);
+    }};
+
+    std::array<char, 4> magic{};
+    file.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+    if (!file || magic != kCompressedMagic)
+    {
+        error = ImageDecodeError::BadMagic;
+        return std::nullopt;
+    }
+
+    const uint32_t format_id{read_u32()};
+    if (format_id >= kCompressedFormats.size())
+    {
+        error = ImageDecodeError::UnsupportedFormat;
+        return std::nullopt;
+    }
+
+    ImageData image{};
+    image.format = kCompressedFormats.at(format_id);
+    image.width = read_u32();
+    image.height = read_u32();
+    const uint32_t level_count{read_u32()};
+    if (!file)
+    {
+        error = ImageDecodeError::Truncated;
+        return std::nullopt;
+    }
+    if (!IsValidSize(image.width, image.height, max_dimension))
+    {
+        error = ImageDecodeError::BadSize;
+        return std::nullopt;
+    }
+    if (image.width % kBlockDimension != 0 ||
+        image.height % kBlockDimension != 0 || level_count == 0 ||
+        level_count > MipLevelCount(image.width, image.height))
+    {
+        error = ImageDecodeError::MalformedHeader;
+        return std::nullopt;
+    }
+
+    for (uint32_t level{0}; level < level_count; ++level)
+    {
+        // Bounded by what is left, so a corrupt count cannot exhaust memory
+        const uint32_t level_size{read_u32()};
+        if (!file || level_size > static_cast<size_t>(buffer.in_avail()))
+        {
+            error = ImageDecodeError::Truncated;
+            return std::nullopt;
+        }
+        std::vector<uint8_t> data(level_size);
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+        file.read(reinterpret_cast<char *>(data.data()),
+                  static_cast<std::streamsize>(data.size()));
+        image.levels.push_back(std::move(data));
+    }
+
+    error = ImageDecodeError::None;
+    return image;
+}
+
+inline uint32_t ImageDecoder::MipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t largest_dimension{std::max(width, height)};
+    uint32_t level_count{1};
+    while (largest_dimension > 1)
+    {
+        largest_dimension /= 2;
+        ++level_count;
+    }
+    return level_count;
+}
+
+inline std::string_view ImageDecoder::Describe(ImageDecodeError error)
+{
+    switch (error)
+    {
+    case ImageDecodeError::None:
+        return "no error";
+    case ImageDecodeError::BadMagic:
+        return "not an image of the expected kind";
+    case ImageDecodeError::UnsupportedFormat:
+        return "unsupported pixel format";
+    case ImageDecodeError::MalformedHeader:
+        return "malformed header";
+    case ImageDecodeError::BadSize:
+        return "empty or larger than the device supports";
+    case ImageDecodeError::Truncated:
+        return "unexpected end of data";
+    }
+    return "unknown error";
+}
+
+inline bool ImageDecoder::IsValidSize(uint32_t width,
+                                      uint32_t height,
+                                      uint32_t max_dimension)
+{
+    return width != 0 && height != 0 && width <= max_dimension &&
+           height <= max_dimension;
+}
+
+#endif
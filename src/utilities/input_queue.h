@@ -0,0 +1,157 @@
+#ifndef SRC_UTILITIES_INPUT_QUEUE_H
+#define SRC_UTILITIES_INPUT_QUEUE_H
+
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+enum class InputKind : uint8_t
+{
+    Key,
+    MouseButton,
+    Scroll,
+    // The window system lost the window's contents
+    Refresh,
+};
+
+struct InputEvent
+{
+    InputKind kind{InputKind::Key};
+    // GLFW key or mouse button, action and modifier bits
+    int code{0};
+    int action{0};
+    int mods{0};
+    // Scroll offsets
+    double x{0.0};
+    double y{0.0};
+    // When the window system handed the event over, for measuring latency
+    std::chrono::steady_clock::time_point received{};
+};
+
+// Hands window events from the thread pumping them to the thread drawing.
+// Events go through a lock-free queue, and are dropped and counted if it is
+// full. The framebuffer size and requests to close are held apart, latest
+// wins, so they are never lost. The drawing thread can sleep until anything
+// arrives.
+class InputQueue
+{
+public:
+    using Size = std::pair<int, int>;
+
+    static constexpr size_t kCapacity{256};
+
+    // Pumping thread
+    void Push(const InputEvent &event);
+    void Resize(int width, int height);
+    void RequestClose();
+
+    // Drawing thread
+    [[nodiscard]] std::optional<InputEvent> Pop();
+    // The framebuffer size, if it changed since last taken
+    [[nodiscard]] std::optional<Size> TakeResize();
+    [[nodiscard]] bool IsCloseRequested() const;
+    // True if an event, a resize or a request to close is waiting
+    [[nodiscard]] bool HasPending() const;
+    // Sleep until something is pending or `timeout` has passed
+    void WaitFor(std::chrono::duration<double> timeout);
+
+    [[nodiscard]] uint64_t Dropped() const;
+
+private:
+    void Wake();
+
+    SpscQueue<InputEvent, kCapacity> events{};
+    // Width in the high half and height in the low half
+    std::atomic<uint64_t> size{0};
+    std::atomic<bool> resized{false};
+    std::atomic<bool> close_requested{false};
+    std::atomic<uint64_t> dropped{0};
+    // Only for sleeping: the queue itself takes no lock
+    std::mutex wake_mutex{};
+    std::condition_variable wake{};
+};
+
+inline void InputQueue::Push(const InputEvent &event)
+{
+    if (!events.Push(event))
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Wake();
+}
+
+inline void InputQueue::Resize(int width, int height)
+{
+    constexpr unsigned kHalf{32};
+    size.store(uint64_t{static_cast<uint32_t>(width)} << kHalf |
+                   static_cast<uint32_t>(height),
+               std::memory_order_relaxed);
+    resized.store(true, std::memory_order_release);
+    Wake();
+}
+
+inline void InputQueue::RequestClose()
+{
+    close_requested.store(true, std::memory_order_release);
+    Wake();
+}
+
+inline std::optional<InputEvent> InputQueue::Pop()
+{
+    return events.Pop();
+}
+
+inline std::optional<InputQueue::Size> InputQueue::TakeResize()
+{
+    if (!resized.exchange(false, std::memory_order_acquire))
+    {
+        return std::nullopt;
+    }
+    constexpr unsigned kHalf{32};
+    const uint64_t packed{size.load(std::memory_order_relaxed)};
+    return Size{static_cast<int>(static_cast<uint32_t>(packed >> kHalf)),
+                static_cast<int>(static_cast<uint32_t>(packed))};
+}
+
+inline bool InputQueue::IsCloseRequested() const
+{
+    return close_requested.load(std::memory_order_acquire);
+}
+
+inline bool InputQueue::HasPending() const
+{
+    return !events.Empty() || resized.load(std::memory_order_acquire) ||
+           IsCloseRequested();
+}
+
+inline void InputQueue::WaitFor(std::chrono::duration<double> timeout)
+{
+    std::unique_lock<std::mutex> lock{wake_mutex};
+    wake.wait_for(lock, timeout, [this]() { return HasPending(); });
+}
+
+inline uint64_t InputQueue::Dropped() const
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+inline void InputQueue::Wake()
+{
+    // Taking the lock means a sleeper is either still to check HasPending,
+    // and will see what was just published, or already waiting to be
+    // notified, so a wake-up cannot fall between its check and its wait
+    {
+        const std::lock_guard<std::mutex> lock{wake_mutex};
+    }
+    wake.notify_one();
+}
+
+#endif
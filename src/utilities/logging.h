@@ -0,0 +1,152 @@
+#ifndef SRC_UTILITIES_LOGGING_H
+#define SRC_UTILITIES_LOGGING_H
+
+// SPDLOG_ACTIVE_LEVEL is set by the build (see LEARNWEBGPU_LOG_LEVEL), so that
+// the SPDLOG_<LEVEL> macros below it compile away to nothing
+#include <spdlog/spdlog.h>
+
+#ifndef __EMSCRIPTEN__
+#include <spdlog/async.h>
+#include <spdlog/async_logger.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+// Sets up the default logger and limits how much the render loop may log.
+//
+// Off the web, messages are handed to a background thread through a bounded
+// queue, so console I/O never blocks the render thread. When the queue is
+// full the oldest messages are dropped rather than waiting for space.
+class Logging
+{
+public:
+    static void Initialise();
+
+    // Drain the queue and stop the logging thread
+    static void Shutdown();
+
+    // Drain the queue, so the messages explaining a fatal error are written,
+    // then abort. Use instead of std::abort() once logging is initialised.
+    [[noreturn]] static void Abort();
+
+    // Reset the per-frame message budget. Call once at the start of a frame.
+    static void BeginFrame();
+
+    // Return true if the current frame still has room for another message
+    [[nodiscard]] static bool TryConsumeFrameBudget();
+
+    static constexpr size_t kQueueSize{8'192};
+    static constexpr uint32_t kMaxMessagesPerFrame{16};
+
+private:
+    static inline std::atomic<uint32_t> frame_messages{0};
+    static inline std::atomic<uint32_t> suppressed_messages{0};
+};
+
+// Per-frame rate-limited logging, for use on the render hot path. Calls below
+// SPDLOG_ACTIVE_LEVEL compile away completely, and calls filtered out at run
+// time do not use up the frame budget.
+#define LOG_RATE_LIMITED(level, ...)                                           \
+    do                                                                         \
+    {                                                                          \
+        if (spdlog::should_log(level) && Logging::TryConsumeFrameBudget())    \
+        {                                                                      \
+            SPDLOG_LOGGER_CALL(spdlog::default_logger_raw(),                   \
+                               level,                                          \
+                               __VA_ARGS__);                                   \
+        }                                                                      \
+    } while (false)
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#define LOG_TRACE_RATE_LIMITED(...)                                            \
+    LOG_RATE_LIMITED(spdlog::level::trace, __VA_ARGS__)
+#else
+#define LOG_TRACE_RATE_LIMITED(...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define LOG_DEBUG_RATE_LIMITED(...)                                            \
+    LOG_RATE_LIMITED(spdlog::level::debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG_RATE_LIMITED(...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
+#define LOG_INFO_RATE_LIMITED(...)                                             \
+    LOG_RATE_LIMITED(spdlog::level::info, __VA_ARGS__)
+#else
+#define LOG_INFO_RATE_LIMITED(...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
+#define LOG_WARN_RATE_LIMITED(...)                                             \
+    LOG_RATE_LIMITED(spdlog::level::warn, __VA_ARGS__)
+#else
+#define LOG_WARN_RATE_LIMITED(...) (void)0
+#endif
+
+#if SPDLOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_ERROR
+#define LOG_ERROR_RATE_LIMITED(...)                                            \
+    LOG_RATE_LIMITED(spdlog::level::err, __VA_ARGS__)
+#else
+#define LOG_ERROR_RATE_LIMITED(...) (void)0
+#endif
+
+inline void Logging::Initialise()
+{
+#ifndef __EMSCRIPTEN__
+    spdlog::init_thread_pool(kQueueSize, 1);
+    auto sink{std::make_shared<spdlog::sinks::stdout_color_sink_mt>()};
+    auto logger{std::make_shared<spdlog::async_logger>(
+        "learnwebgpu",
+        sink,
+        spdlog::thread_pool(),
+        spdlog::async_overflow_policy::overrun_oldest)};
+    spdlog::set_default_logger(logger);
+#endif
+
+    // Let through everything that was compiled in
+    spdlog::set_level(
+        static_cast<spdlog::level::level_enum>(SPDLOG_ACTIVE_LEVEL));
+}
+
+inline void Logging::Shutdown()
+{
+    spdlog::shutdown();
+}
+
+inline void Logging::Abort()
+{
+    Shutdown();
+    std::abort();
+}
+
+inline void Logging::BeginFrame()
+{
+    frame_messages.store(0, std::memory_order_relaxed);
+    const uint32_t suppressed{
+        suppressed_messages.exchange(0, std::memory_order_relaxed)};
+    if (suppressed > 0)
+    {
+        spdlog::warn("Suppressed {} log messages over the per-frame limit",
+                     suppressed);
+    }
+}
+
+inline bool Logging::TryConsumeFrameBudget()
+{
+    if (frame_messages.fetch_add(1, std::memory_order_relaxed) <
+        kMaxMessagesPerFrame)
+    {
+        return true;
+    }
+    suppressed_messages.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifndef SRC_UTILITIES_MIPMAP_GENERATOR_H
+#define SRC_UTILITIES_MIPMAP_GENERATOR_H
+
+#include "resource_manager.h"
+
+#include <webgpu/webgpu.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+// Fills in the mip chain of an RGBA8 texture on the GPU, using a compute pass
+// that downsamples each level into the next one.
+class MipmapGenerator
+{
+public:
+    // Create the compute pipeline and return true if it all went well
+    bool Initialise(wgpu::Device device, std::string_view shader_name);
+
+    // Free everything that was initialised
+    void Terminate();
+
+    // Record the passes that generate levels 1..mip_level_count - 1 from
+    // level 0. The texture needs `TextureBinding` and `StorageBinding` usage.
+    void Generate(wgpu::CommandEncoder encoder,
+                  wgpu::Texture texture,
+                  wgpu::Extent3D size,
+                  uint32_t mip_level_count);
+
+private:
+    static constexpr uint32_t kWorkgroupSize{8};
+
+    [[nodiscard]] static wgpu::TextureView CreateLevelView(
+        wgpu::Texture texture,
+        uint32_t level);
+
+    std::optional<wgpu::Device> device{std::nullopt};
+    std::optional<wgpu::BindGroupLayout> bind_group_layout{std::nullopt};
+    std::optional<wgpu::PipelineLayout> layout{std::nullopt};
+    std::optional<wgpu::ComputePipeline> pipeline{std::nullopt};
+};
+
+inline bool MipmapGenerator::Initialise(wgpu::Device device_handle,
+                                        std::string_view shader_name)
+{
+    device = device_handle;
+    wgpu::ShaderModule shader_module{
+        ResourceManager::load_shader_module(shader_name, device_handle)};
+    if (shader_module == nullptr)
+    {
+        spdlog::error("Could not load mipmap generation shader.");
+        return false;
+    }
+
+    std::array<wgpu::BindGroupLayoutEntry, 2> binding_layouts{};
+    binding_layouts[0] = wgpu::Default;
+    binding_layouts[0].binding = 0;
+    binding_layouts[0].visibility = wgpu::ShaderStage::Compute;
+    binding_layouts[0].texture.sampleType = wgpu::TextureSampleType::Float;
+    binding_layouts[0].texture.viewDimension = wgpu::TextureViewDimension::_2D;
+
+    binding_layouts[1] = wgpu::Default;
+    binding_layouts[1].binding = 1;
+    binding_layouts[1].visibility = wgpu::ShaderStage::Compute;
+    binding_layouts[1].storageTexture.access =
+        wgpu::StorageTextureAccess::WriteOnly;
+    binding_layouts[1].storageTexture.format = wgpu::TextureFormat::RGBA8Unorm;
+    binding_layouts[1].storageTexture.viewDimension =
+        wgpu::TextureViewDimension::_2D;
+
+    wgpu::BindGroupLayoutDescriptor bind_group_layout_descriptor{};
+    bind_group_layout_descriptor.label = "Mipmap generation bind group layout";
+    bind_group_layout_descriptor.entryCount =
+        static_cast<uint32_t>(binding_layouts.size());
+    bind_group_layout_descriptor.entries = binding_layouts.data();
+    bind_group_layout = std::optional<wgpu::BindGroupLayout>{
+        device_handle.createBindGroupLayout(bind_group_layout_descriptor)};
+
+    wgpu::PipelineLayoutDescriptor layout_descriptor{};
+    layout_descriptor.bindGroupLayoutCount = 1;
+    layout_descriptor.bindGroupLayouts =
+        // NOLINTNEXTLINE(bugprone-unchecked-optional-access,cppcoreguidelines-pro-type-cstyle-cast)
+        (WGPUBindGroupLayout *)&bind_group_layout.value();
+    layout = std::optional<wgpu::PipelineLayout>{
+        device_handle.createPipelineLayout(layout_descriptor)};
+
+    wgpu::ComputePipelineDescriptor pipeline_descriptor{};
+    pipeline_descriptor.label = "Mipmap generation pipeline";
+    pipeline_descriptor.compute.module = shader_module;
+    pipeline_descriptor.compute.entryPoint = "compute_mip_map";
+    pipeline_descriptor.compute.constantCount = 0;
+    pipeline_descriptor.compute.constants = nullptr;
+    // NOLINTNEXTLINE(bugprone-unchecked-optional-access)
+    pipeline_descriptor.layout = layout.value();
+    pipeline = std::optional<wgpu::ComputePipeline>{
+        device_handle.createComputePipeline(pipeline_descriptor)};
+
+    shader_module.release();
+
+    return pipeline.has_value() && pipeline.value() != nullptr;
+}
+
+inline void MipmapGenerator::Terminate()
+{
+    if (pipeline.has_value())
+    {
+        pipeline.value().release();
+        pipeline.reset();
+    }
+    if (layout.has_value())
+    {
+        layout.value().release();
+        layout.reset();
+    }
+    if (bind_group_layout.has_value())
+    {
+        bind_group_layout.value().release();
+        bind_group_layout.reset();
+    }
+    device.reset();
+}
+
+inline void MipmapGenerator::Generate(wgpu::CommandEncoder encoder,
+                                      wgpu::Texture texture,
+                                      wgpu::Extent3D size,
+                                      uint32_t mip_level_count)
+{
+    if (!pipeline.has_value() || !bind_group_layout.has_value() ||
+        !device.has_value())
+    {
+        spdlog::error("Mipmap generator used before it was initialised");
+        return;
+    }
+
+    wgpu::ComputePassDescriptor compute_pass_descriptor{};
+    compute_pass_descriptor.label = "Mipmap generation pass";
+    compute_pass_descriptor.timestampWrites = nullptr;
+    wgpu::ComputePassEncoder compute_pass{
+        encoder.beginComputePass(compute_pass_descriptor)};
+    compute_pass.setPipeline(pipeline.value());
+
+    uint32_t level_width{size.width};
+    uint32_t level_height{size.height};
+    for (uint32_t level{1}; level < mip_level_count; ++level)
+    {
+        level_width = std::max(1U, level_width / 2);
+        level_height = std::max(1U, level_height / 2);
+
+        wgpu::TextureView input_view{CreateLevelView(texture, level - 1)};
+        wgpu::TextureView output_view{CreateLevelView(texture, level)};
+
+        std::array<wgpu::BindGroupEntry, 2> bindings{};
+        bindings[0].binding = 0;
+        bindings[0].textureView = input_view;
+        bindings[1].binding = 1;
+        bindings[1].textureView = output_view;
+
+        wgpu::BindGroupDescriptor bind_group_descriptor{};
+        bind_group_descriptor.label = "Mipmap generation bind group";
+        bind_group_descriptor.layout = bind_group_layout.value();
+        bind_group_descriptor.entryCount =
+            static_cast<uint32_t>(bindings.size());
+        bind_group_descriptor.entries = bindings.data();
+        wgpu::BindGroup bind_group{
+            device.value().createBindGroup(bind_group_descriptor)};
+
+        compute_pass.setBindGroup(0, bind_group, 0, nullptr);
+        compute_pass.dispatchWorkgroups(
+            (level_width + kWorkgroupSize - 1) / kWorkgroupSize,
+            (level_height + kWorkgroupSize - 1) / kWorkgroupSize,
+            1);
+
+        // The encoder holds its own references until the work completes
+        bind_group.release();
+        output_view.release();
+        input_view.release();
+    }
+
+    compute_pass.end();
+    compute_pass.release();
+}
+
+inline wgpu::TextureView MipmapGenerator::CreateLevelView(
+    wgpu::Texture texture,
+    uint32_t level)
+{
+    wgpu::TextureViewDescriptor view_descriptor{};
+    view_descriptor.label = "Mip level view";
+    view_descriptor.format = wgpu::TextureFormat::RGBA8Unorm;
+    view_descriptor.dimension = wgpu::TextureViewDimension::_2D;
+    view_descriptor.baseMipLevel = level;
+    view_descriptor.mipLevelCount = 1;
+    view_descriptor.baseArrayLayer = 0;
+    view_descriptor.arrayLayerCount = 1;
+    view_descriptor.aspect = wgpu::TextureAspect::All;
+    return texture.createView(view_descriptor);
+}
+
+#endif
@@ -0,0 +1,275 @@
+#ifndef SRC_UTILITIES_OBJECT_CACHE_H
+#define SRC_UTILITIES_OBJECT_CACHE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+struct ObjectCacheStats
+{
+    uint64_t requests{0};
+    uint64_t hits{0};
+    // Objects created, which is the misses plus any lost creation races
+    uint64_t creations{0};
+    uint64_t evictions{0};
+    // Objects someone holds a reference to
+    size_t referenced{0};
+    // Objects kept only in case they are asked for again
+    size_t unreferenced{0};
+
+    [[nodiscard]] double HitRate() const;
+};
+
+// Serialises the contents of a descriptor into a cache key. Two descriptors
+// get the same key exactly when every field added is the same, so keys are
+// compared in full and a hash collision can never return the wrong object.
+class ObjectKey
+{
+public:
+    template <typename T>
+    ObjectKey &Add(T value);
+    // Strings are length-prefixed, and null is distinct from empty
+    ObjectKey &AddString(const char *value);
+
+    [[nodiscard]] const std::string &str() const;
+
+private:
+    std::string bytes{};
+};
+
+// A content-addressed cache of reference-counted objects. Each `Acquire`
+// returns the object for a key, creating it on a miss, and takes a
+// reference that `Release` gives back. Objects nobody references stay cached
+// in case they are asked for again, up to `capacity` of them, after which
+// the least recently released are destroyed.
+//
+// `Handle` is any copyable handle that converts to a pointer identifying the
+// object, as WebGPU handles do. Safe to call from several threads; objects
+// are created outside the lock, so a slow creation does not block hits.
+template <typename Handle>
+class DeduplicatingCache
+{
+public:
+    struct Created
+    {
+        Handle handle{};
+        // Destroys the object, and anything it kept alive
+        std::function<void()> release{};
+    };
+    using Factory = std::function<Created()>;
+
+    static constexpr size_t kDefaultCapacity{64};
+
+    void SetCapacity(size_t unreferenced_capacity);
+
+    [[nodiscard]] Handle Acquire(const ObjectKey &key, const Factory &create);
+
+    // Give back a reference, returning false if the cache does not own
+    // `handle`
+    bool Release(const void *handle);
+
+    // Destroy every object, whether or not it is still referenced
+    void Clear();
+
+    [[nodiscard]] ObjectCacheStats Stats() const;
+
+private:
+    struct Entry
+    {
+        Created object{};
+        size_t references{0};
+    };
+
+    // Destroy least recently released objects until within capacity. The
+    // caller holds `mutex`; the objects are returned to be destroyed after
+    // it is unlocked.
+    [[nodiscard]] std::list<Created> TakeEvicted();
+
+    mutable std::mutex mutex{};
+    std::unordered_map<std::string, Entry> entries{};
+    std::unordered_map<const void *, std::string> keys{};
+    // Keys of unreferenced objects, least recently released first
+    std::list<std::string> unreferenced{};
+    size_t capacity{kDefaultCapacity};
+    ObjectCacheStats stats{};
+};
+
+inline double ObjectCacheStats::HitRate() const
+{
+    return requests == 0
+               ? 0.0
+               : static_cast<double>(hits) / static_cast<double>(requests);
+}
+
+template <typename T>
+ObjectKey &ObjectKey::Add(T value)
+{
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Only plain values can be added to a key");
+    std::array<char, sizeof(T)> encoded{};
+    std::memcpy(encoded.data(), &value, sizeof(T));
+    bytes.append(encoded.data(), encoded.size());
+    return *this;
+}
+
+inline ObjectKey &ObjectKey::AddString(const char *value)
+{
+    if (value == nullptr)
+    {
+        return Add(uint8_t{0});
+    }
+    const std::string_view text{value};
+    Add(uint8_t{1}).Add(static_cast<uint64_t>(text.size()));
+    bytes.append(text);
+    return *this;
+}
+
+inline const std::string &ObjectKey::str() const
+{
+    return bytes;
+}
+
+template <typename Handle>
+void DeduplicatingCache<Handle>::SetCapacity(size_t unreferenced_capacity)
+{
+    std::list<Created> evicted{};
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        capacity = unreferenced_capacity;
+        evicted = TakeEvicted();
+    }
+    for (Created &object : evicted)
+    {
+        object.release();
+    }
+}
+
+template <typename Handle>
+Handle DeduplicatingCache<Handle>::Acquire(const ObjectKey &key,
+                                           const Factory &create)
+{
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        ++stats.requests;
+        const auto found{entries.find(key.str())};
+        if (found != entries.end())
+        {
+            ++stats.hits;
+            if (found->second.references++ == 0)
+            {
+                unreferenced.remove(key.str());
+            }
+            return found->second.object.handle;
+        }
+    }
+
+    Created created{create()};
+    std::optional<Created> duplicate{std::nullopt};
+    Handle handle{created.handle};
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        ++stats.creations;
+        auto [entry, inserted] =
+            entries.try_emplace(key.str(), Entry{created, 1});
+        if (inserted)
+        {
+            keys.emplace(static_cast<const void *>(handle), key.str());
+        }
+        else
+        {
+            // Another thread created the same object first
+            ++stats.hits;
+            if (entry->second.references++ == 0)
+            {
+                unreferenced.remove(key.str());
+            }
+            handle = entry->second.object.handle;
+            duplicate = std::move(created);
+        }
+    }
+    if (duplicate.has_value())
+    {
+        duplicate.value().release();
+    }
+    return handle;
+}
+
+template <typename Handle>
+bool DeduplicatingCache<Handle>::Release(const void *handle)
+{
+    std::list<Created> evicted{};
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        const auto key{keys.find(handle)};
+        if (key == keys.end())
+        {
+            return false;
+        }
+        Entry &entry{entries.at(key->second)};
+        if (entry.references > 0 && --entry.references == 0)
+        {
+            unreferenced.push_back(key->second);
+            evicted = TakeEvicted();
+        }
+    }
+    for (Created &object : evicted)
+    {
+        object.release();
+    }
+    return true;
+}
+
+template <typename Handle>
+void DeduplicatingCache<Handle>::Clear()
+{
+    std::unordered_map<std::string, Entry> cleared{};
+    {
+        const std::lock_guard<std::mutex> lock{mutex};
+        cleared.swap(entries);
+        keys.clear();
+        unreferenced.clear();
+    }
+    for (auto &[key, entry] : cleared)
+    {
+        entry.object.release();
+    }
+}
+
+template <typename Handle>
+ObjectCacheStats DeduplicatingCache<Handle>::Stats() const
+{
+    const std::lock_guard<std::mutex> lock{mutex};
+    ObjectCacheStats current{stats};
+    current.unreferenced = unreferenced.size();
+    current.referenced = entries.size() - unreferenced.size();
+    return current;
+}
+
+template <typename Handle>
+std::list<typename DeduplicatingCache<Handle>::Created> DeduplicatingCache<
+    Handle>::TakeEvicted()
+{
+    std::list<Created> evicted{};
+    while (unreferenced.size() > capacity)
+    {
+        const auto entry{entries.find(unreferenced.front())};
+        keys.erase(static_cast<const void *>(entry->second.object.handle));
+        evicted.push_back(std::move(entry->second.object));
+        entries.erase(entry);
+        unreferenced.pop_front();
+        ++stats.evictions;
+    }
+    return evicted;
+}
+
+#endif
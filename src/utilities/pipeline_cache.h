@@ -0,0 +1,156 @@
+#ifndef SRC_UTILITIES_PIPELINE_CACHE_H
+#define SRC_UTILITIES_PIPELINE_CACHE_H
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Values for a shader's `override` constants, by name. Each distinct set of
+// values specialises the shader into one pipeline permutation.
+using PipelineConstants = std::map<std::string, double>;
+
+struct PipelineConstantsHash
+{
+    size_t operator()(const PipelineConstants &constants) const;
+};
+
+// Pipelines specialised from one shader source, keyed by their override
+// constant values. A permutation is created the first time it is asked for,
+// unless `Prewarm` has already started creating it in the background.
+//
+// `Pipeline` is any copyable handle, such as `wgpu::RenderPipeline`. The
+// factory may be called from worker threads, so must only use thread-safe
+// device calls.
+template <typename Pipeline>
+class PipelinePermutationCache
+{
+public:
+    using Factory = std::function<Pipeline(const PipelineConstants &)>;
+    using Release = std::function<void(Pipeline &)>;
+
+    void Initialise(Factory pipeline_factory, Release pipeline_release);
+
+    // Wait for any background creation, then release every pipeline
+    void Terminate();
+
+    // Return the permutation for `constants`, creating it now if it has not
+    // been created or requested yet
+    [[nodiscard]] Pipeline Get(const PipelineConstants &constants);
+
+    // Start creating permutations expected to be needed later, so switching
+    // to them does not stall a frame. Without threads (Emscripten), these are
+    // instead created on first use.
+    void Prewarm(const std::vector<PipelineConstants> &permutations);
+
+    [[nodiscard]] bool Contains(const PipelineConstants &constants) const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] size_t Misses() const;
+
+private:
+    Factory factory{};
+    Release release{};
+    std::unordered_map<PipelineConstants,
+                       std::shared_future<Pipeline>,
+                       PipelineConstantsHash>
+        permutations{};
+    size_t misses{0};
+};
+
+inline size_t PipelineConstantsHash::operator()(
+    const PipelineConstants &constants) const
+{
+    // Entries are visited in key order, so equal maps hash equally
+    size_t seed{constants.size()};
+    for (const auto &[key, value] : constants)
+    {
+        for (const size_t hash :
+             {std::hash<std::string>{}(key), std::hash<double>{}(value)})
+        {
+            constexpr size_t kGoldenRatio{0x9e3779b9};
+            seed ^= hash + kGoldenRatio + (seed << 6U) + (seed >> 2U);
+        }
+    }
+    return seed;
+}
+
+template <typename Pipeline>
+void PipelinePermutationCache<Pipeline>::Initialise(Factory pipeline_factory,
+                                                    Release pipeline_release)
+{
+    factory = std::move(pipeline_factory);
+    release = std::move(pipeline_release);
+}
+
+template <typename Pipeline>
+void PipelinePermutationCache<Pipeline>::Terminate()
+{
+    for (auto &[constants, pipeline] : permutations)
+    {
+        Pipeline handle{pipeline.get()};
+        release(handle);
+    }
+    permutations.clear();
+}
+
+template <typename Pipeline>
+Pipeline PipelinePermutationCache<Pipeline>::Get(
+    const PipelineConstants &constants)
+{
+    auto permutation{permutations.find(constants)};
+    if (permutation == permutations.end())
+    {
+        ++misses;
+        std::promise<Pipeline> created{};
+        created.set_value(factory(constants));
+        permutation =
+            permutations.emplace(constants, created.get_future().share()).first;
+    }
+    // Blocks only if a prewarm of this permutation is still in flight
+    return permutation->second.get();
+}
+
+template <typename Pipeline>
+void PipelinePermutationCache<Pipeline>::Prewarm(
+    const std::vector<PipelineConstants> &requested)
+{
+#ifdef __EMSCRIPTEN__
+    constexpr std::launch kPolicy{std::launch::deferred};
+#else
+    constexpr std::launch kPolicy{std::launch::async};
+#endif
+    for (const PipelineConstants &constants : requested)
+    {
+        if (permutations.find(constants) == permutations.end())
+        {
+            permutations.emplace(
+                constants,
+                std::async(kPolicy, factory, constants).share());
+        }
+    }
+}
+
+template <typename Pipeline>
+bool PipelinePermutationCache<Pipeline>::Contains(
+    const PipelineConstants &constants) const
+{
+    return permutations.find(constants) != permutations.end();
+}
+
+template <typename Pipeline>
+size_t PipelinePermutationCache<Pipeline>::size() const
+{
+    return permutations.size();
+}
+
+template <typename Pipeline>
+size_t PipelinePermutationCache<Pipeline>::Misses() const
+{
+    return misses;
+}
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef SRC_UTILITIES_PROFILER_H
+#define SRC_UTILITIES_PROFILER_H
+
+#include "spsc_queue.h"
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// One timed zone on one thread, in nanoseconds since the profiler's epoch
+struct ProfileEvent
+{
+    const char *name{""};
+    int64_t start{0};
+    int64_t duration{0};
+};
+
+// Records named zones of CPU time for Chrome's trace viewer and Perfetto.
+// Each thread appends to a lock-free buffer of its own; `Collect` moves what
+// every thread has recorded into one list, and `WriteTrace` writes that list
+// out as Trace Event JSON. Events are dropped and counted when a thread's
+// buffer or the list is full, so call `Collect` regularly.
+//
+// While disabled, a zone costs one well-predicted branch at each end.
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr size_t kEventsPerThread{8192};
+    static constexpr size_t kMaxCollectedEvents{size_t{1} << 20U};
+
+    static void SetEnabled(bool enable);
+    [[nodiscard]] static bool IsEnabled();
+
+    // Name the calling thread in traces
+    static void SetThreadName(std::string_view name);
+    // Record a zone on the calling thread. `name` must outlive the profiler,
+    // as string literals do.
+    static void Record(const char *name,
+                       Clock::time_point start,
+                       Clock::time_point end);
+
+    // Move the events every thread has recorded into the collected list
+    static void Collect();
+    // Collect, then write every event collected so far
+    [[nodiscard]] static bool WriteTrace(const std::filesystem::path &path);
+    // Forget the events collected so far
+    static void Clear();
+
+    [[nodiscard]] static size_t CollectedCount();
+    [[nodiscard]] static uint64_t Dropped();
+
+private:
+    struct ThreadBuffer
+    {
+        uint32_t thread_id{0};
+        // Guarded by `registry_mutex`
+        std::string name{};
+        SpscQueue<ProfileEvent, kEventsPerThread> events{};
+    };
+
+    struct CollectedEvent
+    {
+        ProfileEvent event{};
+        uint32_t thread_id{0};
+    };
+
+    // The calling thread's buffer, registered on first use. Buffers outlive
+    // their threads, so nothing recorded is lost when a worker exits.
+    [[nodiscard]] static ThreadBuffer &LocalBuffer();
+    [[nodiscard]] static int64_t Since(Clock::time_point time);
+    [[nodiscard]] static std::string Escape(std::string_view text);
+
+    static inline std::atomic<bool> enabled{false};
+    static inline std::atomic<uint64_t> dropped{0};
+    static inline const Clock::time_point epoch{Clock::now()};
+    static inline std::mutex registry_mutex{};
+    static inline std::vector<std::unique_ptr<ThreadBuffer>> buffers{};
+    static inline std::vector<CollectedEvent> collected{};
+};
+
+// Times the enclosing scope as a profiler zone
+class ProfileZone
+{
+public:
+    // `name` must outlive the profiler, as string literals do
+    explicit ProfileZone(const char *zone_name);
+    ProfileZone(const ProfileZone &) = delete;
+    ProfileZone &operator=(const ProfileZone &) = delete;
+    ProfileZone(ProfileZone &&) = delete;
+    ProfileZone &operator=(ProfileZone &&) = delete;
+    ~ProfileZone();
+
+    // End the zone before the scope does
+    void End();
+    // False if the profiler was disabled when the zone began, or it ended
+    [[nodiscard]] bool IsActive() const;
+
+private:
+    const char *name{nullptr};
+    Profiler::Clock::time_point start{};
+};
+
+// A profiler zone that is also a debug group on `Encoder`, a command or
+// render pass encoder, so GPU captures show the zones the CPU trace does.
+// Groups are only pushed while the profiler is enabled.
+template <typename Encoder>
+class GpuProfileZone
+{
+public:
+    GpuProfileZone(Encoder &zone_encoder, const char *zone_name);
+    GpuProfileZone(const GpuProfileZone &) = delete;
+    GpuProfileZone &operator=(const GpuProfileZone &) = delete;
+    GpuProfileZone(GpuProfileZone &&) = delete;
+    GpuProfileZone &operator=(GpuProfileZone &&) = delete;
+    ~GpuProfileZone();
+
+    // End the zone before the scope does, as the group must be popped before
+    // the encoder finishes
+    void End();
+
+private:
+    ProfileZone zone;
+    Encoder *encoder{nullptr};
+};
+
+inline void Profiler::SetEnabled(bool enable)
+{
+    enabled.store(enable, std::memory_order_relaxed);
+}
+
+inline bool Profiler::IsEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+inline void Profiler::SetThreadName(std::string_view name)
+{
+    ThreadBuffer &buffer{LocalBuffer()};
+    const std::lock_guard<std::mutex> lock{registry_mutex};
+    buffer.name = name;
+}
+
+inline void Profiler::Record(const char *name,
+                             Clock::time_point start,
+                             Clock::time_point end)
+{
+    const int64_t start_time{Since(start)};
+    if (!LocalBuffer().events.Push(
+            ProfileEvent{name, start_time, Since(end) - start_time}))
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+inline void Profiler::Collect()
+{
+    const std::lock_guard<std::mutex> lock{registry_mutex};
+    for (const std::unique_ptr<ThreadBuffer> &buffer : buffers)
+    {
+        while (std::optional<ProfileEvent> event{buffer->events.Pop()})
+        {
+            if (collected.size() < kMaxCollectedEvents)
+            {
+                collected.push_back({event.value(), buffer->thread_id});
+            }
+            else
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+inline bool Profiler::WriteTrace(const std::filesystem::path &path)
+{
+    Collect();
+    std::ofstream file{path};
+    if (!file)
+    {
+        return false;
+    }
+
+    const std::lock_guard<std::mutex> lock{registry_mutex};
+    constexpr double kMicroseconds{1e-3};
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    const char *separator{""};
+    for (const std::unique_ptr<ThreadBuffer> &buffer : buffers)
+    {
+        if (buffer->name.empty())
+        {
+            continue;
+        }
+        file << fmt::format("{}\n{{\"name\":\"thread_name\",\"ph\":\"M\","
+                            "\"pid\":1,\"tid\":{},"
+                            "\"args\":{{\"name\":\"{}\"}}}}",
+                            separator,
+                            buffer->thread_id,
+                            Escape(buffer->name));
+        separator = ",";
+    }
+    for (const CollectedEvent &collected_event : collected)
+    {
+        const ProfileEvent &event{collected_event.event};
+        file << fmt::format("{}\n{{\"name\":\"{}\",\"cat\":\"cpu\","
+                            "\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},"
+                            "\"dur\":{:.3f}}}",
+                            separator,
+                            Escape(event.name),
+                            collected_event.thread_id,
+                            kMicroseconds * static_cast<double>(event.start),
+                            kMicroseconds *
+                                static_cast<double>(event.duration));
+        separator = ",";
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
+
+inline void Profiler::Clear()
+{
+    const std::lock_guard<std::mutex> lock{registry_mutex};
+    collected.clear();
+}
+
+inline size_t Profiler::CollectedCount()
+{
+    const std::lock_guard<std::mutex> lock{registry_mutex};
+    return collected.size();
+}
+
+inline uint64_t Profiler::Dropped()
+{
+    return dropped.load(std::memory_order_relaxed);
+}
+
+inline Profiler::ThreadBuffer &Profiler::LocalBuffer()
+{
+    thread_local ThreadBuffer *local{nullptr};
+    if (local == nullptr)
+    {
+        auto buffer{std::make_unique<ThreadBuffer>()};
+        local = buffer.get();
+        const std::lock_guard<std::mutex> lock{registry_mutex};
+        buffer->thread_id = static_cast<uint32_t>(buffers.size() + 1);
+        buffers.push_back(std::move(buffer));
+    }
+    return *local;
+}
+
+inline int64_t Profiler::Since(Clock::time_point time)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch)
+        .count();
+}
+
+inline std::string Profiler::Escape(std::string_view text)
+{
+    std::string escaped{};
+    escaped.reserve(text.size());
+    for (const char character : text)
+    {
+        if (character == '"' || character == '\\')
+        {
+            escaped.push_back('\\');
+        }
+        // Control characters have no place in a zone name
+        escaped.push_back(static_cast<unsigned char>(character) < ' '
+                              ? ' '
+                              : character);
+    }
+    return escaped;
+}
+
+inline ProfileZone::ProfileZone(const char *zone_name)
+{
+    if (Profiler::IsEnabled())
+    {
+        name = zone_name;
+        start = Profiler::Clock::now();
+    }
+}
+
+inline ProfileZone::~ProfileZone()
+{
+    End();
+}
+
+inline void ProfileZone::End()
+{
+    if (name != nullptr)
+    {
+        Profiler::Record(name, start, Profiler::Clock::now());
+        name = nullptr;
+    }
+}
+
+inline bool ProfileZone::IsActive() const
+{
+    return name != nullptr;
+}
+
+template <typename Encoder>
+GpuProfileZone<Encoder>::GpuProfileZone(Encoder &zone_encoder,
+                                        const char *zone_name)
+    : zone{zone_name}
+{
+    if (zone.IsActive())
+    {
+        encoder = &zone_encoder;
+        encoder->pushDebugGroup(zone_name);
+    }
+}
+
+template <typename Encoder>
+GpuProfileZone<Encoder>::~GpuProfileZone()
+{
+    End();
+}
+
+template <typename Encoder>
+void GpuProfileZone<Encoder>::End()
+{
+    if (encoder != nullptr)
+    {
+        encoder->popDebugGroup();
+        encoder = nullptr;
+    }
+    zone.End();
+}
+
+#endif
@@ -0,0 +1,407 @@
+#ifndef SRC_UTILITIES_RENDER_QUEUE_H
+#define SRC_UTILITIES_RENDER_QUEUE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Draws are ordered by a packed 64-bit key, most significant field first:
+//
+//   pass (4) | pipeline (12) | bind group (12) | mesh (12) | depth (24)
+//
+// so that draws sharing a pipeline, then a bind group, then buffers end up
+// next to each other, front to back within each group.
+class SortKey
+{
+public:
+    static constexpr uint32_t kPassBits{4};
+    static constexpr uint32_t kPipelineBits{12};
+    static constexpr uint32_t kBindGroupBits{12};
+    static constexpr uint32_t kMeshBits{12};
+    static constexpr uint32_t kDepthBits{24};
+
+    // Fields wider than their bits wrap, which only costs extra state changes
+    [[nodiscard]] static constexpr uint64_t Pack(uint32_t pass,
+                                                 uint32_t pipeline,
+                                                 uint32_t bind_group,
+                                                 uint32_t mesh,
+                                                 uint32_t depth);
+
+    // Map a depth in [0, 1] onto the depth field. Values outside are clamped.
+    [[nodiscard]] static constexpr uint32_t QuantiseDepth(float depth);
+
+    [[nodiscard]] static constexpr uint32_t Pass(uint64_t key);
+    [[nodiscard]] static constexpr uint32_t Pipeline(uint64_t key);
+    [[nodiscard]] static constexpr uint32_t BindGroup(uint64_t key);
+    [[nodiscard]] static constexpr uint32_t Mesh(uint64_t key);
+    [[nodiscard]] static constexpr uint32_t Depth(uint64_t key);
+
+private:
+    static constexpr uint32_t kDepthShift{0};
+    static constexpr uint32_t kMeshShift{kDepthShift + kDepthBits};
+    static constexpr uint32_t kBindGroupShift{kMeshShift + kMeshBits};
+    static constexpr uint32_t kPipelineShift{kBindGroupShift + kBindGroupBits};
+    static constexpr uint32_t kPassShift{kPipelineShift + kPipelineBits};
+    static_assert(kPassShift + kPassBits == 64);
+
+    [[nodiscard]] static constexpr uint64_t Field(uint32_t value,
+                                                  uint32_t bits,
+                                                  uint32_t shift);
+    [[nodiscard]] static constexpr uint32_t Extract(uint64_t key,
+                                                    uint32_t bits,
+                                                    uint32_t shift);
+};
+
+// Sort (key, index) pairs by key with a stable least-significant-digit radix
+// sort, a byte at a time. Passes where every key has the same byte are
+// skipped, so keys that only differ in a few fields sort in a few passes.
+void RadixSortByKey(std::vector<std::pair<uint64_t, uint32_t>> &entries,
+                    std::vector<std::pair<uint64_t, uint32_t>> &scratch);
+
+// Counts of the state set while drawing one frame
+struct RenderQueueStats
+{
+    uint32_t draws{0};
+    uint32_t pipeline_changes{0};
+    uint32_t bind_group_changes{0};
+    uint32_t vertex_buffer_changes{0};
+    uint32_t index_buffer_changes{0};
+    // What the same draws would have cost in submission order
+    uint32_t unsorted_state_changes{0};
+
+    [[nodiscard]] uint32_t StateChanges() const;
+};
+
+// Collects a frame's draws, then issues them in sort key order, setting only
+// the state that differs from the previous draw.
+//
+// `Types` names the handle types: `Pipeline`, `BindGroup`, `Buffer` and
+// `IndexFormat`. Handles must convert to a pointer that identifies the
+// object, as WebGPU handles do. The encoder passed to `Submit` needs
+// `setPipeline`, `setBindGroup`, `setVertexBuffer`, `setIndexBuffer` and
+// `drawIndexed`, with the signatures of wgpu::RenderPassEncoder. Every draw
+// uses bind group 0 and vertex buffer slot 0.
+template <typename Types>
+class RenderQueue
+{
+public:
+    struct BufferBinding
+    {
+        typename Types::Buffer buffer{};
+        uint64_t offset{0};
+        uint64_t size{0};
+    };
+
+    struct DrawPacket
+    {
+        uint64_t key{0};
+        typename Types::Pipeline pipeline{};
+        typename Types::BindGroup bind_group{};
+        BufferBinding vertex_buffer{};
+        BufferBinding index_buffer{};
+        typename Types::IndexFormat index_format{};
+        uint32_t index_count{0};
+        uint32_t instance_count{1};
+        uint32_t first_index{0};
+        int32_t base_vertex{0};
+    };
+
+    // Build a key from the packet's handles, which are given small ids the
+    // first time they are seen
+    [[nodiscard]] uint64_t MakeKey(uint32_t pass,
+                                   const DrawPacket &packet,
+                                   float depth);
+
+    void Push(const DrawPacket &packet);
+
+    // Sort the frame's draws, issue them to `encoder` and start a new frame
+    template <typename Encoder>
+    RenderQueueStats Submit(Encoder &encoder);
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] const RenderQueueStats &LastStats() const;
+
+private:
+    enum class Kind : uint8_t
+    {
+        Pipeline,
+        BindGroup,
+        Mesh,
+    };
+
+    // Buffer address, offset and size
+    using BufferState = std::tuple<const void *, uint64_t, uint64_t>;
+
+    // The state a draw needs, with handles as object addresses
+    struct State
+    {
+        const void *pipeline{nullptr};
+        const void *bind_group{nullptr};
+        BufferState vertex_buffer{};
+        BufferState index_buffer{};
+    };
+
+    [[nodiscard]] uint32_t Id(Kind kind, const void *handle);
+    [[nodiscard]] static State StateOf(const DrawPacket &packet);
+    // Add the state `next` changes relative to `current` to `stats`
+    static void CountChanges(const State &current,
+                             const State &next,
+                             bool first,
+                             RenderQueueStats &stats);
+
+    std::vector<DrawPacket> packets{};
+    std::vector<std::pair<uint64_t, uint32_t>> order{};
+    std::vector<std::pair<uint64_t, uint32_t>> scratch{};
+    std::array<std::unordered_map<const void *, uint32_t>, 3> ids{};
+    RenderQueueStats last_stats{};
+};
+
+constexpr uint64_t SortKey::Pack(uint32_t pass,
+                                 uint32_t pipeline,
+                                 uint32_t bind_group,
+                                 uint32_t mesh,
+                                 uint32_t depth)
+{
+    return Field(pass, kPassBits, kPassShift) |
+           Field(pipeline, kPipelineBits, kPipelineShift) |
+           Field(bind_group, kBindGroupBits, kBindGroupShift) |
+           Field(mesh, kMeshBits, kMeshShift) |
+           Field(depth, kDepthBits, kDepthShift);
+}
+
+constexpr uint32_t SortKey::QuantiseDepth(float depth)
+{
+    constexpr auto kMaxDepth{static_cast<float>((1U << kDepthBits) - 1)};
+    const float clamped{depth < 0.0F ? 0.0F : (depth > 1.0F ? 1.0F : depth)};
+    return static_cast<uint32_t>(clamped * kMaxDepth);
+}
+
+constexpr uint32_t SortKey::Pass(uint64_t key)
+{
+    return Extract(key, kPassBits, kPassShift);
+}
+
+constexpr uint32_t SortKey::Pipeline(uint64_t key)
+{
+    return Extract(key, kPipelineBits, kPipelineShift);
+}
+
+constexpr uint32_t SortKey::BindGroup(uint64_t key)
+{
+    return Extract(key, kBindGroupBits, kBindGroupShift);
+}
+
+constexpr uint32_t SortKey::Mesh(uint64_t key)
+{
+    return Extract(key, kMeshBits, kMeshShift);
+}
+
+constexpr uint32_t SortKey::Depth(uint64_t key)
+{
+    return Extract(key, kDepthBits, kDepthShift);
+}
+
+constexpr uint64_t SortKey::Field(uint32_t value, uint32_t bits, uint32_t shift)
+{
+    return (static_cast<uint64_t>(value) & ((uint64_t{1} << bits) - 1))
+           << shift;
+}
+
+constexpr uint32_t SortKey::Extract(uint64_t key, uint32_t bits, uint32_t shift)
+{
+    return static_cast<uint32_t>((key >> shift) & ((uint64_t{1} << bits) - 1));
+}
+
+inline void RadixSortByKey(
+    std::vector<std::pair<uint64_t, uint32_t>> &entries,
+    std::vector<std::pair<uint64_t, uint32_t>> &scratch)
+{
+    constexpr size_t kDigitBits{8};
+    constexpr size_t kDigits{sizeof(uint64_t)};
+    constexpr size_t kBuckets{size_t{1} << kDigitBits};
+    constexpr uint64_t kDigitMask{kBuckets - 1};
+
+    // One read of the keys fills in the histogram of every digit
+    std::array<std::array<size_t, kBuckets>, kDigits> counts{};
+    for (const auto &entry : entries)
+    {
+        for (size_t digit{0}; digit < kDigits; ++digit)
+        {
+            ++counts.at(digit).at(
+                (entry.first >> (digit * kDigitBits)) & kDigitMask);
+        }
+    }
+
+    scratch.resize(entries.size());
+    for (size_t digit{0}; digit < kDigits; ++digit)
+    {
+        std::array<size_t, kBuckets> &buckets{counts.at(digit)};
+        const uint64_t first_digit{
+            entries.empty()
+                ? 0
+                : (entries.front().first >> (digit * kDigitBits)) & kDigitMask};
+        if (buckets.at(first_digit) == entries.size())
+        {
+            continue;
+        }
+
+        // Turn counts into each bucket's first output position
+        size_t position{0};
+        for (size_t &bucket : buckets)
+        {
+            position += std::exchange(bucket, position);
+        }
+        for (const auto &entry : entries)
+        {
+            scratch[buckets.at((entry.first >> (digit * kDigitBits)) &
+                               kDigitMask)++] = entry;
+        }
+        entries.swap(scratch);
+    }
+}
+
+inline uint32_t RenderQueueStats::StateChanges() const
+{
+    return pipeline_changes + bind_group_changes + vertex_buffer_changes +
+           index_buffer_changes;
+}
+
+template <typename Types>
+uint64_t RenderQueue<Types>::MakeKey(uint32_t pass,
+                                     const DrawPacket &packet,
+                                     float depth)
+{
+    const State state{StateOf(packet)};
+    return SortKey::Pack(
+        pass,
+        Id(Kind::Pipeline, state.pipeline),
+        Id(Kind::BindGroup, state.bind_group),
+        Id(Kind::Mesh, std::get<0>(state.vertex_buffer)),
+        SortKey::QuantiseDepth(depth));
+}
+
+template <typename Types>
+void RenderQueue<Types>::Push(const DrawPacket &packet)
+{
+    order.emplace_back(packet.key, static_cast<uint32_t>(packets.size()));
+    packets.push_back(packet);
+}
+
+template <typename Types>
+template <typename Encoder>
+RenderQueueStats RenderQueue<Types>::Submit(Encoder &encoder)
+{
+    RenderQueueStats stats{};
+    State current{};
+    for (size_t index{0}; index < packets.size(); ++index)
+    {
+        RenderQueueStats unsorted{};
+        const State next{StateOf(packets[index])};
+        CountChanges(current, next, index == 0, unsorted);
+        stats.unsorted_state_changes += unsorted.StateChanges();
+        current = next;
+    }
+
+    RadixSortByKey(order, scratch);
+
+    current = State{};
+    for (const auto &[key, packet_index] : order)
+    {
+        const DrawPacket &packet{packets[packet_index]};
+        const State next{StateOf(packet)};
+        const bool first{stats.draws == 0};
+        if (first || next.pipeline != current.pipeline)
+        {
+            encoder.setPipeline(packet.pipeline);
+        }
+        if (first || next.bind_group != current.bind_group)
+        {
+            encoder.setBindGroup(0, packet.bind_group, 0, nullptr);
+        }
+        if (first || next.vertex_buffer != current.vertex_buffer)
+        {
+            encoder.setVertexBuffer(0,
+                                    packet.vertex_buffer.buffer,
+                                    packet.vertex_buffer.offset,
+                                    packet.vertex_buffer.size);
+        }
+        if (first || next.index_buffer != current.index_buffer)
+        {
+            encoder.setIndexBuffer(packet.index_buffer.buffer,
+                                   packet.index_format,
+                                   packet.index_buffer.offset,
+                                   packet.index_buffer.size);
+        }
+        encoder.drawIndexed(packet.index_count,
+                            packet.instance_count,
+                            packet.first_index,
+                            packet.base_vertex,
+                            0);
+        CountChanges(current, next, first, stats);
+        ++stats.draws;
+        current = next;
+    }
+
+    packets.clear();
+    order.clear();
+    last_stats = stats;
+    return stats;
+}
+
+template <typename Types>
+size_t RenderQueue<Types>::size() const
+{
+    return packets.size();
+}
+
+template <typename Types>
+const RenderQueueStats &RenderQueue<Types>::LastStats() const
+{
+    return last_stats;
+}
+
+template <typename Types>
+uint32_t RenderQueue<Types>::Id(Kind kind, const void *handle)
+{
+    std::unordered_map<const void *, uint32_t> &kind_ids{
+        ids.at(static_cast<size_t>(kind))};
+    return kind_ids.emplace(handle, static_cast<uint32_t>(kind_ids.size()))
+        .first->second;
+}
+
+template <typename Types>
+typename RenderQueue<Types>::State RenderQueue<Types>::StateOf(
+    const DrawPacket &packet)
+{
+    // Handles convert to the address of the object they refer to
+    const void *vertex_buffer{packet.vertex_buffer.buffer};
+    const void *index_buffer{packet.index_buffer.buffer};
+    return State{packet.pipeline,
+                 packet.bind_group,
+                 {vertex_buffer,
+                  packet.vertex_buffer.offset,
+                  packet.vertex_buffer.size},
+                 {index_buffer,
+                  packet.index_buffer.offset,
+                  packet.index_buffer.size}};
+}
+
+template <typename Types>
+void RenderQueue<Types>::CountChanges(const State &current,
+                                      const State &next,
+                                      bool first,
+                                      RenderQueueStats &stats)
+{
+    stats.pipeline_changes += first || next.pipeline != current.pipeline;
+    stats.bind_group_changes += first || next.bind_group != current.bind_group;
+    stats.vertex_buffer_changes +=
+        first || next.vertex_buffer != current.vertex_buffer;
+    stats.index_buffer_changes +=
+        first || next.index_buffer != current.index_buffer;
+}
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef SRC_UTILITIES_REPORT_TIMER_H
+#define SRC_UTILITIES_REPORT_TIMER_H
+
+#include <chrono>
+#include <optional>
+
+// Paces the periodic statistics. Every monitor uses the same interval, so
+// their reports arrive together.
+class ReportTimer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Seconds = std::chrono::duration<double>;
+
+    static constexpr std::chrono::seconds kInterval{10};
+
+    // The first call starts the first interval and returns nothing. Later
+    // calls return how long the interval lasted once it has run for at least
+    // `kInterval`, and start the next one at `now`.
+    [[nodiscard]] std::optional<Seconds> Tick(Clock::time_point now);
+
+    [[nodiscard]] bool IsRunning() const;
+
+private:
+    std::optional<Clock::time_point> interval_start{std::nullopt};
+};
+
+inline std::optional<ReportTimer::Seconds> ReportTimer::Tick(
+    Clock::time_point now)
+{
+    if (!interval_start.has_value())
+    {
+        interval_start = now;
+        return std::nullopt;
+    }
+    const Seconds elapsed{now - interval_start.value()};
+    if (elapsed < kInterval)
+    {
+        return std::nullopt;
+    }
+    interval_start = now;
+    return elapsed;
+}
+
+inline bool ReportTimer::IsRunning() const
+{
+    return interval_start.has_value();
+}
+
+#endif
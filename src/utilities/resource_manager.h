@@ -1,40 +1,213 @@
-#ifndef SRC_RESOURCE_MANAGER_H
-#define SRC_RESOURCE_MANAGER_H
+#ifndef SRC_UTILITIES_RESOURCE_MANAGER_H
+#define SRC_UTILITIES_RESOURCE_MANAGER_H
 
 #define WEBGPU_CPP_IMPLEMENTATION
 #include <webgpu/webgpu.hpp>
 
+#include "logging.h"
+#include "profiler.h"
+#include "resource_pack.h"
+
 #include <spdlog/spdlog.h>
 
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 #include <filesystem>
 #include <fstream>
+#include <initializer_list>
 #include <ios>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Resources are looked up by name: first in the mounted resource pack, if
+// there is one, then as loose files under the resource directory.
 class ResourceManager
 {
 public:
-    static bool load_geometry(const std::filesystem::path &path,
+    static void set_resource_directory(const std::filesystem::path &path);
+
+    // Serve resources from the pack file at `path`, returning false if it
+    // could not be mapped
+    static bool mount_pack(const std::filesystem::path &path);
+
+    // Serve resources from a pack already in memory, such as one embedded in
+    // the binary
+    static bool mount_pack(std::string_view bytes);
+
+    [[nodiscard]] static std::optional<ResourceBlob> read(
+        std::string_view name);
+    [[nodiscard]] static bool exists(std::string_view name);
+
+    // Log how long opening and reading `names` takes as loose files and from
+    // the pack. This reads everything twice, so is only for comparisons; it
+    // does nothing unless a pack is mounted and every name is a loose file.
+    static void report_read_times(
+        std::initializer_list<std::string_view> names);
+
+    static bool load_geometry(std::string_view name,
                               std::vector<float> &point_data,
                               std::vector<uint16_t> &index_data);
 
-    static wgpu::ShaderModule load_shader_module(
-        const std::filesystem::path &path,
-        wgpu::Device device);
+    static wgpu::ShaderModule load_shader_module(std::string_view name,
+                                                 wgpu::Device device);
+
+private:
+    [[nodiscard]] static std::optional<ResourceBlob> read_file(
+        const std::filesystem::path &path);
+
+    static inline std::filesystem::path resource_directory{"."};
+    static inline std::optional<ResourcePack> pack{std::nullopt};
+    static inline std::optional<std::filesystem::path> pack_path{std::nullopt};
 };
 
-bool ResourceManager::load_geometry(const std::filesystem::path &path,
-                                    std::vector<float> &point_data,
-                                    std::vector<uint16_t> &index_data)
+inline void ResourceManager::set_resource_directory(
+    const std::filesystem::path &path)
 {
-    std::ifstream file{path};
-    if (!file.is_open())
+    resource_directory = path;
+}
+
+inline bool ResourceManager::mount_pack(const std::filesystem::path &path)
+{
+    pack = ResourcePack::Open(path);
+    if (!pack.has_value())
+    {
+        spdlog::warn("Could not open resource pack `{}`, using loose files",
+                     path.string());
+        pack_path.reset();
+        return false;
+    }
+    pack_path = path;
+    spdlog::info("Mounted resource pack `{}` ({} resources)",
+                 path.string(),
+                 pack.value().size());
+    return true;
+}
+
+inline bool ResourceManager::mount_pack(std::string_view bytes)
+{
+    pack = ResourcePack::FromMemory(bytes);
+    pack_path.reset();
+    if (!pack.has_value())
+    {
+        spdlog::error("Embedded resource pack is malformed, using loose files");
+        return false;
+    }
+    spdlog::info("Mounted embedded resource pack ({} resources)",
+                 pack.value().size());
+    return true;
+}
+
+inline std::optional<ResourceBlob> ResourceManager::read(std::string_view name)
+{
+    const ProfileZone profile_zone{"ResourceManager::read"};
+    if (pack.has_value())
+    {
+        std::optional<ResourceBlob> blob{pack.value().Find(name)};
+        if (blob.has_value())
+        {
+            return blob;
+        }
+    }
+    return read_file(resource_directory / name);
+}
+
+inline bool ResourceManager::exists(std::string_view name)
+{
+    return (pack.has_value() && pack.value().Contains(name)) ||
+           std::filesystem::exists(resource_directory / name);
+}
+
+inline void ResourceManager::report_read_times(
+    std::initializer_list<std::string_view> names)
+{
+    if (!pack.has_value())
+    {
+        return;
+    }
+
+    // Touch every byte, so that neither side gets away with a lazy read
+    auto checksum{[](const ResourceBlob &blob) {
+        return ResourcePackFormat::Hash(blob.data());
+    }};
+    using Clock = std::chrono::steady_clock;
+    uint64_t loose_bytes{0};
+    uint64_t pack_bytes{0};
+    uint64_t loose_checksum{0};
+    uint64_t pack_checksum{0};
+
+    // Probe first, as read_file reports missing files as errors
+    for (const std::string_view name : names)
+    {
+        if (!std::filesystem::is_regular_file(resource_directory / name))
+        {
+            spdlog::info("Skipping read time report: `{}` is not a loose file",
+                         name);
+            return;
+        }
+    }
+
+    const Clock::time_point loose_start{Clock::now()};
+    for (const std::string_view name : names)
+    {
+        const std::optional<ResourceBlob> blob{
+            read_file(resource_directory / name)};
+        if (!blob.has_value())
+        {
+            return;
+        }
+        loose_bytes += blob.value().size();
+        loose_checksum ^= checksum(blob.value());
+    }
+    const std::chrono::duration<double, std::milli> loose_time{Clock::now() -
+                                                               loose_start};
+
+    // Include opening (mapping) the pack, as start-up would
+    const Clock::time_point pack_start{Clock::now()};
+    const std::optional<ResourcePack> fresh_pack{
+        pack_path.has_value() ? ResourcePack::Open(pack_path.value()) : pack};
+    if (!fresh_pack.has_value())
+    {
+        return;
+    }
+    for (const std::string_view name : names)
+    {
+        const std::optional<ResourceBlob> blob{fresh_pack.value().Find(name)};
+        if (!blob.has_value())
+        {
+            spdlog::info("Skipping read time report: `{}` is not in the pack",
+                         name);
+            return;
+        }
+        pack_bytes += blob.value().size();
+        pack_checksum ^= checksum(blob.value());
+    }
+    const std::chrono::duration<double, std::milli> pack_time{Clock::now() -
+                                                              pack_start};
+
+    spdlog::info("Start-up resource reads: loose files {:.3f} ms ({} bytes), "
+                 "resource pack {:.3f} ms ({} bytes)",
+                 loose_time.count(),
+                 loose_bytes,
+                 pack_time.count(),
+                 pack_bytes);
+    if (loose_checksum != pack_checksum)
+    {
+        spdlog::warn("Resource pack contents differ from the loose files; "
+                     "rebuild the pack to pick up edits");
+    }
+}
+
+inline bool ResourceManager::load_geometry(std::string_view name,
+                                           std::vector<float> &point_data,
+                                           std::vector<uint16_t> &index_data)
+{
+    const std::optional<ResourceBlob> blob{read(name)};
+    if (!blob.has_value())
     {
-        spdlog::error("Was not able to open file `{}`", path.string());
         return false;
     }
 
@@ -51,16 +224,20 @@ bool ResourceManager::load_geometry(const std::filesystem::path &path,
 
     float value{};
     uint16_t index{};
-    std::string line;
-    while (!file.eof())
+    std::string_view remaining{blob.value().data()};
+    while (!remaining.empty())
     {
-        getline(file, line);
-        spdlog::info("Got line: {}", line);
+        const size_t line_end{remaining.find('\n')};
+        std::string_view line{remaining.substr(0, line_end)};
+        remaining = line_end == std::string_view::npos
+                        ? std::string_view{}
+                        : remaining.substr(line_end + 1);
+        SPDLOG_TRACE("Got line: {}", line);
 
         // overcome the `CRLF` problem
         if (!line.empty() && line.back() == '\r')
         {
-            line.pop_back();
+            line.remove_suffix(1);
         }
 
         if (line == "[points]")
@@ -71,13 +248,13 @@ bool ResourceManager::load_geometry(const std::filesystem::path &path,
         {
             current_section = Section::Indices;
         }
-        else if (line[0] == '#' || line.empty())
+        else if (line.empty() || line[0] == '#')
         {
             // nothing to do
         }
         else if (current_section == Section::Points)
         {
-            std::istringstream iss{line};
+            std::istringstream iss{std::string{line}};
             for (int i{0}; i < 5; ++i)
             {
                 iss >> value;
@@ -86,7 +263,7 @@ bool ResourceManager::load_geometry(const std::filesystem::path &path,
         }
         else if (current_section == Section::Indices)
         {
-            std::istringstream iss(line);
+            std::istringstream iss{std::string{line}};
             for (int i{0}; i < 3; ++i)
             {
                 iss >> index;
@@ -98,26 +275,25 @@ bool ResourceManager::load_geometry(const std::filesystem::path &path,
     return true;
 }
 
-wgpu::ShaderModule ResourceManager::load_shader_module(
-    const std::filesystem::path &path,
+inline wgpu::ShaderModule ResourceManager::load_shader_module(
+    std::string_view name,
     wgpu::Device device)
 {
-    spdlog::info("Loading shader module from `{}`", path.string());
-    std::ifstream file{path};
-    if (!file.is_open())
+    const ProfileZone profile_zone{"ResourceManager::load_shader_module"};
+    spdlog::info("Loading shader module `{}`", name);
+    // Blobs are NUL-terminated, so the source is passed on without a copy
+    const std::optional<ResourceBlob> shader_source{read(name)};
+    if (!shader_source.has_value())
     {
-        spdlog::error("Was not able to open file `{}`", path.string());
         return nullptr;
     }
-    std::string shader_source{(std::istreambuf_iterator<char>(file)),
-                              (std::istreambuf_iterator<char>())};
-    spdlog::trace("Source: \n{}", shader_source);
+    SPDLOG_TRACE("Source: \n{}", shader_source.value().data());
 
     wgpu::ShaderModuleWGSLDescriptor shader_code_descriptor{};
     shader_code_descriptor.chain.next = nullptr;
     shader_code_descriptor.chain.sType =
         wgpu::SType::ShaderModuleWGSLDescriptor;
-    shader_code_descriptor.code = shader_source.c_str();
+    shader_code_descriptor.code = shader_source.value().c_str();
 
     wgpu::ShaderModuleDescriptor shader_descriptor{};
 #ifdef WEBGPU_BACKEND_WGPU
@@ -129,4 +305,27 @@ wgpu::ShaderModule ResourceManager::load_shader_module(
     return device.createShaderModule(shader_descriptor);
 }
 
+inline std::optional<ResourceBlob> ResourceManager::read_file(
+    const std::filesystem::path &path)
+{
+    std::ifstream file{path, std::ios::binary | std::ios::ate};
+    if (!file.is_open())
+    {
+        spdlog::error("Was not able to open file `{}`", path.string());
+        return std::nullopt;
+    }
+
+    // Read in one go, rather than a character at a time
+    const std::streamsize size{file.tellg()};
+    std::string contents(static_cast<size_t>(size), '\0');
+    file.seekg(0);
+    file.read(contents.data(), size);
+    if (!file)
+    {
+        spdlog::error("Was not able to read file `{}`", path.string());
+        return std::nullopt;
+    }
+    return ResourceBlob{std::move(contents)};
+}
+
 #endif
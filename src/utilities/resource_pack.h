@@ -0,0 +1,871 @@
+#ifndef SRC_UTILITIES_RESOURCE_PACK_H
+#define SRC_UTILITIES_RESOURCE_PACK_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <ios>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A resource pack is one file holding every resource as a named blob:
+//
+//   header  | magic `LWPK`, u32 version, u32 entry count, u32 alignment,
+//           | u64 string table offset, u64 file size
+//   index   | one 48-byte entry per blob, sorted by name hash
+//   strings | entry names, back to back
+//   blobs   | each starting on an `alignment` boundary and followed by a NUL
+//           | byte, so text can be handed to C APIs without a copy
+//
+// All integers are little-endian. Each index entry holds the FNV-1a hash of
+// the name and of the original contents, the blob offset, its stored and
+// original sizes, and the compression method used.
+class ResourcePackFormat
+{
+public:
+    static constexpr std::array<char, 4> kMagic{'L', 'W', 'P', 'K'};
+    static constexpr uint32_t kVersion{1};
+    static constexpr uint32_t kDefaultAlignment{16};
+    static constexpr size_t kHeaderSize{32};
+    static constexpr size_t kEntrySize{48};
+    // Most bytes each compressed byte can expand to: a 3-byte match token
+    // produces at most 131
+    static constexpr uint64_t kMaxExpansion{44};
+
+    enum class Compression : uint8_t
+    {
+        None = 0,
+        Lz = 1,
+    };
+
+    struct Entry
+    {
+        uint64_t name_hash{};
+        uint64_t content_hash{};
+        uint64_t data_offset{};
+        uint64_t stored_size{};
+        uint64_t original_size{};
+        uint32_t name_offset{};
+        uint16_t name_length{};
+        Compression compression{Compression::None};
+    };
+
+    [[nodiscard]] static uint64_t Hash(std::string_view bytes);
+
+    template <typename T>
+    [[nodiscard]] static T Load(const uint8_t *bytes);
+    template <typename T>
+    static void Store(uint8_t *bytes, T value);
+
+    // Byte-oriented LZ77: a control byte below 0x80 introduces a run of
+    // (control + 1) literal bytes; otherwise it introduces a match of
+    // (control - 0x80 + 4) bytes, followed by a u16 distance back into the
+    // output.
+    [[nodiscard]] static std::vector<uint8_t> Compress(std::string_view input);
+    // `original_size` is only trusted up to the most the input could expand
+    // to, so a corrupt size cannot exhaust memory
+    [[nodiscard]] static std::optional<std::string> Decompress(
+        std::string_view input,
+        size_t original_size);
+};
+
+// Bytes of a resource. Uncompressed pack entries are views straight into the
+// mapped pack, and share ownership of the mapping so that it outlives them even
+// if the pack is unmounted; anything else owns its bytes. Either way `data()`
+// is followed by a NUL byte.
+class ResourceBlob
+{
+public:
+    ResourceBlob() = default;
+    // `owner` keeps the viewed memory alive. It may be null for memory that
+    // outlives the blob anyway, such as a pack embedded in the binary.
+    ResourceBlob(std::string_view view, std::shared_ptr<const void> owner);
+    explicit ResourceBlob(std::string owned_bytes);
+
+    [[nodiscard]] std::string_view data() const;
+    [[nodiscard]] const char *c_str() const;
+    [[nodiscard]] size_t size() const;
+
+private:
+    explicit ResourceBlob(std::shared_ptr<const std::string> owned_bytes);
+
+    std::string_view view{};
+    std::shared_ptr<const void> owner{nullptr};
+};
+
+// Lets stream-based parsers read a blob in place, e.g.
+//
+//   ResourceBlobStreamBuffer buffer{blob};
+//   std::istream stream{&buffer};
+class ResourceBlobStreamBuffer : public std::streambuf
+{
+public:
+    explicit ResourceBlobStreamBuffer(const ResourceBlob &blob);
+};
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    ~MappedFile();
+
+    [[nodiscard]] static std::optional<MappedFile> Open(
+        const std::filesystem::path &path);
+
+    [[nodiscard]] std::string_view data() const;
+
+private:
+    void Close();
+
+    const char *address{nullptr};
+    size_t length{0};
+#ifdef _WIN32
+    HANDLE file{INVALID_HANDLE_VALUE};
+    HANDLE mapping{nullptr};
+#endif
+};
+
+class ResourcePack
+{
+public:
+    // Map the pack at `path`, returning std::nullopt if it is missing or
+    // malformed
+    [[nodiscard]] static std::optional<ResourcePack> Open(
+        const std::filesystem::path &path);
+
+    // Use a pack that is already in memory, such as one embedded in the
+    // binary. The memory must outlive the pack.
+    [[nodiscard]] static std::optional<ResourcePack> FromMemory(
+        std::string_view bytes);
+
+    [[nodiscard]] std::optional<ResourceBlob> Find(std::string_view name) const;
+    [[nodiscard]] bool Contains(std::string_view name) const;
+    [[nodiscard]] size_t size() const;
+
+    // Check every entry against its content hash
+    [[nodiscard]] bool Verify() const;
+
+private:
+    [[nodiscard]] static bool ParseIndex(std::string_view bytes,
+                                         std::vector<ResourcePackFormat::Entry>
+                                             &entries);
+    [[nodiscard]] const ResourcePackFormat::Entry *FindEntry(
+        std::string_view name) const;
+    [[nodiscard]] std::string_view Name(
+        const ResourcePackFormat::Entry &entry) const;
+    [[nodiscard]] std::optional<ResourceBlob> Read(
+        const ResourcePackFormat::Entry &entry) const;
+
+    std::shared_ptr<const MappedFile> mapping{nullptr};
+    std::string_view bytes{};
+    uint64_t string_table_offset{0};
+    std::vector<ResourcePackFormat::Entry> entries{};
+};
+
+class ResourcePackWriter
+{
+public:
+    void Add(std::string name, std::string contents);
+
+    // Serialise every added resource, compressing those that shrink enough to
+    // be worth it
+    [[nodiscard]] std::vector<uint8_t> Build(
+        uint32_t alignment = ResourcePackFormat::kDefaultAlignment) const;
+
+    [[nodiscard]] bool Write(const std::filesystem::path &path) const;
+
+private:
+    std::vector<std::pair<std::string, std::string>> resources{};
+};
+
+inline uint64_t ResourcePackFormat::Hash(std::string_view bytes)
+{
+    constexpr uint64_t kFnvOffsetBasis{14'695'981'039'346'656'037ULL};
+    constexpr uint64_t kFnvPrime{1'099'511'628'211ULL};
+    uint64_t hash{kFnvOffsetBasis};
+    for (const char byte : bytes)
+    {
+        hash ^= static_cast<uint8_t>(byte);
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+template <typename T>
+inline T ResourcePackFormat::Load(const uint8_t *bytes)
+{
+    T value{0};
+    for (size_t byte{0}; byte < sizeof(T); ++byte)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        value |= static_cast<T>(static_cast<T>(bytes[byte]) << (8U * byte));
+    }
+    return value;
+}
+
+template <typename T>
+inline void ResourcePackFormat::Store(uint8_t *bytes, T value)
+{
+    for (size_t byte{0}; byte < sizeof(T); ++byte)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+        bytes[byte] = static_cast<uint8_t>(value >> (8U * byte));
+    }
+}
+
+inline std::vector<uint8_t> ResourcePackFormat::Compress(
+    std::string_view input)
+{
+    constexpr size_t kMinMatch{4};
+    constexpr size_t kMaxMatch{kMinMatch + 0x7F};
+    constexpr size_t kMaxLiteralRun{0x80};
+    constexpr size_t kMaxDistance{UINT16_MAX};
+    constexpr size_t kHashBits{14};
+
+    std::vector<uint8_t> output;
+    output.reserve(input.size() / 2);
+    std::vector<size_t> last_seen(size_t{1} << kHashBits, SIZE_MAX);
+
+    auto hash_at{[&input](size_t position) {
+        constexpr uint32_t kMultiplier{2'654'435'761U};
+        const uint32_t sequence{Load<uint32_t>(
+            // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+            reinterpret_cast<const uint8_t *>(input.data() + position))};
+        return static_cast<size_t>((sequence * kMultiplier) >>
+                                   (32U - kHashBits));
+    }};
+
+    size_t literal_start{0};
+    auto flush_literals{[&](size_t end) {
+        while (literal_start < end)
+        {
+            const size_t run{std::min(kMaxLiteralRun, end - literal_start)};
+            output.push_back(static_cast<uint8_t>(run - 1));
+            output.insert(output.end(),
+                          input.begin() +
+                              static_cast<std::ptrdiff_t>(literal_start),
+                          input.begin() +
+                              static_cast<std::ptrdiff_t>(literal_start + run));
+            literal_start += run;
+        }
+    }};
+
+    size_t position{0};
+    while (position + kMinMatch <= input.size())
+    {
+        const size_t hash{hash_at(position)};
+        const size_t candidate{last_seen[hash]};
+        last_seen[hash] = position;
+
+        if (candidate == SIZE_MAX || position - candidate > kMaxDistance)
+        {
+            ++position;
+            continue;
+        }
+        size_t length{0};
+        const size_t max_length{std::min(kMaxMatch, input.size() - position)};
+        while (length < max_length &&
+               input[candidate + length] == input[position + length])
+        {
+            ++length;
+        }
+        if (length < kMinMatch)
+        {
+            ++position;
+            continue;
+        }
+
+        flush_literals(position);
+        output.push_back(static_cast<uint8_t>(0x80U + (length - kMinMatch)));
+        const auto distance{static_cast<uint16_t>(position - candidate)};
+        output.push_back(static_cast<uint8_t>(distance & 0xFFU));
+        output.push_back(static_cast<uint8_t>(distance >> 8U));
+        position += length;
+        literal_start = position;
+    }
+    flush_literals(input.size());
+
+    return output;
+}
+
+inline std::optional<std::string> ResourcePackFormat::Decompress(
+    std::string_view input,
+    size_t original_size)
+{
+    constexpr size_t kMinMatch{4};
+    std::string output;
+    output.reserve(static_cast<size_t>(
+        std::min<uint64_t>(original_size, input.size() * kMaxExpansion)));
+
+    size_t position{0};
+    while (position < input.size())
+    {
+        const auto control{static_cast<uint8_t>(input[position++])};
+        if (control < 0x80U)
+        {
+            const size_t run{static_cast<size_t>(control) + 1};
+            if (position + run > input.size())
+            {
+                return std::nullopt;
+            }
+            output.append(input.substr(position, run));
+            position += run;
+        }
+        else
+        {
+            if (position + 2 > input.size())
+            {
+                return std::nullopt;
+            }
+            const size_t length{static_cast<size_t>(control - 0x80U) +
+                                kMinMatch};
+            const size_t distance{
+                static_cast<size_t>(static_cast<uint8_t>(input[position])) |
+                (static_cast<size_t>(static_cast<uint8_t>(input[position + 1]))
+                 << 8U)};
+            position += 2;
+            if (distance == 0 || distance > output.size())
+            {
+                return std::nullopt;
+            }
+            // Copy byte by byte, as a match may overlap its own output
+            const size_t match_start{output.size() - distance};
+            for (size_t offset{0}; offset < length; ++offset)
+            {
+                output.push_back(output[match_start + offset]);
+            }
+        }
+        if (output.size() > original_size)
+        {
+            return std::nullopt;
+        }
+    }
+
+    if (output.size() != original_size)
+    {
+        return std::nullopt;
+    }
+    return output;
+}
+
+inline ResourceBlob::ResourceBlob(std::string_view view_bytes,
+                                  std::shared_ptr<const void> owner_memory)
+    : view{view_bytes}, owner{std::move(owner_memory)}
+{
+}
+
+inline ResourceBlob::ResourceBlob(std::string owned_bytes)
+    : ResourceBlob{std::make_shared<const std::string>(std::move(owned_bytes))}
+{
+}
+
+inline ResourceBlob::ResourceBlob(
+    std::shared_ptr<const std::string> owned_bytes)
+    : view{*owned_bytes}, owner{std::move(owned_bytes)}
+{
+}
+
+inline std::string_view ResourceBlob::data() const
+{
+    return view;
+}
+
+inline const char *ResourceBlob::c_str() const
+{
+    return view.data();
+}
+
+inline size_t ResourceBlob::size() const
+{
+    return view.size();
+}
+
+inline ResourceBlobStreamBuffer::ResourceBlobStreamBuffer(
+    const ResourceBlob &blob)
+{
+    // The get area is never written through
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+    char *begin{const_cast<char *>(blob.c_str())};
+    setg(begin, begin, std::next(begin, static_cast<ptrdiff_t>(blob.size())));
+}
+
+inline MappedFile::MappedFile(MappedFile &&other) noexcept
+    : address{std::exchange(other.address, nullptr)},
+      length{std::exchange(other.length, 0)}
+#ifdef _WIN32
+      ,
+      file{std::exchange(other.file, INVALID_HANDLE_VALUE)},
+      mapping{std::exchange(other.mapping, nullptr)}
+#endif
+{
+}
+
+inline MappedFile &MappedFile::operator=(MappedFile &&other) noexcept
+{
+    if (this != &other)
+    {
+        Close();
+        address = std::exchange(other.address, nullptr);
+        length = std::exchange(other.length, 0);
+#ifdef _WIN32
+        file = std::exchange(other.file, INVALID_HANDLE_VALUE);
+        mapping = std::exchange(other.mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+inline MappedFile::~MappedFile()
+{
+    Close();
+}
+
+inline std::optional<MappedFile> MappedFile::Open(
+    const std::filesystem::path &path)
+{
+    MappedFile mapped;
+#ifdef _WIN32
+    mapped.file = CreateFileW(path.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (mapped.file == INVALID_HANDLE_VALUE)
+    {
+        return std::nullopt;
+    }
+    LARGE_INTEGER file_size{};
+    if (GetFileSizeEx(mapped.file, &file_size) == 0 ||
+        file_size.QuadPart == 0)
+    {
+        return std::nullopt;
+    }
+    mapped.mapping = CreateFileMappingW(mapped.file,
+                                        nullptr,
+                                        PAGE_READONLY,
+                                        0,
+                                        0,
+                                        nullptr);
+    if (mapped.mapping == nullptr)
+    {
+        return std::nullopt;
+    }
+    mapped.address = static_cast<const char *>(
+        MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0));
+    if (mapped.address == nullptr)
+    {
+        return std::nullopt;
+    }
+    mapped.length = static_cast<size_t>(file_size.QuadPart);
+#else
+    const int descriptor{::open(path.c_str(), O_RDONLY)};
+    if (descriptor < 0)
+    {
+        return std::nullopt;
+    }
+    struct stat file_status{};
+    if (::fstat(descriptor, &file_status) != 0 || file_status.st_size <= 0)
+    {
+        ::close(descriptor);
+        return std::nullopt;
+    }
+    const auto file_size{static_cast<size_t>(file_status.st_size)};
+    void *const address{
+        ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, descriptor, 0)};
+    // The mapping stays valid once the descriptor is closed
+    ::close(descriptor);
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-cstyle-cast,performance-no-int-to-ptr)
+    if (address == MAP_FAILED)
+    {
+        return std::nullopt;
+    }
+    mapped.address = static_cast<const char *>(address);
+    mapped.length = file_size;
+#endif
+    return mapped;
+}
+
+inline std::string_view MappedFile::data() const
+{
+    return {address, length};
+}
+
+inline void MappedFile::Close()
+{
+#ifdef _WIN32
+    if (address != nullptr)
+    {
+        UnmapViewOfFile(address);
+    }
+    if (mapping != nullptr)
+    {
+        CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (address != nullptr)
+    {
+        // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast)
+        ::munmap(const_cast<char *>(address), length);
+    }
+#endif
+    address = nullptr;
+    length = 0;
+}
+
+inline std::optional<ResourcePack> ResourcePack::Open(
+    const std::filesystem::path &path)
+{
+    std::optional<MappedFile> mapped{MappedFile::Open(path)};
+    if (!mapped.has_value())
+    {
+        return std::nullopt;
+    }
+    auto shared_mapping{
+        std::make_shared<const MappedFile>(std::move(mapped.value()))};
+    std::optional<ResourcePack> pack{FromMemory(shared_mapping->data())};
+    if (pack.has_value())
+    {
+        pack.value().mapping = std::move(shared_mapping);
+    }
+    return pack;
+}
+
+inline std::optional<ResourcePack> ResourcePack::FromMemory(
+    std::string_view pack_bytes)
+{
+    ResourcePack pack;
+    pack.bytes = pack_bytes;
+    if (!ParseIndex(pack_bytes, pack.entries))
+    {
+        return std::nullopt;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *const header{
+        reinterpret_cast<const uint8_t *>(pack_bytes.data())};
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    pack.string_table_offset = ResourcePackFormat::Load<uint64_t>(header + 16);
+    return pack;
+}
+
+inline std::optional<ResourceBlob> ResourcePack::Find(
+    std::string_view name) const
+{
+    const ResourcePackFormat::Entry *const entry{FindEntry(name)};
+    if (entry == nullptr)
+    {
+        return std::nullopt;
+    }
+    return Read(*entry);
+}
+
+inline bool ResourcePack::Contains(std::string_view name) const
+{
+    return FindEntry(name) != nullptr;
+}
+
+inline size_t ResourcePack::size() const
+{
+    return entries.size();
+}
+
+inline bool ResourcePack::Verify() const
+{
+    return std::all_of(entries.begin(),
+                       entries.end(),
+                       [this](const ResourcePackFormat::Entry &entry) {
+                           const std::optional<ResourceBlob> blob{Read(entry)};
+                           return blob.has_value() &&
+                                  ResourcePackFormat::Hash(blob->data()) ==
+                                      entry.content_hash;
+                       });
+}
+
+inline bool ResourcePack::ParseIndex(
+    std::string_view pack_bytes,
+    std::vector<ResourcePackFormat::Entry> &parsed_entries)
+{
+    using Format = ResourcePackFormat;
+    if (pack_bytes.size() < Format::kHeaderSize ||
+        pack_bytes.substr(0, Format::kMagic.size()) !=
+            std::string_view{Format::kMagic.data(), Format::kMagic.size()})
+    {
+        return false;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    const auto *const data{
+        reinterpret_cast<const uint8_t *>(pack_bytes.data())};
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    const auto version{Format::Load<uint32_t>(data + 4)};
+    const auto entry_count{Format::Load<uint32_t>(data + 8)};
+    const auto alignment{Format::Load<uint32_t>(data + 12)};
+    const auto string_table_offset{Format::Load<uint64_t>(data + 16)};
+    const auto file_size{Format::Load<uint64_t>(data + 24)};
+    if (version != Format::kVersion || file_size != pack_bytes.size() ||
+        alignment == 0 || (alignment & (alignment - 1)) != 0 ||
+        Format::kHeaderSize + static_cast<uint64_t>(entry_count) *
+                                  Format::kEntrySize >
+            string_table_offset ||
+        string_table_offset > file_size)
+    {
+        return false;
+    }
+
+    parsed_entries.clear();
+    parsed_entries.reserve(entry_count);
+    for (uint32_t index{0}; index < entry_count; ++index)
+    {
+        const uint8_t *const entry_bytes{data + Format::kHeaderSize +
+                                         static_cast<size_t>(index) *
+                                             Format::kEntrySize};
+        Format::Entry entry{};
+        entry.name_hash = Format::Load<uint64_t>(entry_bytes);
+        entry.content_hash = Format::Load<uint64_t>(entry_bytes + 8);
+        entry.data_offset = Format::Load<uint64_t>(entry_bytes + 16);
+        entry.stored_size = Format::Load<uint64_t>(entry_bytes + 24);
+        entry.original_size = Format::Load<uint64_t>(entry_bytes + 32);
+        entry.name_offset = Format::Load<uint32_t>(entry_bytes + 40);
+        entry.name_length = Format::Load<uint16_t>(entry_bytes + 44);
+        entry.compression =
+            static_cast<Format::Compression>(entry_bytes[46]);
+        // Every blob is followed by its NUL inside the file. Offsets are
+        // subtracted rather than added, so large ones cannot wrap around.
+        if (entry.data_offset >= file_size ||
+            entry.stored_size >= file_size - entry.data_offset ||
+            entry.data_offset % alignment != 0 ||
+            uint64_t{entry.name_offset} + entry.name_length >
+                file_size - string_table_offset ||
+            entry.compression > Format::Compression::Lz)
+        {
+            return false;
+        }
+        if (entry.compression == Format::Compression::None
+                ? entry.original_size != entry.stored_size ||
+                      data[entry.data_offset + entry.stored_size] != '\0'
+                : entry.original_size / Format::kMaxExpansion >
+                      entry.stored_size)
+        {
+            return false;
+        }
+        parsed_entries.push_back(entry);
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    return std::is_sorted(
+        parsed_entries.begin(),
+        parsed_entries.end(),
+        [](const Format::Entry &lhs, const Format::Entry &rhs) {
+            return lhs.name_hash < rhs.name_hash;
+        });
+}
+
+inline const ResourcePackFormat::Entry *ResourcePack::FindEntry(
+    std::string_view name) const
+{
+    const uint64_t name_hash{ResourcePackFormat::Hash(name)};
+    auto candidate{std::lower_bound(
+        entries.begin(),
+        entries.end(),
+        name_hash,
+        [](const ResourcePackFormat::Entry &entry, uint64_t hash) {
+            return entry.name_hash < hash;
+        })};
+    for (; candidate != entries.end() && candidate->name_hash == name_hash;
+         ++candidate)
+    {
+        if (Name(*candidate) == name)
+        {
+            return &*candidate;
+        }
+    }
+    return nullptr;
+}
+
+inline std::string_view ResourcePack::Name(
+    const ResourcePackFormat::Entry &entry) const
+{
+    return bytes.substr(
+        static_cast<size_t>(string_table_offset + entry.name_offset),
+        entry.name_length);
+}
+
+inline std::optional<ResourceBlob> ResourcePack::Read(
+    const ResourcePackFormat::Entry &entry) const
+{
+    const std::string_view stored{
+        bytes.substr(static_cast<size_t>(entry.data_offset),
+                     static_cast<size_t>(entry.stored_size))};
+    if (entry.compression == ResourcePackFormat::Compression::None)
+    {
+        return ResourceBlob{stored, mapping};
+    }
+
+    std::optional<std::string> decompressed{ResourcePackFormat::Decompress(
+        stored,
+        static_cast<size_t>(entry.original_size))};
+    if (!decompressed.has_value() ||
+        ResourcePackFormat::Hash(decompressed.value()) != entry.content_hash)
+    {
+        return std::nullopt;
+    }
+    return ResourceBlob{std::move(decompressed.value())};
+}
+
+inline void ResourcePackWriter::Add(std::string name, std::string contents)
+{
+    resources.emplace_back(std::move(name), std::move(contents));
+}
+
+inline std::vector<uint8_t> ResourcePackWriter::Build(uint32_t alignment) const
+{
+    using Format = ResourcePackFormat;
+
+    struct PendingEntry
+    {
+        Format::Entry entry;
+        std::string_view name;
+        std::vector<uint8_t> compressed;
+        std::string_view contents;
+    };
+    std::vector<PendingEntry> pending;
+    pending.reserve(resources.size());
+    for (const auto &[name, contents] : resources)
+    {
+        PendingEntry pending_entry{};
+        pending_entry.name = name;
+        pending_entry.contents = contents;
+        pending_entry.entry.name_hash = Format::Hash(name);
+        pending_entry.entry.content_hash = Format::Hash(contents);
+        pending_entry.entry.original_size = contents.size();
+        pending_entry.entry.name_length = static_cast<uint16_t>(name.size());
+
+        // Only keep the compressed copy if it saves at least an eighth
+        std::vector<uint8_t> compressed{Format::Compress(contents)};
+        if (compressed.size() < contents.size() - contents.size() / 8)
+        {
+            pending_entry.entry.compression = Format::Compression::Lz;
+            pending_entry.compressed = std::move(compressed);
+        }
+        pending.push_back(std::move(pending_entry));
+    }
+    std::sort(pending.begin(),
+              pending.end(),
+              [](const PendingEntry &lhs, const PendingEntry &rhs) {
+                  return lhs.entry.name_hash < rhs.entry.name_hash;
+              });
+
+    const uint64_t string_table_offset{
+        Format::kHeaderSize +
+        static_cast<uint64_t>(pending.size()) * Format::kEntrySize};
+    uint64_t size{string_table_offset};
+    for (PendingEntry &pending_entry : pending)
+    {
+        pending_entry.entry.name_offset =
+            static_cast<uint32_t>(size - string_table_offset);
+        size += pending_entry.name.size();
+    }
+    for (PendingEntry &pending_entry : pending)
+    {
+        size = (size + alignment - 1) / alignment * alignment;
+        pending_entry.entry.data_offset = size;
+        pending_entry.entry.stored_size =
+            pending_entry.entry.compression == Format::Compression::Lz
+                ? pending_entry.compressed.size()
+                : pending_entry.contents.size();
+        // trailing NUL
+        size += pending_entry.entry.stored_size + 1;
+    }
+
+    std::vector<uint8_t> pack(static_cast<size_t>(size), 0);
+    uint8_t *const data{pack.data()};
+    // NOLINTBEGIN(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+    std::memcpy(data, Format::kMagic.data(), Format::kMagic.size());
+    Format::Store<uint32_t>(data + 4, Format::kVersion);
+    Format::Store<uint32_t>(data + 8, static_cast<uint32_t>(pending.size()));
+    Format::Store<uint32_t>(data + 12, alignment);
+    Format::Store<uint64_t>(data + 16, string_table_offset);
+    Format::Store<uint64_t>(data + 24, size);
+    for (size_t index{0}; index < pending.size(); ++index)
+    {
+        const PendingEntry &pending_entry{pending[index]};
+        const Format::Entry &entry{pending_entry.entry};
+        uint8_t *const entry_bytes{data + Format::kHeaderSize +
+                                   index * Format::kEntrySize};
+        Format::Store<uint64_t>(entry_bytes, entry.name_hash);
+        Format::Store<uint64_t>(entry_bytes + 8, entry.content_hash);
+        Format::Store<uint64_t>(entry_bytes + 16, entry.data_offset);
+        Format::Store<uint64_t>(entry_bytes + 24, entry.stored_size);
+        Format::Store<uint64_t>(entry_bytes + 32, entry.original_size);
+        Format::Store<uint32_t>(entry_bytes + 40, entry.name_offset);
+        Format::Store<uint16_t>(entry_bytes + 44, entry.name_length);
+        entry_bytes[46] = static_cast<uint8_t>(entry.compression);
+
+        std::memcpy(data + string_table_offset + entry.name_offset,
+                    pending_entry.name.data(),
+                    pending_entry.name.size());
+        if (entry.compression == Format::Compression::Lz)
+        {
+            std::memcpy(data + entry.data_offset,
+                        pending_entry.compressed.data(),
+                        pending_entry.compressed.size());
+        }
+        else
+        {
+            std::memcpy(data + entry.data_offset,
+                        pending_entry.contents.data(),
+                        pending_entry.contents.size());
+        }
+    }
+    // NOLINTEND(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+
+    return pack;
+}
+
+inline bool ResourcePackWriter::Write(const std::filesystem::path &path) const
+{
+    const std::vector<uint8_t> pack{Build()};
+    std::ofstream file{path, std::ios::binary | std::ios::trunc};
+    if (!file.is_open())
+    {
+        return false;
+    }
+    // NOLINTNEXTLINE(cppcoreguidelines-pro-type-reinterpret-cast)
+    file.write(reinterpret_cast<const char *>(pack.data()),
+               static_cast<std::streamsize>(pack.size()));
+    return static_cast<bool>(file);
+}
+
+#endif
@@ -0,0 +1,431 @@
+#ifndef SRC_UTILITIES_SCENE_GRAPH_H
+#define SRC_UTILITIES_SCENE_GRAPH_H
+
+#include "profiler.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+// A 2D affine transform in the layout of `NodeTransform` in shader.wgsl: the
+// two columns of the linear part, then the translation
+struct SceneTransform
+{
+    std::array<float, 4> linear{1.0F, 0.0F, 0.0F, 1.0F};
+    std::array<float, 2> translation{};
+    // Padding up to the shader's 16-byte struct alignment
+    std::array<float, 2> _pad{};
+};
+
+static_assert(sizeof(SceneTransform) == 8 * sizeof(float),
+              "SceneTransform must match the shader's NodeTransform layout");
+
+// Scale uniformly, rotate by `rotation` radians, then move by `x`, `y`
+[[nodiscard]] SceneTransform MakeSceneTransform(float x,
+                                                float y,
+                                                float rotation,
+                                                float scale);
+// `local` followed by `parent`
+[[nodiscard]] SceneTransform Compose(const SceneTransform &parent,
+                                     const SceneTransform &local);
+
+// Counts for one `SceneGraph::Update`
+struct SceneUpdateStats
+{
+    // Nodes given a new local transform
+    uint32_t changed{0};
+    // World transforms recomputed: the changed nodes and their descendants
+    uint32_t recomputed{0};
+    // Ranges written to the transform buffer
+    uint32_t uploads{0};
+    uint64_t bytes_uploaded{0};
+    // Nodes were reordered, so every transform was recomputed and uploaded
+    bool reordered{false};
+};
+
+// A flat scene graph of 2D transforms. Nodes are held as structure of
+// arrays in depth-first order, so parents come before their children and
+// every subtree is one contiguous range. Setting a node's local transform
+// marks it dirty; `Update` recomputes world transforms only for the subtrees
+// under dirty nodes and uploads only those ranges, so its cost follows the
+// number of changed nodes and their descendants rather than the size of the
+// scene.
+//
+// Nodes are named by ids that never change. Their positions, which is where
+// their world transforms are in the buffer, only change when a node is added
+// under a parent whose subtree is not the last; the next `Update` then
+// reorders every node, and recomputes and uploads them all.
+//
+// `Upload` writes bytes into the transform buffer, like
+// wgpu::Queue::writeBuffer on a buffer of at least `BufferSize` bytes;
+// offsets and sizes are multiples of `sizeof(SceneTransform)`.
+class SceneGraph
+{
+public:
+    using NodeId = uint32_t;
+    using Upload =
+        std::function<void(uint64_t offset, const void *data, size_t size)>;
+
+    static constexpr NodeId kNoParent{std::numeric_limits<NodeId>::max()};
+    // Dirty ranges at most this many clean nodes apart are uploaded as one,
+    // as every write has a fixed cost
+    static constexpr uint32_t kMergeGap{8};
+
+    // Add a node under `parent`, an earlier node, or a root under kNoParent
+    NodeId Add(NodeId parent, const SceneTransform &local);
+    void SetLocal(NodeId node, const SceneTransform &local);
+
+    [[nodiscard]] const SceneTransform &Local(NodeId node) const;
+    // As of the last Update
+    [[nodiscard]] const SceneTransform &World(NodeId node) const;
+    // Where the node's world transform is, in transforms from the start of
+    // the buffer. Stable until a node is added.
+    [[nodiscard]] uint32_t Index(NodeId node) const;
+    [[nodiscard]] uint32_t Size() const;
+    [[nodiscard]] uint64_t BufferSize() const;
+
+    // Recompute the world transforms of dirty subtrees and upload them
+    const SceneUpdateStats &Update(const Upload &upload);
+
+    // World transforms in buffer order, as of the last Update
+    [[nodiscard]] const std::vector<SceneTransform> &WorldTransforms() const;
+    [[nodiscard]] const SceneUpdateStats &LastStats() const;
+    // One line of averages since creation, for the periodic statistics
+    [[nodiscard]] std::string Summary() const;
+
+private:
+    // Mark the node at `position` for recomputing, once
+    void MarkDirty(uint32_t position);
+    // Restore depth-first order, keeping siblings in the order they were
+    // added, and mark every root dirty
+    void Reorder();
+
+    // Indexed by position
+    std::vector<uint32_t> parents{};
+    // One past each node's last descendant
+    std::vector<uint32_t> subtree_ends{};
+    std::vector<SceneTransform> locals{};
+    std::vector<SceneTransform> worlds{};
+    std::vector<uint8_t> dirty_flags{};
+    std::vector<NodeId> ids{};
+    // Indexed by id
+    std::vector<uint32_t> positions{};
+
+    // Positions given a new local transform since the last Update
+    std::vector<uint32_t> dirty{};
+    bool needs_reorder{false};
+
+    SceneUpdateStats last_stats{};
+    uint64_t updates{0};
+    uint64_t total_changed{0};
+    uint64_t total_recomputed{0};
+    uint64_t total_uploads{0};
+    uint64_t total_bytes_uploaded{0};
+};
+
+inline SceneTransform MakeSceneTransform(float x,
+                                         float y,
+                                         float rotation,
+                                         float scale)
+{
+    const float cosine{scale * std::cos(rotation)};
+    const float sine{scale * std::sin(rotation)};
+    return SceneTransform{{cosine, sine, -sine, cosine}, {x, y}, {}};
+}
+
+inline SceneTransform Compose(const SceneTransform &parent,
+                              const SceneTransform &local)
+{
+    const std::array<float, 4> &outer{parent.linear};
+    const std::array<float, 4> &inner{local.linear};
+    return SceneTransform{
+        {outer[0] * inner[0] + outer[2] * inner[1],
+         outer[1] * inner[0] + outer[3] * inner[1],
+         outer[0] * inner[2] + outer[2] * inner[3],
+         outer[1] * inner[2] + outer[3] * inner[3]},
+        {outer[0] * local.translation[0] + outer[2] * local.translation[1] +
+             parent.translation[0],
+         outer[1] * local.translation[0] + outer[3] * local.translation[1] +
+             parent.translation[1]},
+        {}};
+}
+
+inline SceneGraph::NodeId SceneGraph::Add(NodeId parent,
+                                          const SceneTransform &local)
+{
+    const auto position{static_cast<uint32_t>(ids.size())};
+    const uint32_t parent_position{parent == kNoParent ? kNoParent
+                                                       : positions[parent]};
+    if (parent != kNoParent && !needs_reorder)
+    {
+        // Appending keeps depth-first order only under the last subtree
+        if (subtree_ends[parent_position] != position)
+        {
+            needs_reorder = true;
+        }
+        else
+        {
+            for (uint32_t ancestor{parent_position}; ancestor != kNoParent;
+                 ancestor = parents[ancestor])
+            {
+                subtree_ends[ancestor] = position + 1;
+            }
+        }
+    }
+
+    const NodeId node{position};
+    parents.push_back(parent_position);
+    subtree_ends.push_back(position + 1);
+    locals.push_back(local);
+    worlds.push_back(local);
+    dirty_flags.push_back(0);
+    ids.push_back(node);
+    positions.push_back(position);
+    MarkDirty(position);
+    return node;
+}
+
+inline void SceneGraph::SetLocal(NodeId node, const SceneTransform &local)
+{
+    const uint32_t position{positions[node]};
+    locals[position] = local;
+    MarkDirty(position);
+}
+
+inline const SceneTransform &SceneGraph::Local(NodeId node) const
+{
+    return locals[positions[node]];
+}
+
+inline const SceneTransform &SceneGraph::World(NodeId node) const
+{
+    return worlds[positions[node]];
+}
+
+inline uint32_t SceneGraph::Index(NodeId node) const
+{
+    return positions[node];
+}
+
+inline uint32_t SceneGraph::Size() const
+{
+    return static_cast<uint32_t>(ids.size());
+}
+
+inline uint64_t SceneGraph::BufferSize() const
+{
+    // Bindings may not be empty
+    return uint64_t{std::max(Size(), 1U)} * sizeof(SceneTransform);
+}
+
+inline const SceneUpdateStats &SceneGraph::Update(const Upload &upload)
+{
+    const ProfileZone profile_zone{"SceneGraph::Update"};
+    SceneUpdateStats stats{};
+    stats.changed = static_cast<uint32_t>(dirty.size());
+    if (needs_reorder)
+    {
+        Reorder();
+        stats.reordered = true;
+    }
+    std::sort(dirty.begin(), dirty.end());
+
+    uint32_t range_begin{0};
+    uint32_t range_end{0};
+    auto upload_range{[&]() {
+        if (range_end == range_begin)
+        {
+            return;
+        }
+        const size_t size{size_t{range_end - range_begin} *
+                          sizeof(SceneTransform)};
+        upload(uint64_t{range_begin} * sizeof(SceneTransform),
+               &worlds[range_begin],
+               size);
+        ++stats.uploads;
+        stats.bytes_uploaded += size;
+    }};
+
+    // Dirty positions in ascending order: a subtree's parent is either clean
+    // or was recomputed earlier in this pass
+    for (const uint32_t position : dirty)
+    {
+        dirty_flags[position] = 0;
+        if (position < range_end)
+        {
+            // Inside a subtree already recomputed
+            continue;
+        }
+        const uint32_t end{subtree_ends[position]};
+        for (uint32_t index{position}; index < end; ++index)
+        {
+            const uint32_t parent{parents[index]};
+            worlds[index] = parent == kNoParent
+                                ? locals[index]
+                                : Compose(worlds[parent], locals[index]);
+        }
+        stats.recomputed += end - position;
+
+        if (range_end == range_begin || position > range_end + kMergeGap)
+        {
+            upload_range();
+            range_begin = position;
+        }
+        range_end = end;
+    }
+    upload_range();
+    dirty.clear();
+
+    last_stats = stats;
+    ++updates;
+    total_changed += stats.changed;
+    total_recomputed += stats.recomputed;
+    total_uploads += stats.uploads;
+    total_bytes_uploaded += stats.bytes_uploaded;
+    return last_stats;
+}
+
+inline const std::vector<SceneTransform> &SceneGraph::WorldTransforms() const
+{
+    return worlds;
+}
+
+inline const SceneUpdateStats &SceneGraph::LastStats() const
+{
+    return last_stats;
+}
+
+inline std::string SceneGraph::Summary() const
+{
+    const double divisor{static_cast<double>(std::max(updates, uint64_t{1}))};
+    return fmt::format("Scene graph: {} nodes; {} updates changing {:.1f} "
+                       "nodes and recomputing {:.1f} on average, in {:.1f} "
+                       "uploads of {:.0f} bytes",
+                       Size(),
+                       updates,
+                       static_cast<double>(total_changed) / divisor,
+                       static_cast<double>(total_recomputed) / divisor,
+                       static_cast<double>(total_uploads) / divisor,
+                       static_cast<double>(total_bytes_uploaded) / divisor);
+}
+
+inline void SceneGraph::MarkDirty(uint32_t position)
+{
+    if (dirty_flags[position] == 0)
+    {
+        dirty_flags[position] = 1;
+        dirty.push_back(position);
+    }
+}
+
+inline void SceneGraph::Reorder()
+{
+    const uint32_t count{Size()};
+
+    // Each node's children, in position order, packed one parent after
+    // another
+    std::vector<uint32_t> child_starts(size_t{count} + 1, 0);
+    std::vector<uint32_t> roots{};
+    for (uint32_t position{0}; position < count; ++position)
+    {
+        if (parents[position] == kNoParent)
+        {
+            roots.push_back(position);
+        }
+        else
+        {
+            ++child_starts[parents[position] + 1];
+        }
+    }
+    for (uint32_t position{0}; position < count; ++position)
+    {
+        child_starts[position + 1] += child_starts[position];
+    }
+    std::vector<uint32_t> children(count - roots.size());
+    std::vector<uint32_t> filled{child_starts.begin(),
+                                 std::prev(child_starts.end())};
+    for (uint32_t position{0}; position < count; ++position)
+    {
+        if (parents[position] != kNoParent)
+        {
+            children[filled[parents[position]]++] = position;
+        }
+    }
+
+    // Visit depth first; the stack holds old positions
+    std::vector<uint32_t> order{};
+    order.reserve(count);
+    std::vector<uint32_t> stack{roots.rbegin(), roots.rend()};
+    while (!stack.empty())
+    {
+        const uint32_t position{stack.back()};
+        stack.pop_back();
+        order.push_back(position);
+        for (uint32_t child{child_starts[position + 1]};
+             child > child_starts[position];
+             --child)
+        {
+            stack.push_back(children[child - 1]);
+        }
+    }
+
+    std::vector<uint32_t> new_positions(count);
+    for (uint32_t position{0}; position < count; ++position)
+    {
+        new_positions[order[position]] = position;
+    }
+    std::vector<uint32_t> new_parents(count);
+    std::vector<SceneTransform> new_locals(count);
+    std::vector<SceneTransform> new_worlds(count);
+    std::vector<NodeId> new_ids(count);
+    for (uint32_t position{0}; position < count; ++position)
+    {
+        const uint32_t old_position{order[position]};
+        const uint32_t old_parent{parents[old_position]};
+        new_parents[position] =
+            old_parent == kNoParent ? kNoParent : new_positions[old_parent];
+        new_locals[position] = locals[old_position];
+        new_worlds[position] = worlds[old_position];
+        new_ids[position] = ids[old_position];
+        positions[new_ids[position]] = position;
+    }
+    parents = std::move(new_parents);
+    locals = std::move(new_locals);
+    worlds = std::move(new_worlds);
+    ids = std::move(new_ids);
+
+    // A subtree ends where its last child's does
+    for (uint32_t position{0}; position < count; ++position)
+    {
+        subtree_ends[position] = position + 1;
+    }
+    for (uint32_t position{count}; position > 0; --position)
+    {
+        const uint32_t parent{parents[position - 1]};
+        if (parent != kNoParent)
+        {
+            subtree_ends[parent] = std::max(subtree_ends[parent],
+                                            subtree_ends[position - 1]);
+        }
+    }
+
+    std::fill(dirty_flags.begin(), dirty_flags.end(), uint8_t{0});
+    dirty.clear();
+    for (uint32_t position{0}; position < count;
+         position = subtree_ends[position])
+    {
+        MarkDirty(position);
+    }
+    needs_reorder = false;
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef SRC_UTILITIES_SPSC_QUEUE_H
+#define SRC_UTILITIES_SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+// Fixed-capacity ring for exactly one producer thread and one consumer
+// thread. Neither side ever blocks or allocates. `Capacity` must be a power
+// of two.
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+public:
+    static_assert(Capacity != 0 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+    // Producer only. Return false, leaving the queue as it was, if full.
+    bool Push(const T &value);
+    // Consumer only
+    [[nodiscard]] std::optional<T> Pop();
+    [[nodiscard]] bool Empty() const;
+
+private:
+    // Keeps the two indices out of each other's cache line
+    static constexpr size_t kCacheLineSize{64};
+
+    std::array<T, Capacity> slots{};
+    // Both only ever increase; slots are indexed modulo Capacity
+    alignas(kCacheLineSize) std::atomic<size_t> head{0};
+    alignas(kCacheLineSize) std::atomic<size_t> tail{0};
+};
+
+template <typename T, size_t Capacity>
+bool SpscQueue<T, Capacity>::Push(const T &value)
+{
+    const size_t write{tail.load(std::memory_order_relaxed)};
+    if (write - head.load(std::memory_order_acquire) == Capacity)
+    {
+        return false;
+    }
+    slots.at(write % Capacity) = value;
+    tail.store(write + 1, std::memory_order_release);
+    return true;
+}
+
+template <typename T, size_t Capacity>
+std::optional<T> SpscQueue<T, Capacity>::Pop()
+{
+    const size_t read{head.load(std::memory_order_relaxed)};
+    if (read == tail.load(std::memory_order_acquire))
+    {
+        return std::nullopt;
+    }
+    T value{slots.at(read % Capacity)};
+    head.store(read + 1, std::memory_order_release);
+    return value;
+}
+
+template <typename T, size_t Capacity>
+bool SpscQueue<T, Capacity>::Empty() const
+{
+    return head.load(std::memory_order_acquire) ==
+           tail.load(std::memory_order_acquire);
+}
+
+#endif
@@ -0,0 +1,555 @@
+#ifndef SRC_UTILITIES_TEXTURE_LOADER_H
+#define SRC_UTILITIES_TEXTURE_LOADER_H
+
+#include "image_decoder.h"
+#include "mipmap_generator.h"
+#include "profiler.h"
+#include "resource_manager.h"
+#include "resource_pack.h"
+
+#include <webgpu/webgpu.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct LoadedTexture
+{
+    std::string name;
+    wgpu::Texture texture{nullptr};
+    wgpu::TextureView view{nullptr};
+};
+
+// Loads textures without stalling the frame: images are decoded on worker
+// threads (on the calling thread under Emscripten, which has none), then
+// `Poll` uploads any finished ones through a staging buffer and generates
+// their mip chains on the GPU.
+//
+// Images are read through the ResourceManager, so come from the resource pack
+// when one is mounted. Block-compressed variants are picked up from
+// `<stem>.<bc7|etc2|astc>.ctex` resources next to the source image when the
+// device has the matching feature; otherwise the image is decoded to RGBA8.
+// Source images are binary PPM (P6).
+class TextureLoader
+{
+public:
+    // Create the mipmap generation pipeline and return true if it all went
+    // well
+    bool Initialise(wgpu::Device device,
+                    wgpu::Queue queue,
+                    std::string_view mipmap_shader_name);
+
+    // Free everything that was initialised. Textures already handed out are
+    // owned by the caller.
+    void Terminate();
+
+    // Start decoding the image resource `name` on a worker thread, or decode
+    // it at once under Emscripten
+    void Request(const std::string &name);
+
+    // Upload any images that have finished decoding. Never blocks on a decode.
+    [[nodiscard]] std::vector<LoadedTexture> Poll();
+
+    // Upload an image straight away, on the calling thread. Returns null
+    // handles, creating nothing, if a level holds too little data.
+    [[nodiscard]] LoadedTexture Upload(const ImageData &image,
+                                       const char *label);
+
+    [[nodiscard]] bool HasPendingRequests() const;
+    [[nodiscard]] uint64_t BytesUploaded() const;
+
+    // GPU memory held by the mip chain of a texture this loader created
+    [[nodiscard]] static uint64_t ByteSize(wgpu::Texture texture);
+
+    // Compression features the adapter supports, in order of preference, to
+    // be enabled when requesting the device
+    [[nodiscard]] static std::vector<WGPUFeatureName>
+    SupportedCompressionFeatures(wgpu::Adapter adapter);
+
+private:
+    struct CompressedFormat
+    {
+        wgpu::FeatureName feature;
+        wgpu::TextureFormat format;
+        const char *extension;
+        ImageFormat image_format;
+    };
+
+    static constexpr uint32_t kBlockDimension{ImageDecoder::kBlockDimension};
+    static constexpr uint32_t kBytesPerBlock{ImageDecoder::kBytesPerBlock};
+    static constexpr uint32_t kBytesPerRgba8Texel{
+        ImageDecoder::kBytesPerRgba8Texel};
+    // `copyBufferToTexture` needs rows aligned to 256 bytes
+    static constexpr uint32_t kCopyBytesPerRowAlignment{256};
+    static constexpr std::array<CompressedFormat, 3> kCompressedFormats{{
+        {wgpu::FeatureName::TextureCompressionBC,
+         wgpu::TextureFormat::BC7RGBAUnorm,
+         ".bc7.ctex",
+         ImageFormat::Bc7},
+        {wgpu::FeatureName::TextureCompressionETC2,
+         wgpu::TextureFormat::ETC2RGBA8Unorm,
+         ".etc2.ctex",
+         ImageFormat::Etc2},
+        {wgpu::FeatureName::TextureCompressionASTC,
+         wgpu::TextureFormat::ASTC4x4Unorm,
+         ".astc.ctex",
+         ImageFormat::Astc4x4},
+    }};
+
+    struct PendingTexture
+    {
+        std::string name;
+        std::chrono::steady_clock::time_point requested_at;
+        std::future<std::optional<ImageData>> image;
+    };
+
+    // Read the image resource `name` and decode it, logging why if it fails
+    [[nodiscard]] static std::optional<ImageData> ReadImage(
+        std::string_view name,
+        bool compressed,
+        uint32_t max_dimension);
+    [[nodiscard]] static wgpu::TextureFormat TextureFormat(ImageFormat format);
+    [[nodiscard]] static bool IsCompressed(wgpu::TextureFormat format);
+
+    std::optional<wgpu::Device> device{std::nullopt};
+    std::optional<wgpu::Queue> queue{std::nullopt};
+    MipmapGenerator mipmap_generator{};
+    std::vector<PendingTexture> pending{};
+    uint64_t bytes_uploaded{0};
+    uint32_t max_texture_dimension{ImageDecoder::kDefaultMaxDimension};
+};
+
+inline bool TextureLoader::Initialise(wgpu::Device device_handle,
+                                      wgpu::Queue queue_handle,
+                                      std::string_view mipmap_shader_name)
+{
+    device = device_handle;
+    queue = queue_handle;
+    wgpu::SupportedLimits supported_limits{};
+    if (device_handle.getLimits(&supported_limits))
+    {
+        max_texture_dimension = supported_limits.limits.maxTextureDimension2D;
+    }
+    return mipmap_generator.Initialise(device_handle, mipmap_shader_name);
+}
+
+inline void TextureLoader::Terminate()
+{
+    // Waits for any decodes still in flight
+    pending.clear();
+    mipmap_generator.Terminate();
+    queue.reset();
+    device.reset();
+}
+
+inline void TextureLoader::Request(const std::string &name)
+{
+    if (!device.has_value())
+    {
+        spdlog::error("Texture loader used before it was initialised");
+        return;
+    }
+
+    // Pick the compressed variant on this thread, as the device is not
+    // touched by the workers
+    std::optional<std::string> compressed_name{std::nullopt};
+    for (const CompressedFormat &compressed_format : kCompressedFormats)
+    {
+        const std::string candidate{
+            std::filesystem::path{name}
+                .replace_extension(compressed_format.extension)
+                .generic_string()};
+        if (device.value().hasFeature(compressed_format.feature) &&
+            ResourceManager::exists(candidate))
+        {
+            compressed_name = candidate;
+            break;
+        }
+    }
+
+    auto decode{[name,
+                 compressed_name,
+                 max_dimension = max_texture_dimension]()
+                    -> std::optional<ImageData> {
+        const ProfileZone profile_zone{"Decode texture"};
+        // Poll reports a failed decode, rather than rethrowing out of the
+        // main loop
+        try
+        {
+            if (compressed_name.has_value())
+            {
+                std::optional<ImageData> image{ReadImage(
+                    compressed_name.value(), true, max_dimension)};
+                if (image.has_value())
+                {
+                    return image;
+                }
+                spdlog::warn("Falling back to RGBA8 for `{}`", name);
+            }
+            return ReadImage(name, false, max_dimension);
+        }
+        catch (const std::exception &e)
+        {
+            spdlog::error("Decoding `{}` failed: {}", name, e.what());
+            return std::nullopt;
+        }
+    }};
+
+#ifdef __EMSCRIPTEN__
+    // There are no worker threads, so decode here and hand Poll a future
+    // that is already ready; a deferred one would never report ready
+    std::promise<std::optional<ImageData>> decoded{};
+    decoded.set_value(decode());
+    std::future<std::optional<ImageData>> image{decoded.get_future()};
+#else
+    std::future<std::optional<ImageData>> image{
+        std::async(std::launch::async, decode)};
+#endif
+    pending.push_back(PendingTexture{
+        name, std::chrono::steady_clock::now(), std::move(image)});
+}
+
+inline std::vector<LoadedTexture> TextureLoader::Poll()
+{
+    const ProfileZone profile_zone{"TextureLoader::Poll"};
+    std::vector<LoadedTexture> loaded;
+    auto pending_iterator{pending.begin()};
+    while (pending_iterator != pending.end())
+    {
+        if (pending_iterator->image.wait_for(std::chrono::seconds{0}) !=
+            std::future_status::ready)
+        {
+            ++pending_iterator;
+            continue;
+        }
+
+        std::optional<ImageData> image{pending_iterator->image.get()};
+        if (image.has_value())
+        {
+            const uint64_t bytes_before{bytes_uploaded};
+            LoadedTexture texture{Upload(image.value(), "Loaded texture")};
+            if (texture.texture == nullptr)
+            {
+                spdlog::error("Could not upload texture `{}`",
+                              pending_iterator->name);
+                pending_iterator = pending.erase(pending_iterator);
+                continue;
+            }
+            texture.name = pending_iterator->name;
+            const std::chrono::duration<double, std::milli> latency{
+                std::chrono::steady_clock::now() -
+                pending_iterator->requested_at};
+            spdlog::info("Loaded texture `{}` ({}x{}, {} bytes uploaded) "
+                         "{:.2f} ms after request",
+                         pending_iterator->name,
+                         image.value().width,
+                         image.value().height,
+                         bytes_uploaded - bytes_before,
+                         latency.count());
+            loaded.push_back(texture);
+        }
+        else
+        {
+            spdlog::error("Could not load texture `{}`",
+                          pending_iterator->name);
+        }
+        pending_iterator = pending.erase(pending_iterator);
+    }
+
+    return loaded;
+}
+
+inline LoadedTexture TextureLoader::Upload(const ImageData &image,
+                                           const char *label)
+{
+    const ProfileZone profile_zone{"TextureLoader::Upload"};
+    if (!device.has_value() || !queue.has_value())
+    {
+        spdlog::error("Texture loader used before it was initialised");
+        return {};
+    }
+
+    if (image.width == 0 || image.height == 0 ||
+        image.width > max_texture_dimension ||
+        image.height > max_texture_dimension)
+    {
+        spdlog::error("Texture size {}x{} is outside 1 to {}",
+                      image.width,
+                      image.height,
+                      max_texture_dimension);
+        return {};
+    }
+
+    const bool compressed{image.format != ImageFormat::Rgba8};
+    const uint32_t mip_level_count{
+        compressed ? static_cast<uint32_t>(image.levels.size())
+                   : ImageDecoder::MipLevelCount(image.width, image.height)};
+
+    // Lay out every level in one staging buffer, with rows padded to the
+    // alignment that buffer-to-texture copies need
+    struct LevelLayout
+    {
+        uint64_t offset;
+        uint32_t bytes_per_row;
+        uint32_t padded_bytes_per_row;
+        uint32_t rows;
+        WGPUExtent3D copy_size;
+    };
+    std::vector<LevelLayout> level_layouts;
+    uint64_t staging_size{0};
+    uint32_t level_width{image.width};
+    uint32_t level_height{image.height};
+    for (const std::vector<uint8_t> &level : image.levels)
+    {
+        LevelLayout level_layout{};
+        if (compressed)
+        {
+            const uint32_t blocks_wide{
+                (level_width + kBlockDimension - 1) / kBlockDimension};
+            level_layout.bytes_per_row = blocks_wide * kBytesPerBlock;
+            level_layout.rows =
+                (level_height + kBlockDimension - 1) / kBlockDimension;
+            level_layout.copy_size = {blocks_wide * kBlockDimension,
+                                      level_layout.rows * kBlockDimension,
+                                      1};
+        }
+        else
+        {
+            level_layout.bytes_per_row = level_width * kBytesPerRgba8Texel;
+            level_layout.rows = level_height;
+            level_layout.copy_size = {level_width, level_height, 1};
+        }
+        level_layout.padded_bytes_per_row =
+            (level_layout.bytes_per_row + kCopyBytesPerRowAlignment - 1) /
+            kCopyBytesPerRowAlignment * kCopyBytesPerRowAlignment;
+        if (level.size() < static_cast<size_t>(level_layout.bytes_per_row) *
+                               level_layout.rows)
+        {
+            // Keep whatever the caller has rather than sample levels that
+            // were never uploaded
+            spdlog::error("Texture level data is smaller than expected");
+            return {};
+        }
+        level_layout.offset = staging_size;
+        staging_size +=
+            static_cast<uint64_t>(level_layout.padded_bytes_per_row) *
+            level_layout.rows;
+        level_layouts.push_back(level_layout);
+
+        level_width = std::max(1U, level_width / 2);
+        level_height = std::max(1U, level_height / 2);
+    }
+
+    wgpu::TextureDescriptor texture_descriptor{};
+    texture_descriptor.label = label;
+    texture_descriptor.dimension = wgpu::TextureDimension::_2D;
+    texture_descriptor.format = TextureFormat(image.format);
+    texture_descriptor.size = {image.width, image.height, 1};
+    texture_descriptor.mipLevelCount = mip_level_count;
+    texture_descriptor.sampleCount = 1;
+    texture_descriptor.usage =
+        compressed ? wgpu::TextureUsage::TextureBinding |
+                         wgpu::TextureUsage::CopyDst
+                   : wgpu::TextureUsage::TextureBinding |
+                         wgpu::TextureUsage::StorageBinding |
+                         wgpu::TextureUsage::CopyDst;
+    texture_descriptor.viewFormatCount = 0;
+    texture_descriptor.viewFormats = nullptr;
+    wgpu::Texture texture{device.value().createTexture(texture_descriptor)};
+
+    wgpu::BufferDescriptor staging_descriptor{};
+    staging_descriptor.label = "Texture staging buffer";
+    staging_descriptor.size = staging_size;
+    staging_descriptor.usage =
+        wgpu::BufferUsage::MapWrite | wgpu::BufferUsage::CopySrc;
+    staging_descriptor.mappedAtCreation = 1U;
+    wgpu::Buffer staging_buffer{
+        device.value().createBuffer(staging_descriptor)};
+
+    auto *const mapped{static_cast<uint8_t *>(
+        staging_buffer.getMappedRange(0, static_cast<size_t>(staging_size)))};
+    for (size_t level{0}; level < level_layouts.size(); ++level)
+    {
+        const LevelLayout &level_layout{level_layouts[level]};
+        for (uint32_t row{0}; row < level_layout.rows; ++row)
+        {
+            std::memcpy(
+                // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic)
+                mapped + level_layout.offset +
+                    static_cast<uint64_t>(row) *
+                        level_layout.padded_bytes_per_row,
+                image.levels[level].data() +
+                    static_cast<size_t>(row) * level_layout.bytes_per_row,
+                level_layout.bytes_per_row);
+        }
+    }
+    staging_buffer.unmap();
+
+    wgpu::CommandEncoderDescriptor encoder_descriptor{};
+    encoder_descriptor.label = "Texture upload encoder";
+    wgpu::CommandEncoder encoder{
+        device.value().createCommandEncoder(encoder_descriptor)};
+    GpuProfileZone<wgpu::CommandEncoder> upload_zone{encoder,
+                                                     "Texture upload"};
+    for (size_t level{0}; level < level_layouts.size(); ++level)
+    {
+        const LevelLayout &level_layout{level_layouts[level]};
+
+        wgpu::ImageCopyBuffer source{};
+        source.buffer = staging_buffer;
+        source.layout.offset = level_layout.offset;
+        source.layout.bytesPerRow = level_layout.padded_bytes_per_row;
+        source.layout.rowsPerImage = level_layout.rows;
+
+        wgpu::ImageCopyTexture destination{};
+        destination.texture = texture;
+        destination.mipLevel = static_cast<uint32_t>(level);
+        destination.origin = {0, 0, 0};
+        destination.aspect = wgpu::TextureAspect::All;
+
+        encoder.copyBufferToTexture(source,
+                                    destination,
+                                    level_layout.copy_size);
+    }
+    if (!compressed)
+    {
+        mipmap_generator.Generate(encoder,
+                                  texture,
+                                  texture_descriptor.size,
+                                  mip_level_count);
+    }
+    upload_zone.End();
+
+    wgpu::CommandBufferDescriptor command_buffer_descriptor{};
+    command_buffer_descriptor.label = "Texture upload commands";
+    wgpu::CommandBuffer command{encoder.finish(command_buffer_descriptor)};
+    encoder.release();
+    queue.value().submit(1, &command);
+    command.release();
+
+    // Dropping our reference is safe once the copy has been submitted
+    staging_buffer.release();
+    bytes_uploaded += staging_size;
+
+    wgpu::TextureViewDescriptor view_descriptor{};
+    view_descriptor.label = label;
+    view_descriptor.format = texture_descriptor.format;
+    view_descriptor.dimension = wgpu::TextureViewDimension::_2D;
+    view_descriptor.baseMipLevel = 0;
+    view_descriptor.mipLevelCount = mip_level_count;
+    view_descriptor.baseArrayLayer = 0;
+    view_descriptor.arrayLayerCount = 1;
+    view_descriptor.aspect = wgpu::TextureAspect::All;
+
+    return LoadedTexture{{}, texture, texture.createView(view_descriptor)};
+}
+
+inline bool TextureLoader::HasPendingRequests() const
+{
+    return !pending.empty();
+}
+
+inline uint64_t TextureLoader::BytesUploaded() const
+{
+    return bytes_uploaded;
+}
+
+inline uint64_t TextureLoader::ByteSize(wgpu::Texture texture)
+{
+    const bool compressed{IsCompressed(texture.getFormat())};
+    uint64_t size{0};
+    uint32_t level_width{texture.getWidth()};
+    uint32_t level_height{texture.getHeight()};
+    for (uint32_t level{0}; level < texture.getMipLevelCount(); ++level)
+    {
+        if (compressed)
+        {
+            size += static_cast<uint64_t>(
+                        (level_width + kBlockDimension - 1) /
+                        kBlockDimension) *
+                    ((level_height + kBlockDimension - 1) / kBlockDimension) *
+                    kBytesPerBlock;
+        }
+        else
+        {
+            size += static_cast<uint64_t>(level_width) * level_height *
+                    kBytesPerRgba8Texel;
+        }
+        level_width = std::max(1U, level_width / 2);
+        level_height = std::max(1U, level_height / 2);
+    }
+    return size;
+}
+
+inline std::vector<WGPUFeatureName> TextureLoader::SupportedCompressionFeatures(
+    wgpu::Adapter adapter)
+{
+    std::vector<WGPUFeatureName> features;
+    for (const CompressedFormat &compressed_format : kCompressedFormats)
+    {
+        if (adapter.hasFeature(compressed_format.feature))
+        {
+            features.push_back(compressed_format.feature);
+        }
+    }
+    return features;
+}
+
+inline std::optional<ImageData> TextureLoader::ReadImage(std::string_view name,
+                                                         bool compressed,
+                                                         uint32_t max_dimension)
+{
+    const std::optional<ResourceBlob> blob{ResourceManager::read(name)};
+    if (!blob.has_value())
+    {
+        return std::nullopt;
+    }
+    ImageDecodeError error{ImageDecodeError::None};
+    std::optional<ImageData> image{
+        compressed
+            ? ImageDecoder::DecodeCompressed(blob.value(), error, max_dimension)
+            : ImageDecoder::DecodePpm(blob.value(), error, max_dimension)};
+    if (!image.has_value())
+    {
+        spdlog::error("Could not decode `{}`: {}",
+                      name,
+                      ImageDecoder::Describe(error));
+    }
+    return image;
+}
+
+inline wgpu::TextureFormat TextureLoader::TextureFormat(ImageFormat format)
+{
+    for (const CompressedFormat &compressed_format : kCompressedFormats)
+    {
+        if (compressed_format.image_format == format)
+        {
+            return compressed_format.format;
+        }
+    }
+    return wgpu::TextureFormat::RGBA8Unorm;
+}
+
+inline bool TextureLoader::IsCompressed(wgpu::TextureFormat format)
+{
+    return std::any_of(kCompressedFormats.begin(),
+                       kCompressedFormats.end(),
+                       [format](const CompressedFormat &compressed_format) {
+                           return compressed_format.format == format;
+                       });
+}
+
+#endif
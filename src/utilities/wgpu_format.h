@@ -0,0 +1,35 @@
+#ifndef SRC_UTILITIES_WGPU_FORMAT_H
+#define SRC_UTILITIES_WGPU_FORMAT_H
+
+#include <webgpu/webgpu.h>
+
+#include <fmt/format.h>
+
+// Let fmt and spdlog format the WebGPU C enums as their numeric values. They
+// are found by argument-dependent lookup, so must sit in the global namespace.
+
+// NOLINTNEXTLINE(misc-use-internal-linkage)
+inline auto format_as(WGPUErrorType error_type)
+{
+    return fmt::underlying(error_type);
+}
+
+// NOLINTNEXTLINE(misc-use-internal-linkage)
+inline auto format_as(WGPUDeviceLostReason reason)
+{
+    return fmt::underlying(reason);
+}
+
+// NOLINTNEXTLINE(misc-use-internal-linkage)
+inline auto format_as(WGPUBufferMapAsyncStatus status)
+{
+    return fmt::underlying(status);
+}
+
+// NOLINTNEXTLINE(misc-use-internal-linkage)
+inline auto format_as(WGPUQueueWorkDoneStatus status)
+{
+    return fmt::underlying(status);
+}
+
+#endif